@@ -0,0 +1,81 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "vec3.h"
+#include "ray.h"
+#include <limits>
+#include <algorithm>
+
+// Caixa alinhada aos eixos (Axis-Aligned Bounding Box)
+struct AABB {
+    Vec3 min, max;
+
+    // Caixa vazia: qualquer expand() a substitui
+    AABB() {
+        const double inf = std::numeric_limits<double>::infinity();
+        min = Vec3(inf, inf, inf);
+        max = Vec3(-inf, -inf, -inf);
+    }
+    AABB(const Vec3& mn, const Vec3& mx) : min(mn), max(mx) {}
+
+    bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+    void expand(const Vec3& p) {
+        min = Vec3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+        max = Vec3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+    }
+
+    void expand(const AABB& b) {
+        expand(b.min);
+        expand(b.max);
+    }
+
+    // Alarga a caixa em todas as direções (margem para erros de arredondamento)
+    void pad(double eps) {
+        min = min - Vec3(eps, eps, eps);
+        max = max + Vec3(eps, eps, eps);
+    }
+
+    Vec3 center() const { return (min + max) * 0.5; }
+
+    double axis_min(int axis) const { return axis == 0 ? min.x : (axis == 1 ? min.y : min.z); }
+    double axis_max(int axis) const { return axis == 0 ? max.x : (axis == 1 ? max.y : max.z); }
+
+    double surface_area() const {
+        if (empty()) return 0.0;
+        Vec3 d = max - min;
+        return 2.0 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    // Teste de slabs. inv_dir = 1 / direção do raio (pode conter infinitos).
+    // Em caso de interseção, t_min passa a ser a distância de entrada na caixa.
+    // Quando a origem está exatamente sobre um plano paralelo ao raio o produto
+    // vira NaN; as comparações abaixo ignoram NaN e mantêm o teste conservador.
+    // As contas são em Real, como no teste de pacotes da BVH.
+    bool hit(const Ray& r, const Vec3& inv_dir, double& t_min_d, double t_max_d) const {
+        Real t_min = Real(t_min_d), t_max = Real(t_max_d);
+
+        Real t0 = (min.x - r.origin.x) * inv_dir.x;
+        Real t1 = (max.x - r.origin.x) * inv_dir.x;
+        if (inv_dir.x < 0) std::swap(t0, t1);
+        if (t0 > t_min) t_min = t0;
+        if (t1 < t_max) t_max = t1;
+
+        t0 = (min.y - r.origin.y) * inv_dir.y;
+        t1 = (max.y - r.origin.y) * inv_dir.y;
+        if (inv_dir.y < 0) std::swap(t0, t1);
+        if (t0 > t_min) t_min = t0;
+        if (t1 < t_max) t_max = t1;
+
+        t0 = (min.z - r.origin.z) * inv_dir.z;
+        t1 = (max.z - r.origin.z) * inv_dir.z;
+        if (inv_dir.z < 0) std::swap(t0, t1);
+        if (t0 > t_min) t_min = t0;
+        if (t1 < t_max) t_max = t1;
+
+        t_min_d = t_min;
+        return t_min <= t_max;
+    }
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <string>
+#include <vector>
+#include "scene.h"
+
+// Animação (--animate): um caminho de câmera e, opcionalmente, trajetórias
+// para os centros de esferas, dados por quadros-chave. Entre duas chaves os
+// valores são interpolados linearmente; antes da primeira e depois da última
+// ficam parados.
+//
+// Arquivo de texto, no mesmo estilo da cena:
+//   <número de quadros>
+//   <número de chaves de câmera>
+//   <quadro> <olho x y z> <alvo x y z> <up x y z> <fov>    (uma por chave)
+//   <número de chaves de esferas>
+//   <índice do objeto> <quadro> <centro x y z>             (uma por chave)
+// O índice do objeto é a posição na lista de objetos da cena (a partir de 0,
+// sem contar os protótipos) e precisa ser uma esfera. Sem chaves de câmera,
+// vale a câmera da cena.
+
+struct CameraKey {
+    int frame;
+    Vec3 eye, at, up;
+    double fov;
+};
+
+struct SphereKey {
+    int object;
+    int frame;
+    Vec3 center;
+};
+
+struct Animation {
+    int frames = 0;
+    std::vector<CameraKey> camera;  // Em ordem de quadro
+    std::vector<SphereKey> spheres; // Agrupadas por objeto, em ordem de quadro
+
+    bool moves_objects() const { return !spheres.empty(); }
+
+    // Põe a câmera e as esferas animadas na posição do quadro. Não mexe na
+    // BVH: depois de mover esferas é preciso chamar scene.bvh.refit() (ou
+    // reconstruí-la).
+    void apply(int frame, Scene& scene) const;
+};
+
+// Lê o arquivo e valida os índices contra a cena já carregada
+bool loadAnimation(const std::string& filename, const Scene& scene, Animation& anim);
+
+#endif
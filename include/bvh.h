@@ -0,0 +1,107 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "aabb.h"
+#include "object.h"
+#include "sphere_batch.h"
+#include "packet.h"
+
+struct BVHNode {
+    AABB box;
+    int first;  // Folha: primeiro índice em prims. Nó interno: índice do filho esquerdo (o direito é first + 1)
+    int count;  // Número de primitivas (0 em nós internos)
+    int axis;   // Eixo da divisão, usado para visitar primeiro o filho mais próximo
+    int spheres; // Folha: quantas das primitivas (as primeiras) são esferas, testadas em lote
+};
+
+// Hierarquia de volumes envolventes sobre os objetos da cena, construída com SAH
+class BVH {
+public:
+    std::vector<BVHNode> nodes;
+    std::vector<int> prims;      // Índices em objects, agrupados por folha
+    std::vector<int> unbounded;  // Objetos sem caixa (planos), testados para todo raio
+    SphereSoA sphere_data;       // Centros e raios das esferas, nas mesmas posições de prims
+
+    double build_time_ms;
+    double built_area; // Soma das áreas das caixas dos nós logo após build/adopt (ver refit)
+
+    // Estatísticas de travessia (só contabilizadas com collect_stats ligado)
+    bool collect_stats;
+    mutable std::atomic<uint64_t> stat_queries;
+    mutable std::atomic<uint64_t> stat_nodes_visited;
+
+    BVH() : build_time_ms(0), built_area(0), collect_stats(false), stat_queries(0), stat_nodes_visited(0), objects(nullptr), simd_width(1) {}
+
+    void build(const std::vector<Object*>& objs);
+
+    // Adota uma árvore já pronta (cena compilada, ver scene_binary.h): nodes,
+    // prims e unbounded já foram preenchidos; aqui só são validados os índices
+    // e refeitos os dados SoA das esferas. Retorna false se a árvore é inválida.
+    bool adopt(const std::vector<Object*>& objs);
+
+    // Depois que objetos limitados se moveram (sem mudar de tipo nem deixar de
+    // ser limitados): recalcula as caixas de baixo para cima, mantendo a
+    // topologia, e atualiza os dados SoA das esferas. Retorna a soma das áreas
+    // das caixas dividida pela de quando a árvore foi construída: quanto maior,
+    // mais cara ficou a travessia em relação a uma árvore nova.
+    double refit();
+
+    // Interseção mais próxima. Em empates de t vence o objeto de menor índice,
+    // exatamente como no laço linear sobre scene.objects.
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const;
+
+    // Qualquer interseção no intervalo, usando Object::occluded (raios de sombra).
+    // occluder (opcional) recebe o índice do objeto que bloqueou o raio.
+    bool occluded(const Ray& r, double t_min, double t_max, int* occluder = nullptr) const;
+
+    // Versões para pacotes de raios: a travessia é compartilhada (um nó é
+    // visitado se alguma lane ativa atinge sua caixa) e, nas folhas, cada
+    // esfera e cada poliedro é testado contra todas as lanes de uma vez, cada
+    // lane com o seu próprio limite (instâncias: lane a lane). O resultado de
+    // cada lane é idêntico ao da consulta individual. Intervalo de cada lane:
+    // (t_min, p.t_max[l]).
+    template<int N>
+    void hit_packet(const RayPacket<N>& p, double t_min, bool* hits, HitRecord* recs) const;
+
+    template<int N>
+    void occluded_packet(const RayPacket<N>& p, double t_min, bool* occluded, int* occluders = nullptr) const;
+
+private:
+    // Estado da busca pelo acerto mais próximo de um raio
+    struct ClosestHit {
+        bool hit_anything;
+        double closest;
+        int best;
+        HitRecord rec;
+
+        explicit ClosestHit(double t_max = 0.0) : hit_anything(false), closest(t_max), best(-1) {}
+
+        // Com um acerto já registrado, aceita também t igual para desempatar pelo índice
+        double limit() const;
+        bool better(double t, int idx) const {
+            return !hit_anything || t < closest || (t == closest && idx < best);
+        }
+    };
+
+    const std::vector<Object*>* objects;
+    std::vector<AABB> prim_boxes;   // Usados apenas durante a construção
+    std::vector<char> prim_sphere;
+    int simd_width;
+
+    void build_recursive(int index, int begin, int end, int depth);
+    double leaf_cost(int spheres, int others) const;
+    void test_object(int idx, const Ray& r, double t_min, ClosestHit& state) const;
+    void hit_leaf(const BVHNode& node, const Ray& r, double t_min, ClosestHit& state) const;
+    bool occluded_leaf(const BVHNode& node, const Ray& r, double t_min, double t_max, int* occluder) const;
+    void hit_leaf_lanes(const BVHNode& node, const LaneRays& p, const Ray* rays, LaneMask lanes,
+                        double t_min, ClosestHit* state, Real* limit) const;
+    LaneMask occluded_leaf_lanes(const BVHNode& node, const LaneRays& p, const Ray* rays, LaneMask lanes,
+                                 double t_min, const double* t_max, const Real* limit, int* occluders) const;
+    void record_stats(uint64_t visited, uint64_t queries = 1) const;
+    double total_area() const;
+};
+
+#endif
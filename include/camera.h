@@ -5,6 +5,10 @@
 #include "ray.h"
 #include <cmath>
 
+// Razão largura/altura da resolução padrão (800x600). A câmera lida da cena
+// começa com ela; quem renderiza chama set_aspect com a da imagem.
+const double DEFAULT_CAMERA_ASPECT = 800.0 / 600.0;
+
 class Camera {
 public:
     Vec3 origin;          // Posição do olho
@@ -12,9 +16,18 @@ public:
     Vec3 horizontal;      // Vetor que representa a largura total da tela
     Vec3 vertical;        // Vetor que representa a altura total da tela
 
+    // Parâmetros de onde os vetores acima saíram (a posição é origin)
+    Vec3 target;
+    Vec3 up;
+    double fov;
+    double aspect;
+
+    Camera() : fov(0), aspect(DEFAULT_CAMERA_ASPECT) {}
+
     // vfov: abertura vertical em graus (field of view)
     // aspect: razão largura/altura da imagem
-    Camera(Vec3 lookfrom, Vec3 lookat, Vec3 vup, double vfov, double aspect) {
+    Camera(Vec3 lookfrom, Vec3 lookat, Vec3 vup, double vfov, double aspect)
+        : target(lookat), up(vup), fov(vfov), aspect(aspect) {
         origin = lookfrom;
 
         // 1. Converter FOV de graus para radianos e calcular altura da tela virtual
@@ -44,13 +57,34 @@ public:
         lower_left_corner = origin - (half_width * u) - (half_height * v) - w;
     }
 
+    // Refaz a tela virtual para outra razão largura/altura, com a mesma posição,
+    // alvo, up e abertura
+    void set_aspect(double new_aspect) {
+        *this = Camera(origin, target, up, fov, new_aspect);
+    }
+
     // Gera um raio para uma coordenada de textura (s, t) onde s,t variam de 0 a 1
-    Ray get_ray(double s, double t) {
+    Ray get_ray(double s, double t) const {
         // Direção = Ponto no alvo - Origem
         // Ponto no alvo = Canto + (s * largura) + (t * altura)
         Vec3 direction = lower_left_corner + (s * horizontal) + (t * vertical) - origin;
         return Ray(origin, direction.normalize());
     }
+
+    // Diferenciais do raio de get_ray(s, t) para passos ds e dt na tela
+    // (um pixel: ds = 1/nx, dt = -1/ny). A origem é a mesma para todos os raios.
+    void ray_differential(double s, double t, double ds, double dt, RayDifferential& diff) const {
+        Vec3 d = lower_left_corner + (s * horizontal) + (t * vertical) - origin;
+        double dd = dot(d, d);
+        double len = std::sqrt(dd);
+        // Derivada de d / |d| na direção e: (e * (d.d) - d * (d.e)) / |d|^3
+        Vec3 ex = ds * horizontal;
+        Vec3 ey = dt * vertical;
+        diff.dOdx = Vec3(0, 0, 0);
+        diff.dOdy = Vec3(0, 0, 0);
+        diff.dDdx = (ex * dd - d * dot(d, ex)) / (dd * len);
+        diff.dDdy = (ey * dd - d * dot(d, ey)) / (dd * len);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RT_COUNTERS_TSC 1
+#include <x86intrin.h>
+#endif
+
+// Contadores do caminho quente: raios por tipo, testes de interseção por tipo
+// de primitiva e tempo por fase de cast_ray. Só existem na compilação com
+// "make COUNTERS=1" (que define RT_COUNTERS); nas demais, RT_COUNT e
+// RT_PHASE não geram código.
+//
+// Cada thread soma nos seus próprios contadores, sem atômicos nem travas;
+// counters_total() junta os de todas as threads e deve ser chamada com a
+// renderização parada.
+
+// Fases de cast_ray. Os tempos são exclusivos: uma fase aninhada em outra
+// (a textura dentro do sombreamento) não é contada duas vezes.
+enum CounterPhase {
+    PHASE_PRIMARY,   // Interseção dos raios primários
+    PHASE_SECONDARY, // Interseção dos raios de reflexão e refração
+    PHASE_SHADOW,    // Raios de sombra
+    PHASE_SHADING,   // Iluminação local e criação dos raios filhos
+    PHASE_TEXTURE,   // Amostragem de texturas
+    NUM_PHASES,
+    PHASE_NONE = NUM_PHASES
+};
+
+const char* counter_phase_name(CounterPhase phase);
+
+struct alignas(64) RayCounters {
+    uint64_t primary_rays = 0;
+    uint64_t shadow_rays = 0;
+    uint64_t reflection_rays = 0;
+    uint64_t refraction_rays = 0;
+    uint64_t sphere_tests = 0;     // Esferas testadas (uma por esfera em um lote SIMD)
+    uint64_t polyhedron_tests = 0; // Chamadas de hit/occluded de poliedros
+    uint64_t shadow_cache_tests = 0; // Raios de sombra testados contra o último bloqueador da luz
+    uint64_t shadow_cache_hits = 0;  // ... e bloqueados por ele, sem percorrer a BVH
+    uint64_t phase_ns[NUM_PHASES] = {}; // Preenchido por counters_total()
+
+    // Tempo por fase nas unidades de counters_clock(), e a fase em andamento
+    // nesta thread (usados por PhaseTimer)
+    uint64_t phase_ticks[NUM_PHASES] = {};
+    int current_phase = PHASE_NONE;
+    uint64_t phase_start = 0;
+
+    uint64_t rays() const { return primary_rays + shadow_rays + reflection_rays + refraction_rays; }
+    void add(const RayCounters& o);
+};
+
+#ifdef RT_COUNTERS
+const bool COUNTERS_ENABLED = true;
+#else
+const bool COUNTERS_ENABLED = false;
+#endif
+
+// Soma dos contadores de todas as threads, com os tempos convertidos para ns
+RayCounters counters_total();
+
+// Zera os contadores de todas as threads
+void counters_reset();
+
+// Relógio das fases: o contador de ciclos (TSC) em x86, que custa metade de
+// uma leitura de steady_clock, convertido para ns em counters_total()
+inline uint64_t counters_clock() {
+#ifdef RT_COUNTERS_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#ifdef RT_COUNTERS
+
+// Contadores da thread atual (alocados e registrados no primeiro uso)
+RayCounters& register_thread_counters();
+inline thread_local RayCounters* tls_counters = nullptr;
+
+inline RayCounters& thread_counters() {
+    RayCounters* c = tls_counters;
+    return c ? *c : register_thread_counters();
+}
+
+// Mede a fase enquanto existir. O tempo até aqui vai para a fase que estava
+// em andamento, que volta a contar na destruição.
+class PhaseTimer {
+public:
+    explicit PhaseTimer(CounterPhase phase) : c(thread_counters()), previous(c.current_phase) {
+        switch_to(phase);
+    }
+    ~PhaseTimer() { switch_to(previous); }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    RayCounters& c;
+    int previous;
+
+    void switch_to(int phase) {
+        uint64_t now = counters_clock();
+        if (c.current_phase != PHASE_NONE) c.phase_ticks[c.current_phase] += now - c.phase_start;
+        c.current_phase = phase;
+        c.phase_start = now;
+    }
+};
+
+#define RT_COUNT(field, n) (thread_counters().field += (n))
+#define RT_PHASE(phase) PhaseTimer rt_phase_timer_(phase)
+
+#else
+
+#define RT_COUNT(field, n) ((void)0)
+#define RT_PHASE(phase) ((void)0)
+
+#endif
+
+// Raios traçados até agora pela thread atual (0 sem RT_COUNTERS)
+inline uint64_t thread_ray_count() {
+#ifdef RT_COUNTERS
+    return thread_counters().rays();
+#else
+    return 0;
+#endif
+}
+
+#endif
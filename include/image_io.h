@@ -0,0 +1,76 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "render.h"
+
+enum ImageFormat {
+    PPM_BINARY, // P6: 3 bytes por pixel
+    PPM_ASCII   // P3: texto, um pixel por linha (formato antigo)
+};
+
+// Mesma conversão usada desde o início: int(255.99 * c), com c em [0, 1]
+inline unsigned char color_to_byte(double c) {
+    return (unsigned char)int(255.99 * c);
+}
+
+// Escreve o framebuffer inteiro: a imagem é montada em um único buffer
+// contíguo (cabeçalho + pixels) e gravada com uma única escrita.
+bool write_ppm(const std::string& filename, const Framebuffer& fb, ImageFormat format);
+
+// Mapa de calor de fb.cost em cores falsas (preto, azul, vermelho, amarelo,
+// branco). scale é o custo que vira branco, normalmente o percentil 99.5 dos
+// pixels, para que poucos pixels muito caros não escureçam o resto.
+bool write_heatmap(const std::string& filename, const Framebuffer& fb, double scale);
+
+// Resumo de fb.cost: máximo, média e o percentil 99.5
+struct CostSummary {
+    double max, mean, p995;
+};
+CostSummary summarize_cost(const Framebuffer& fb);
+
+// Imagem parcial, renderizada com --region: o cabeçalho do PPM leva num
+// comentário a posição dela na imagem completa. Um PPM sem o comentário é
+// tratado como uma imagem completa.
+struct PPMRegion {
+    int x0, y0, width, height;
+    int image_width, image_height;
+};
+bool read_ppm_region(const std::string& filename, PPMRegion& region);
+
+// Junta imagens parciais de 8 bits (P3 ou P6) na imagem completa, gravada em
+// P6. Partes que se sobrepõem são aceitas (vale a última); falha se elas são
+// de imagens de tamanhos diferentes ou se algum pixel fica sem parte.
+bool merge_ppm_parts(const std::vector<std::string>& parts, const std::string& output);
+
+// Escrita incremental para imagens grandes: o cabeçalho é gravado na abertura e
+// cada faixa de linhas é gravada assim que ela e todas as anteriores estiverem prontas.
+// rows_ready pode ser chamado de qualquer thread, em qualquer ordem.
+class PPMStreamWriter {
+public:
+    PPMStreamWriter() : file(nullptr), fb(nullptr), format(PPM_BINARY), next_row(0), failed(false) {}
+    ~PPMStreamWriter() { close(); }
+
+    bool open(const std::string& filename, const Framebuffer& framebuffer, ImageFormat fmt);
+
+    // As linhas [y0, y1) do framebuffer estão finalizadas
+    void rows_ready(int y0, int y1);
+
+    // Retorna false se alguma escrita falhou ou se faltaram linhas
+    bool close();
+
+private:
+    std::FILE* file;
+    const Framebuffer* fb;
+    ImageFormat format;
+    std::mutex mtx;
+    std::vector<char> done;
+    int next_row;
+    bool failed;
+    std::string buffer;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "object.h"
+
+// Transformação afim: p' = L p + t, guardada como as três linhas de [L | t]
+struct Affine {
+    double m[3][4];
+
+    Vec3 point(const Vec3& p) const {
+        return Vec3(Real(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3]),
+                    Real(m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3]),
+                    Real(m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]));
+    }
+
+    // Só a parte linear (direções)
+    Vec3 vector(const Vec3& v) const {
+        return Vec3(Real(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z),
+                    Real(m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z),
+                    Real(m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z));
+    }
+
+    // Transposta da parte linear. Aplicada à inversa de uma transformação,
+    // leva normais do espaço do objeto para o da cena.
+    Vec3 transpose_vector(const Vec3& v) const {
+        return Vec3(Real(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z),
+                    Real(m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z),
+                    Real(m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z));
+    }
+
+    // A parte linear é a identidade (só translação)?
+    bool translation_only() const {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                if (m[i][j] != (i == j ? 1.0 : 0.0)) return false;
+            }
+        }
+        return true;
+    }
+
+    // Inversa em out; false se a parte linear é (quase) singular
+    bool inverse(Affine& out) const;
+};
+
+// Instância de um protótipo (Scene::prototypes): a mesma geometria em outra
+// posição, orientação e escala, com pigmento e acabamento próprios. Guarda só
+// a transformação e a caixa, então uma cena com muitas cópias de um poliedro
+// ocupa memória conforme a geometria distinta, não conforme as cópias.
+//
+// O raio é levado para o espaço do protótipo sem normalizar a direção, então
+// o t do acerto vale nos dois espaços; ponto e normal voltam para a cena.
+class Instance : public Object {
+public:
+    const Object* prototype;
+    int prototypeIndex; // Em Scene::prototypes
+    Affine to_object;   // Cena -> protótipo (inversa da transformação do arquivo)
+    int pigmentIndex;   // -1: usa o do protótipo
+    int finishIndex;    // -1: usa o do protótipo
+
+    Instance(const Object* proto, int protoIdx, const Affine& toObject, int pigIdx, int finIdx)
+        : prototype(proto), prototypeIndex(protoIdx), to_object(toObject), pigmentIndex(pigIdx),
+          finishIndex(finIdx), bounded(false), translation(toObject.translation_only()) {}
+
+    virtual ObjectType type() const { return OBJ_INSTANCE; }
+
+    // Caixa na cena: os cantos da caixa do protótipo transformados. O
+    // protótipo precisa ter sido compilado antes.
+    virtual void compile();
+
+    // Como compile(), mas com a caixa já conhecida (cena compilada). box nulo: não limitado.
+    void compile(const AABB* box);
+
+    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const;
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const;
+
+    virtual bool bounding_box(AABB& box) const {
+        if (!bounded) return false;
+        box = bounds;
+        return true;
+    }
+
+private:
+    AABB bounds;
+    bool bounded;
+    bool translation; // to_object só translada: direção e normal não mudam
+
+    Ray to_local(const Ray& r) const {
+        if (translation) return Ray(to_object.point(r.origin), r.direction);
+        return Ray(to_object.point(r.origin), to_object.vector(r.direction));
+    }
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef LIGHT_GRID_H
+#define LIGHT_GRID_H
+
+#include <limits>
+#include <vector>
+#include "vec3.h"
+#include "aabb.h"
+
+// Luzes
+struct Light {
+    Vec3 position;
+    Vec3 color;
+    double attenuation[3];
+    // Distância a partir da qual a luz é ignorada (ver light_radius);
+    // infinita a menos que a cena use um corte de intensidade
+    double radius = std::numeric_limits<double>::infinity();
+};
+
+// Distância em que a intensidade atenuada da luz (maior canal de cor dividido
+// por a0 + a1 d + a2 d^2) cai para cutoff. Infinita com cutoff <= 0 ou sem
+// atenuação com a distância; zero se a luz nunca passa de cutoff.
+double light_radius(const Light& light, double cutoff);
+
+// Grade uniforme sobre as esferas de alcance das luzes: cada célula guarda,
+// em ordem crescente, os índices das luzes cujo alcance toca a célula. Luzes
+// de alcance infinito entram em todas as células e valem também para pontos
+// fora da grade. Assim cada ponto de sombreamento considera só as luzes que
+// podem alcançá-lo, em vez de todas as luzes da cena.
+class LightGrid {
+public:
+    static const int MAX_DIM = 64; // Células por eixo, no máximo
+
+    LightGrid() : dims{0, 0, 0}, inv_cell{0, 0, 0} {}
+
+    void build(const std::vector<Light>& lights);
+    void clear();
+
+    bool empty() const { return cell_start.empty(); }
+
+    // Luzes que podem alcançar p (count recebe quantas)
+    const int* candidates(const Vec3& p, int& count) const;
+
+    int cell_count() const { return dims[0] * dims[1] * dims[2]; }
+    int dim(int axis) const { return dims[axis]; }
+    double mean_lights_per_cell() const;
+    int max_lights_per_cell() const;
+
+private:
+    AABB bounds;
+    int dims[3];
+    double inv_cell[3]; // Células por unidade de comprimento em cada eixo
+    std::vector<int> cell_start;  // Início de cada célula em cell_lights (mais uma posição final)
+    std::vector<int> cell_lights;
+    std::vector<int> unbounded;   // Luzes de alcance infinito (pontos fora da grade)
+
+    int cell_coord(double v, int axis) const;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Arquivo somente leitura mapeado em memória (mmap). Em sistemas sem mmap o
+// conteúdo é lido inteiro para um buffer, com a mesma interface.
+class MappedFile {
+public:
+    MappedFile() : ptr(nullptr), length(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    const unsigned char* data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* ptr;
+    size_t length;
+    std::vector<unsigned char> fallback; // Usado quando não há mmap
+};
+
+#endif
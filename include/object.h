@@ -2,19 +2,44 @@
 #define OBJECT_H
 
 #include "ray.h"
+#include "aabb.h"
 
 // Estrutura para armazenar dados da colisão
-struct HitRecord {
-    double t;         // Distância da origem
-    Vec3 p;           // Ponto de interseção
-    Vec3 normal;      // Normal da superfície no ponto p
+template<typename T>
+struct HitRecordT {
+    T t;              // Distância da origem
+    Vec3T<T> p;       // Ponto de interseção
+    Vec3T<T> normal;  // Normal da superfície no ponto p
     int pigmentIndex; // Índice do pigmento (conforme PDF)
     int finishIndex;  // Índice do acabamento (conforme PDF)
 };
 
+typedef HitRecordT<Real> HitRecord;
+
+// Tipo concreto do objeto, para código que trata primitivas em lote
+enum ObjectType { OBJ_SPHERE, OBJ_POLYHEDRON, OBJ_INSTANCE };
+
 class Object {
 public:
+    virtual ~Object() {}
+
+    virtual ObjectType type() const = 0;
+
+    // Pré-processamento depois da leitura da cena (ver Polyhedron::compile)
+    virtual void compile() {}
+
     virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const = 0;
+
+    // Consulta de oclusão (raios de sombra): só responde se há alguma interseção
+    // em (t_min, t_max), sem preencher ponto, normal ou índices.
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const {
+        HitRecord rec;
+        return hit(r, t_min, t_max, rec);
+    }
+
+    // Caixa envolvente do objeto. Retorna false se o objeto não é limitado
+    // (ex.: um plano), caso em que ele fica fora da BVH.
+    virtual bool bounding_box(AABB& box) const = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Objetos de um único tipo em blocos contíguos. Um objeto criado nunca muda de
+// endereço (Scene::objects aponta para eles), e todos são destruídos juntos com
+// o pool, em vez de um delete por objeto. Os blocos crescem geometricamente,
+// de FIRST_CHUNK até MAX_CHUNK objetos; reserve() permite um bloco exato
+// quando a quantidade é conhecida de antemão.
+template<typename T>
+class ObjectPool {
+public:
+    static const size_t FIRST_CHUNK = 64;
+    static const size_t MAX_CHUNK = 65536;
+
+    ObjectPool() : count(0) {}
+    ~ObjectPool() { clear(); }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        if (chunks.empty() || chunks.back().used == chunks.back().capacity) {
+            size_t last = chunks.empty() ? 0 : chunks.back().capacity;
+            add_chunk(last == 0 ? FIRST_CHUNK : (last >= MAX_CHUNK ? MAX_CHUNK : 2 * last));
+        }
+        Chunk& c = chunks.back();
+        T* obj = new (c.data + c.used) T(std::forward<Args>(args)...);
+        c.used++;
+        count++;
+        return obj;
+    }
+
+    // Garante que as próximas n criações fiquem num mesmo bloco
+    void reserve(size_t n) {
+        if (!chunks.empty() && chunks.back().capacity - chunks.back().used >= n) return;
+        add_chunk(n);
+    }
+
+    size_t size() const { return count; }
+
+    // Bytes dos blocos alocados (inclui posições ainda livres)
+    size_t memory_bytes() const {
+        size_t total = 0;
+        for (const Chunk& c : chunks) total += c.capacity * sizeof(T);
+        return total;
+    }
+
+    void clear() {
+        for (Chunk& c : chunks) {
+            for (size_t i = 0; i < c.used; i++) c.data[i].~T();
+            ::operator delete(c.data, std::align_val_t(alignof(T)));
+        }
+        chunks.clear();
+        count = 0;
+    }
+
+private:
+    struct Chunk {
+        T* data;
+        size_t used, capacity;
+    };
+
+    void add_chunk(size_t capacity) {
+        if (capacity == 0) return;
+        void* p = ::operator new(capacity * sizeof(T), std::align_val_t(alignof(T)));
+        chunks.push_back(Chunk{static_cast<T*>(p), 0, capacity});
+    }
+
+    std::vector<Chunk> chunks;
+    size_t count;
+};
+
+#endif
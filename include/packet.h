@@ -0,0 +1,87 @@
+#ifndef PACKET_H
+#define PACKET_H
+
+#include <cstdint>
+#include "ray.h"
+#include "aabb.h"
+
+// Máscara de lanes de um pacote: bit l ligado = lane l participa
+typedef uint64_t LaneMask;
+
+const int MAX_PACKET_LANES = 64;
+
+// Vista SoA das lanes de um pacote, que é o que os kernels de pacote recebem
+// (box_lanes, sphere_lanes_hit, Polyhedron::hit_lanes). n é múltiplo de 16,
+// então os vetores AVX2 nunca ficam pela metade.
+template<typename T>
+struct LaneRaysT {
+    int n;
+    const T *ox, *oy, *oz;
+    const T *dx, *dy, *dz;
+    const T *inv_dx, *inv_dy, *inv_dz;
+
+    RayT<T> ray(int l) const {
+        return RayT<T>(Vec3T<T>(ox[l], oy[l], oz[l]), Vec3T<T>(dx[l], dy[l], dz[l]));
+    }
+};
+
+typedef LaneRaysT<Real> LaneRays;
+
+// Pacote de N raios coerentes (ex.: um bloco 4x4 ou 8x8 de pixels).
+// Os raios ficam em rays[] para o sombreamento, que é feito lane a lane, e
+// também em SoA (origem, direção e inverso da direção, no mesmo tipo de Vec3)
+// para os testes de caixas e primitivas, que tratam as lanes de uma vez.
+template<int N>
+struct RayPacket {
+    static_assert(N % 16 == 0 && N <= MAX_PACKET_LANES, "pacotes de 16 a 64 raios");
+    static const int SIZE = N;
+
+    Ray rays[N];
+    double t_max[N];
+    bool active[N]; // Lanes inativas (fora do tile, sem acerto etc.) são ignoradas
+
+    alignas(32) Real ox[N], oy[N], oz[N];
+    alignas(32) Real dx[N], dy[N], dz[N];
+    alignas(32) Real inv_dx[N], inv_dy[N], inv_dz[N];
+
+    RayPacket() {
+        for (int l = 0; l < N; l++) {
+            active[l] = false;
+            t_max[l] = 0.0;
+        }
+    }
+
+    // Copia origem, direção e 1/direção para os vetores SoA; chamar depois de preencher rays[]
+    void finalize() {
+        for (int l = 0; l < N; l++) {
+            ox[l] = rays[l].origin.x;
+            oy[l] = rays[l].origin.y;
+            oz[l] = rays[l].origin.z;
+            dx[l] = rays[l].direction.x;
+            dy[l] = rays[l].direction.y;
+            dz[l] = rays[l].direction.z;
+            inv_dx[l] = Real(1.0 / rays[l].direction.x);
+            inv_dy[l] = Real(1.0 / rays[l].direction.y);
+            inv_dz[l] = Real(1.0 / rays[l].direction.z);
+        }
+    }
+
+    LaneMask active_mask() const {
+        LaneMask m = 0;
+        for (int l = 0; l < N; l++) {
+            if (active[l]) m |= LaneMask(1) << l;
+        }
+        return m;
+    }
+
+    LaneRays lanes() const {
+        return LaneRays{N, ox, oy, oz, dx, dy, dz, inv_dx, inv_dy, inv_dz};
+    }
+};
+
+// Teste de slabs de uma caixa contra as lanes do pacote, com as contas de
+// AABB::hit (em Real): devolve as lanes de `lanes` que atingem a caixa em
+// (t_min, limit[l]). Com AVX2, 4 lanes por instrução em double e 8 em float.
+LaneMask box_lanes(const AABB& box, const LaneRays& p, LaneMask lanes, double t_min, const Real* limit);
+
+#endif
@@ -2,90 +2,215 @@
 #define POLYHEDRON_H
 
 #include "object.h"
+#include "packet.h"
 #include <vector>
 #include <cmath>
 
 struct Face {
-    // Equação do plano: ax + by + cz + d = 0
-    double a, b, c, d;
+    // Equação do plano: normal . p + d = 0, com a normal unitária e o d
+    // original do arquivo (como sempre foi usado na interseção)
     Vec3 normal;
+    Real d;
 
-    Face(double a, double b, double c, double d) : a(a), b(b), c(c), d(d) {
-        normal = Vec3(a, b, c).normalize();
+    Face(double a, double b, double c, double d) : normal(Vec3(a, b, c).normalize()), d(Real(d)) {}
+
+    // Plano já normalizado (cena compilada)
+    Face(const Vec3& n, double d) : normal(n), d(Real(d)) {}
+};
+
+// Planos em layout SoA, alinhados a uma linha de cache: um vetor AVX2 por
+// componente, ou seja, 4 planos por bloco em double e 8 em float. Os planos do
+// poliedro compilado ficam em blocos consecutivos; o último bloco é completado
+// com planos neutros (normal nula, d = -1), que nunca cortam o raio.
+template<typename T>
+struct alignas(64) PlaneBlockT {
+    static const int WIDTH = 32 / sizeof(T);
+    T nx[WIDTH], ny[WIDTH], nz[WIDTH], d[WIDTH];
+};
+
+typedef PlaneBlockT<Real> PlaneBlock;
+
+// Faces e blocos de planos de todos os poliedros de uma cena, cada um em um
+// único vetor contíguo; cada poliedro guarda só as suas faixas. Os vetores
+// podem crescer (e mudar de endereço), então os poliedros guardam índices.
+struct FacePool {
+    std::vector<Face> faces;
+    std::vector<PlaneBlock> blocks;
+
+    size_t memory_bytes() const {
+        return faces.capacity() * sizeof(Face) + blocks.capacity() * sizeof(PlaneBlock);
     }
 };
 
+// Faces consecutivas de um poliedro, dentro do FacePool
+struct FaceRange {
+    const Face* first;
+    size_t count;
+
+    size_t size() const { return count; }
+    const Face& operator[](size_t i) const { return first[i]; }
+    const Face* begin() const { return first; }
+    const Face* end() const { return first + count; }
+};
+
 class Polyhedron : public Object {
 public:
-    std::vector<Face> faces;
     int pigmentIndex;
     int finishIndex;
 
-    Polyhedron(int pigIdx, int finIdx) : pigmentIndex(pigIdx), finishIndex(finIdx) {}
+    Polyhedron(int pigIdx, int finIdx, FacePool& facePool)
+        : pigmentIndex(pigIdx), finishIndex(finIdx), pool(&facePool),
+          first_face(0), num_faces(0), first_block(0), num_blocks(0), bounded(false) {}
 
     void add_face(double a, double b, double c, double d) {
-        faces.push_back(Face(a, b, c, d));
+        add_face(Face(a, b, c, d));
     }
 
-    // Algoritmo de interseção para Poliedros Convexos
-    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-        double t_enter = -1e9; // Começa no -infinito
-        double t_exit = 1e9;   // Começa no +infinito
-        const Face* enter_face = nullptr;
-
-        for (const auto& face : faces) {
-            // O denominador é o produto escalar da direção do raio com a normal do plano
-            // Isso diz o quão alinhado o raio está com o plano)
-            double denom = dot(face.normal, r.direction);
-            
-            // Numerador da equação de interseção t = -(P0 . N + d) / (D . N)
-            double dist = -(dot(face.normal, r.origin) + face.d);
-
-            // Raio paralelo ao plano
-            if (std::abs(denom) < 1e-6) {
-                // Se o raio é paralelo e a origem está "fora" do plano, ele erra o objeto todo
-                if (dist < 0) return false; 
-            } else {
-                double t = dist / denom;
-
-                if (denom < 0) {
-                    // Entrando no semi-espaço
-                    if (t > t_enter) {
-                        t_enter = t;
-                        enter_face = &face;
-                    }
-                } else {
-                    // Saindo do semi-espaço
-                    if (t < t_exit) {
-                        t_exit = t;
+    // As faces de um poliedro ficam juntas no pool: se outro poliedro recebeu
+    // faces desde a última chamada, as deste são movidas para o final
+    void add_face(const Face& f) {
+        std::vector<Face>& all = pool->faces;
+        if (num_faces == 0) {
+            first_face = all.size();
+        } else if (first_face + num_faces != all.size()) {
+            std::vector<Face> mine(all.begin() + first_face, all.begin() + first_face + num_faces);
+            first_face = all.size();
+            all.insert(all.end(), mine.begin(), mine.end());
+        }
+        all.push_back(f);
+        num_faces++;
+    }
+
+    FaceRange faces() const { return FaceRange{pool->faces.data() + first_face, num_faces}; }
+
+    // Blocos de planos que compile() ocupa no pool
+    size_t block_count() const { return (num_faces + PlaneBlock::WIDTH - 1) / PlaneBlock::WIDTH; }
+
+    virtual ObjectType type() const { return OBJ_POLYHEDRON; }
+
+    // Monta os blocos de planos (no FacePool) e a caixa envolvente. hit() e occluded() usam
+    // apenas os dados compilados, então precisa ser chamada depois do último
+    // add_face (Scene::build_acceleration faz isso).
+    virtual void compile();
+
+    // Como compile(), mas com a caixa já conhecida (cena compilada, ver
+    // scene_binary.h), sem a enumeração de vértices. box nulo: não limitado.
+    void compile(const AABB* box);
+
+    // Algoritmo de interseção para Poliedros Convexos: o raio está dentro do
+    // poliedro entre a última entrada e a primeira saída pelos semi-espaços
+    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const;
+
+    // Mesmo teste de hit(), sem a face de entrada e com saídas antecipadas
+    // (t_enter só cresce e t_exit só diminui, então o intervalo vazio é definitivo)
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const;
+
+    // Versões para pacotes (BVH::hit_packet): os mesmos testes para as lanes
+    // de `lanes`, cada uma com o seu limite t_max[l]; devolvem as lanes que
+    // acertam. hit_lanes deixa t e a face de entrada de cada uma em t_out e
+    // face_out, para set_hit_record.
+    LaneMask hit_lanes(const LaneRays& p, LaneMask lanes, double t_min, const Real* t_max,
+                       Real* t_out, int* face_out) const;
+    LaneMask occluded_lanes(const LaneRays& p, LaneMask lanes, double t_min, const Real* t_max) const;
+
+    // Preenche o registro de uma interseção em t pela face de entrada enter_face (-1: nenhuma)
+    void set_hit_record(const Ray& r, Real t, int enter_face, HitRecord& rec) const;
+
+    virtual bool bounding_box(AABB& box) const {
+        if (!bounded) return false;
+        box = bounds;
+        return true;
+    }
+
+    // Poliedros com pelo menos tantas faces testam a própria caixa antes dos planos
+    static const int BOX_TEST_MIN_FACES = 8;
+
+private:
+    FacePool* pool;
+    size_t first_face, num_faces;   // Faixa em pool->faces
+    size_t first_block, num_blocks; // Faixa em pool->blocks (montada por compile)
+    AABB bounds;
+    bool bounded;
+
+    // Intervalo [t_enter, t_exit] do raio dentro do poliedro (ver polyhedron.cpp)
+    bool slab_interval(const Ray& r, double t_min, double t_max,
+                       Real& t_enter, Real& t_exit, int& enter_face) const;
+    bool box_rejects(const Ray& r, double t_min, double t_max) const;
+    LaneMask lanes_interval(const LaneRays& p, LaneMask lanes, double t_min, const Real* t_max,
+                            Real* t_enter, Real* t_exit, int* enter_face) const;
+    AABB padded_bounds() const;
+
+    // A caixa é obtida a partir dos vértices: cada trio de planos define um
+    // ponto candidato, que é vértice se estiver dentro de todos os semi-espaços.
+    // Usa os mesmos planos que hit() (normal unitária com o d original).
+    // Chamada uma vez, em compile().
+    bool compute_bounds(AABB& box) const {
+        FaceRange planes = faces();
+        if (planes.size() < 4 || !is_bounded()) return false;
+
+        const double eps = 1e-7;
+        AABB b;
+        size_t n = planes.size();
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = i + 1; j < n; j++) {
+                Vec3 nij = cross(planes[i].normal, planes[j].normal);
+                for (size_t k = j + 1; k < n; k++) {
+                    // Regra de Cramer para n_i.p = -d_i, n_j.p = -d_j, n_k.p = -d_k
+                    double det = dot(nij, planes[k].normal);
+                    if (std::abs(det) < 1e-12) continue;
+
+                    Vec3 p = (cross(planes[j].normal, planes[k].normal) * -planes[i].d +
+                              cross(planes[k].normal, planes[i].normal) * -planes[j].d +
+                              nij * -planes[k].d) / det;
+
+                    bool inside = true;
+                    for (const auto& f : planes) {
+                        if (double(dot(f.normal, p)) + f.d > eps * (1.0 + p.length())) {
+                            inside = false;
+                            break;
+                        }
                     }
+                    if (inside) b.expand(p);
                 }
             }
         }
+        if (b.empty()) return false;
 
-        // Verifica se a interseção é válida
-        if (t_enter < t_exit && t_exit > t_min) {
-            double t = t_enter;
-            // Se a entrada está atrás da câmera, verificamos a saída (estamos dentro do objeto)
-            if (t < t_min) {
-                t = t_exit;
-                 // Nota: Se estamos saindo, a normal deveria ser invertida, 
-                 // mas para convexos opacos simples, focamos na entrada.
-            }
+        box = b;
+        return true;
+    }
 
-            if (t > t_min && t < t_max) {
-                rec.t = t;
-                rec.p = r.pointAt(t);
-                if (enter_face) rec.normal = enter_face->normal;
-                else rec.normal = faces[0].normal; // Fallback
-                
-                rec.pigmentIndex = pigmentIndex;
-                rec.finishIndex = finishIndex;
-                return true;
+    // O poliedro é limitado se nenhuma direção v satisfaz n_i.v <= 0 para todas as faces.
+    // Basta testar as direções candidatas a raio extremo desse cone: interseções
+    // de pares de planos, normais invertidas e direções dentro de cada plano.
+    bool is_bounded() const {
+        FaceRange planes = faces();
+        std::vector<Vec3> candidates;
+        const Vec3 axes[3] = {Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 1)};
+        for (size_t i = 0; i < planes.size(); i++) {
+            candidates.push_back(-planes[i].normal);
+            for (const Vec3& a : axes) candidates.push_back(cross(planes[i].normal, a));
+            for (size_t j = i + 1; j < planes.size(); j++) {
+                candidates.push_back(cross(planes[i].normal, planes[j].normal));
             }
         }
 
-        return false;
+        for (const Vec3& c : candidates) {
+            double len = c.length();
+            if (len < 1e-9) continue;
+            Vec3 dirs[2] = {c / len, -c / len};
+            for (const Vec3& v : dirs) {
+                bool escapes = true;
+                for (const auto& f : planes) {
+                    if (dot(f.normal, v) > 1e-9) {
+                        escapes = false;
+                        break;
+                    }
+                }
+                if (escapes) return false;
+            }
+        }
+        return true;
     }
 };
 
@@ -3,24 +3,35 @@
 
 #include "vec3.h"
 
-class Ray {
+template<typename T>
+class RayT {
 public:
-    Vec3 origin;
-    Vec3 direction;
+    Vec3T<T> origin;
+    Vec3T<T> direction;
 
-    Ray() {}
+    RayT() {}
     
-    Ray(const Vec3& origin, const Vec3& direction) 
+    RayT(const Vec3T<T>& origin, const Vec3T<T>& direction) 
         : origin(origin), direction(direction) {}
 
-    const Vec3& getOrigin() const { return origin; }
-    const Vec3& getDirection() const { return direction; }
+    const Vec3T<T>& getOrigin() const { return origin; }
+    const Vec3T<T>& getDirection() const { return direction; }
 
     // Calcula o ponto 3D no raio dado um parâmetro t
     // P(t) = Origem + t * Direção
-    Vec3 pointAt(double t) const {
+    Vec3T<T> pointAt(T t) const {
         return origin + (direction * t);
     }
 };
 
+typedef RayT<Real> Ray;
+
+// Diferenciais de um raio: quanto origem e direção variam ao passar para o
+// pixel vizinho em x e em y (Igehy, "Tracing Ray Differentials", 1999).
+// Usados para estimar a área coberta por um pixel na superfície atingida.
+struct RayDifferential {
+    Vec3 dOdx, dOdy;
+    Vec3 dDdx, dDdy;
+};
+
 #endif
\ No newline at end of file
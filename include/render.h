@@ -0,0 +1,121 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include "vec3.h"
+#include "ray.h"
+#include "scene.h"
+#include "tile_scheduler.h"
+#include "sphere_batch.h"
+
+// Imagem em memória, escrita em disco uma única vez no final
+struct Framebuffer {
+    int width, height;
+    std::vector<Vec3> pixels; // Linha 0 = topo da imagem (ordem do arquivo PPM)
+    std::vector<float> cost;  // Custo de cada pixel para o mapa de calor; vazio = não medido
+
+    // Imagem completa, que define a câmera, e a posição deste framebuffer nela.
+    // Com --region o framebuffer cobre só um retângulo [x0, x0 + width) x
+    // [y0, y0 + height) da imagem; normalmente, a imagem inteira.
+    int image_width, image_height;
+    int x0 = 0, y0 = 0;
+
+    Framebuffer(int w, int h) : width(w), height(h), pixels(w * h), image_width(w), image_height(h) {}
+
+    bool is_region() const { return x0 != 0 || y0 != 0 || width != image_width || height != image_height; }
+
+    Vec3& at(int x, int y) { return pixels[y * width + x]; }
+    const Vec3& at(int x, int y) const { return pixels[y * width + x]; }
+};
+
+// Medida de custo do mapa de calor (--heatmap)
+enum HeatMetric {
+    HEAT_TIME, // Nanossegundos gastos no pixel
+    HEAT_RAYS  // Raios traçados para o pixel (só com RT_COUNTERS, ver counters.h)
+};
+
+// Parâmetros de renderização vindos da linha de comando
+struct RenderSettings {
+    int width = 800;
+    int height = 600;
+    int threads = 0;     // 0 = número de núcleos da máquina
+    int tile_size = 32;
+    bool stats = false;  // Imprime estatísticas da BVH
+    SimdLevel simd = SIMD_AUTO;
+    int packet_size = 0; // 4 ou 8: traça blocos 4x4/8x8 de raios primários como pacote; 0 = raio a raio
+    bool ascii = false;  // Saída em P3 (texto) em vez de P6 (binário)
+    bool stream = false; // Grava as linhas no arquivo à medida que ficam prontas
+    TextureFilter texture_filter = TEX_TRILINEAR;
+    int aa_samples = 1;          // Máximo de amostras por pixel no antialiasing adaptativo (1 = desligado)
+    double aa_threshold = 0.05;  // Contraste/erro a partir do qual um pixel recebe mais amostras
+    int max_depth = 5;           // Profundidade máxima da árvore de raios
+    double min_weight = 0.004;   // Corte de ramos de reflexão/refração por peso (kr/kt acumulado), ~1/255
+    bool progressive = false;    // Passadas de blocos 8x8 até 1x1, com uma imagem a cada passada
+    double time_budget = 0;      // Segundos; no modo progressivo, para quando acabar (0 = sem limite)
+    bool progress = true;        // Mensagens de progresso em stdout
+    HeatMetric heat_metric = HEAT_TIME; // O que fb.cost acumula, quando não está vazio
+    double light_cutoff = 0;     // Ignora luzes com intensidade atenuada abaixo disto (0 = nenhuma)
+    int light_samples = 0;       // > 0: sombras só para este número de luzes sorteadas por ponto
+    bool shadow_cache = true;    // Testa primeiro o último objeto que bloqueou cada luz
+    bool wavefront = false;      // Traça cada tile uma geração de raios por vez (ver render_tile)
+    bool has_region = false;     // Renderiza só region (--region), em coordenadas da imagem
+    Tile region = {0, 0, 0, 0};
+};
+
+// Contadores de uma renderização
+struct RenderStats {
+    uint64_t primary_samples = 0; // Uma amostra por pixel na primeira passada
+    uint64_t extra_samples = 0;   // Amostras adicionais do antialiasing adaptativo
+    uint64_t refined_pixels = 0;  // Pixels que receberam amostras adicionais
+};
+
+// diff (opcional) são os diferenciais do raio, usados para filtrar texturas
+Vec3 cast_ray(const Ray& r, const Scene& scene, int depth, const RayDifferential* diff = nullptr);
+
+// Cor do ponto rec atingido pelo raio r (iluminação local, sombras, reflexão e refração).
+// light_visible, se não for nulo, traz o resultado já calculado dos raios de
+// sombra (um por luz); caso contrário eles são traçados aqui.
+Vec3 shade_hit(const Ray& r, const HitRecord& rec, const Scene& scene, int depth, const bool* light_visible,
+               const RayDifferential* diff = nullptr);
+
+// Renderiza um único tile (um raio por pixel) direto no framebuffer.
+// Com settings.wavefront, os raios do tile inteiro avançam juntos, uma geração
+// por vez, com os pontos atingidos ordenados por material antes do sombreamento.
+// Se fb.cost não estiver vazio, soma nele o custo de cada pixel (no modo
+// pacote, o custo do bloco é dividido igualmente entre os pixels; no wavefront,
+// o do tile).
+void render_tile(const Scene& scene, const RenderSettings& settings, const Tile& tile, Framebuffer& fb);
+
+// Antialiasing adaptativo de um tile já renderizado. Pixels cujo contraste com
+// os vizinhos em base (a primeira passada) passa de aa_threshold recebem amostras
+// adicionais, até aa_samples no total ou até a média estabilizar.
+void refine_tile(const Scene& scene, const RenderSettings& settings, const Tile& tile,
+                 const Framebuffer& base, Framebuffer& fb, RenderStats& stats);
+
+// Chamado quando as linhas [y0, y1) do framebuffer ficam prontas (de qualquer thread)
+typedef std::function<void(int y0, int y1)> RowsReady;
+
+// Renderiza a imagem inteira distribuindo os tiles entre as threads do escalonador
+// Com aa_samples > 1 há uma segunda passada de antialiasing, e as linhas só são
+// avisadas como prontas nela. stats (opcional) recebe os contadores.
+void render_image(const Scene& scene, const RenderSettings& settings,
+                  TileScheduler& scheduler, Framebuffer& fb, const RowsReady& rows_ready = RowsReady(),
+                  RenderStats* stats = nullptr);
+
+// Fim de uma passada do modo progressivo: fb tem a melhor imagem até agora.
+// complete é false se a renderização foi interrompida durante esta passada.
+typedef std::function<void(int pass, int passes, bool complete)> PassDone;
+
+// Renderização progressiva: passadas com uma amostra por bloco de 8x8, 4x4, 2x2
+// e 1x1 pixels (mais o antialiasing, se ligado), cada uma refinando a anterior.
+// Ao fim da passada 1x1 a imagem é a mesma de render_image. Para entre tiles
+// (ou entre linhas de um tile) quando *cancel fica verdadeiro ou quando
+// time_budget se esgota; retorna false nesse caso.
+bool render_progressive(const Scene& scene, const RenderSettings& settings, TileScheduler& scheduler,
+                        Framebuffer& fb, const PassDone& pass_done, const std::atomic<bool>* cancel,
+                        RenderStats* stats = nullptr);
+
+#endif
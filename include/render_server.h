@@ -0,0 +1,35 @@
+#ifndef RENDER_SERVER_H
+#define RENDER_SERVER_H
+
+#include <string>
+#include "render.h"
+
+// Servidor de renderização (--serve): um processo que fica de pé atendendo
+// pedidos por um socket Unix local, para quem faz muitas prévias pequenas das
+// mesmas cenas. As cenas lidas (objetos, BVH, luzes e as texturas já
+// amostradas) ficam em memória entre pedidos, indexadas pelo caminho e pela
+// data de modificação do arquivo; uma cena ou textura alterada é lida de novo.
+//
+// Protocolo: cada conexão manda uma linha com campos separados por tabulação
+// e recebe uma linha de resposta, começando por "ok" ou "erro".
+//   render <cena> <saida.ppm> [opções]   renderiza e grava a imagem
+//   status                               fila, pedidos atendidos e latências
+//   stop                                 termina os pedidos na fila e encerra
+// Opções de render: --width W, --height H, --camera ex ey ez ax ay az ux uy uz
+// fov, --aa N, --aa-threshold T, --max-depth N, --min-weight W,
+// --texture-filter F e --ascii. As demais (threads, SIMD, pacote, wavefront,
+// luzes) valem para o servidor todo e vêm da sua linha de comando.
+// Caminhos relativos são resolvidos a partir do diretório do servidor.
+//
+// Cada conexão é lida e interpretada numa thread própria, então um cliente
+// lento não segura os outros. Os pedidos entram numa fila e são renderizados
+// um de cada vez, cada um com todas as threads do escalonador, que é o mesmo
+// para todos: com imagens pequenas, o que importa é a latência de cada pedido.
+
+// Atende pedidos em socket_path até receber "stop", SIGINT ou SIGTERM.
+// settings são as opções padrão de cada pedido; max_scenes é quantas cenas
+// ficam em memória (as usadas há mais tempo saem primeiro). Retorna o código
+// de saída do processo.
+int run_render_server(const std::string& socket_path, const RenderSettings& settings, int max_scenes);
+
+#endif
@@ -7,39 +7,12 @@
 #include "camera.h"
 #include "object.h" 
 #include "sphere.h"
-
-struct Texture {
-    int width, height;
-    std::vector<Vec3> pixels; // Armazena RGB
-    
-    // Função para pegar a cor nas coordenadas (u, v)
-    Vec3 sample(double u, double v) const {
-        if (pixels.empty()) return Vec3(1, 0, 1); // Rosa de erro
-
-        // Tratamento de repetição (tiling)
-        u = u - floor(u);
-        v = v - floor(v);
-
-        // Mapeia 0..1 para 0..width-1
-        int i = int(u * width);
-        int j = int(v * height);
-
-        // Clamping de segurança
-        if (i < 0) i = 0;
-        if (j < 0) j = 0;
-        if (i >= width) i = width - 1;
-        if (j >= height) j = height - 1;
-
-        return pixels[j * width + i];
-    }
-};
-
-// Luzes
-struct Light {
-    Vec3 position;
-    Vec3 color;
-    double attenuation[3]; 
-};
+#include "polyhedron.h"
+#include "instance.h"
+#include "object_pool.h"
+#include "bvh.h"
+#include "texture_cache.h"
+#include "light_grid.h"
 
 // Pigmentos 
 enum PigmentType { SOLID, CHECKER, TEXMAP };
@@ -53,9 +26,10 @@ struct Pigment {
     std::string tex_file;   
     double tex_params[8];   // Parâmetros P0 e P1 para projeção planar 
     
-    Texture* textureData;   // Ponteiro para a imagem carregada
+    // Imagem compartilhada pelo cache de texturas (lida na primeira amostragem)
+    std::shared_ptr<TextureHandle> textureData;
 
-    Pigment() : textureData(nullptr) {}
+    Pigment() {}
 };
 
 struct Finish {
@@ -69,18 +43,116 @@ struct Scene {
     std::vector<Light> lights;
     std::vector<Pigment> pigments;
     std::vector<Finish> finishes;
-    std::vector<Object*> objects;
+    std::vector<Object*> objects; // Ordem do arquivo (define os desempates); aponta para os pools
+    std::vector<Object*> prototypes; // Geometria só visível por instâncias (fora de objects e da BVH)
+
+    // Armazenamento dos objetos: um pool contíguo por tipo e um único vetor de
+    // faces/planos para todos os poliedros, liberados de uma vez com a cena
+    ObjectPool<Sphere> sphere_pool;
+    ObjectPool<Polyhedron> polyhedron_pool;
+    ObjectPool<Instance> instance_pool;
+    FacePool face_pool;
     
     Vec3 ambient_light; 
 
-    Scene() : camera(nullptr) {}
+    BVH bvh; // Estrutura de aceleração sobre objects (montada por build_acceleration)
+
+    TextureFilter texture_filter; // Filtro dos pigmentos texmap
+    int max_depth;                // Profundidade máxima de reflexão/refração
+    double min_weight;            // Ramos com produto de kr/kt abaixo disto não são traçados
+    double light_cutoff;          // Luzes com intensidade atenuada abaixo disto são ignoradas (0 = nenhuma)
+    int light_samples;            // > 0: luzes sorteadas por ponto conforme a contribuição estimada
+    bool shadow_cache;            // Testa primeiro o último objeto que bloqueou cada luz (por thread)
+
+    LightGrid light_grid; // Luzes que alcançam cada região (só com light_cutoff > 0)
+
+    Scene() : camera(nullptr), texture_filter(TEX_TRILINEAR), max_depth(5), min_weight(0.0),
+              light_cutoff(0.0), light_samples(0), shadow_cache(true) {}
+
+    Sphere* add_sphere(const Vec3& center, double radius, int pigIdx, int finIdx) {
+        Sphere* s = sphere_pool.create(center, radius, pigIdx, finIdx);
+        objects.push_back(s);
+        return s;
+    }
+
+    // As faces são adicionadas pelo poliedro devolvido (Polyhedron::add_face)
+    Polyhedron* add_polyhedron(int pigIdx, int finIdx) {
+        Polyhedron* p = polyhedron_pool.create(pigIdx, finIdx, face_pool);
+        objects.push_back(p);
+        return p;
+    }
+
+    // Instância do protótipo proto (índice em prototypes); to_object leva da
+    // cena para o espaço do protótipo. pigIdx/finIdx -1 mantêm os do protótipo.
+    Instance* add_instance(int proto, const Affine& to_object, int pigIdx, int finIdx) {
+        Instance* inst = instance_pool.create(prototypes[proto], proto, to_object, pigIdx, finIdx);
+        objects.push_back(inst);
+        return inst;
+    }
+
+    // Torna o último objeto adicionado um protótipo: ele sai de objects e só
+    // aparece através de instâncias
+    void make_prototype() {
+        prototypes.push_back(objects.back());
+        objects.pop_back();
+    }
+
+    // Bytes ocupados pelos objetos e faces
+    size_t storage_bytes() const {
+        return sphere_pool.memory_bytes() + polyhedron_pool.memory_bytes() + instance_pool.memory_bytes() +
+               face_pool.memory_bytes() + (objects.capacity() + prototypes.capacity()) * sizeof(Object*);
+    }
+
+    // Deve ser chamada depois de loadScene, com objects já preenchido:
+    // compila os objetos e monta a BVH sobre eles. Os protótipos são
+    // compilados antes, porque a caixa de uma instância depende da deles.
+    void build_acceleration() {
+        // Os blocos de planos de todos os poliedros em uma única alocação
+        size_t blocks = face_pool.blocks.size();
+        for (const std::vector<Object*>* list : {&prototypes, &objects}) {
+            for (auto obj : *list) {
+                if (obj->type() == OBJ_POLYHEDRON) blocks += static_cast<Polyhedron*>(obj)->block_count();
+            }
+        }
+        face_pool.blocks.reserve(blocks);
+        for (auto obj : prototypes) obj->compile();
+        for (auto obj : objects) obj->compile();
+        bvh.build(objects);
+    }
+
+    // Alcance de cada luz e grade de luzes, conforme light_cutoff. Deve ser
+    // chamada depois de carregar a cena (também a compilada) e antes de renderizar.
+    void prepare_lights() {
+        for (Light& l : lights) l.radius = light_radius(l, light_cutoff);
+        if (light_cutoff > 0) light_grid.build(lights);
+        else light_grid.clear();
+    }
+
+    // Objeto mais próximo atingido pelo raio no intervalo (t_min, t_max)
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+        return bvh.hit(r, t_min, t_max, rec);
+    }
+
+    // Existe algum objeto no intervalo? (raios de sombra). occluder (opcional)
+    // recebe o índice em objects de um objeto que bloqueia o raio.
+    bool occluded(const Ray& r, double t_min, double t_max, int* occluder = nullptr) const {
+        return bvh.occluded(r, t_min, t_max, occluder);
+    }
+
+    // Consultas em pacote (ver BVH::hit_packet)
+    template<int N>
+    void hit_packet(const RayPacket<N>& p, double t_min, bool* hits, HitRecord* recs) const {
+        bvh.hit_packet(p, t_min, hits, recs);
+    }
+
+    template<int N>
+    void occluded_packet(const RayPacket<N>& p, double t_min, bool* occluded, int* occluders = nullptr) const {
+        bvh.occluded_packet(p, t_min, occluded, occluders);
+    }
     
     ~Scene() {
         if (camera) delete camera;
-        for (auto obj : objects) delete obj;
-        for (auto& pig : pigments) {
-            if (pig.textureData) delete pig.textureData;
-        }
+        // Os objetos são liberados pelos pools
     }
 };
 
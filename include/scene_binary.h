@@ -0,0 +1,26 @@
+#ifndef SCENE_BINARY_H
+#define SCENE_BINARY_H
+
+#include <string>
+#include "scene.h"
+
+// Cena compilada (--compile): um arquivo binário versionado com os objetos em
+// vetores contíguos, a BVH já construída e as texturas já decodificadas (com
+// os níveis de mip). A carga mapeia o arquivo em memória e copia os registros
+// direto para a cena, sem tokenizar texto nem reconstruir a BVH.
+//
+// O arquivo é específico da arquitetura (ordem dos bytes e layout dos
+// registros); a carga recusa arquivos de outra versão ou ordem de bytes.
+
+// O arquivo começa com a assinatura de uma cena compilada?
+bool is_compiled_scene(const std::string& filename);
+
+// Grava a cena; build_acceleration() já deve ter sido chamada. As texturas
+// referenciadas são lidas aqui para serem embutidas (as que falharem ficam só
+// com o caminho, como na cena de texto).
+bool writeCompiledScene(const std::string& filename, Scene& scene);
+
+// Substitui loadScene + build_acceleration para arquivos compilados
+bool loadCompiledScene(const std::string& filename, Scene& scene);
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SIMD_OPS_H
+#define SIMD_OPS_H
+
+// Operações vetoriais usadas pelos kernels de esferas, poliedros e pacotes, com os
+// mesmos nomes para double e float. Avx2Ops<T> e Avx512Ops<T> dão o tipo do
+// vetor, o número de lanes e as instruções, para que cada kernel seja escrito
+// uma vez como template no tipo escalar e instanciado com Real (ver vec3.h):
+// em double são 4 lanes com AVX2 e 8 com AVX-512; em float, 8 e 16.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RT_X86_SIMD 1
+#include <immintrin.h>
+
+#define RT_AVX2 __attribute__((target("avx2"), always_inline)) static inline
+#define RT_AVX512 __attribute__((target("avx512f"), always_inline)) static inline
+
+template<typename T> struct Avx2Ops;
+template<typename T> struct Avx512Ops;
+
+// Máscaras do AVX2 são vetores (todos os bits da lane ligados)
+template<> struct Avx2Ops<double> {
+    typedef __m256d V;
+    static const int LANES = 4;
+
+    RT_AVX2 V set1(double x) { return _mm256_set1_pd(x); }
+    RT_AVX2 V zero() { return _mm256_setzero_pd(); }
+    RT_AVX2 V lane_index() { return _mm256_set_pd(3, 2, 1, 0); }
+    RT_AVX2 V load(const double* p) { return _mm256_load_pd(p); }
+    RT_AVX2 V loadu(const double* p) { return _mm256_loadu_pd(p); }
+    RT_AVX2 void store(double* p, V a) { _mm256_store_pd(p, a); }
+    RT_AVX2 void storeu(double* p, V a) { _mm256_storeu_pd(p, a); }
+    RT_AVX2 V add(V a, V b) { return _mm256_add_pd(a, b); }
+    RT_AVX2 V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    RT_AVX2 V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    RT_AVX2 V div(V a, V b) { return _mm256_div_pd(a, b); }
+    RT_AVX2 V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    RT_AVX2 V bit_and(V a, V b) { return _mm256_and_pd(a, b); }
+    RT_AVX2 V bit_or(V a, V b) { return _mm256_or_pd(a, b); }
+    RT_AVX2 V bit_xor(V a, V b) { return _mm256_xor_pd(a, b); }
+    RT_AVX2 V and_not(V a, V b) { return _mm256_andnot_pd(a, b); } // ~a & b
+    RT_AVX2 V lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    RT_AVX2 V gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    RT_AVX2 V le(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    RT_AVX2 V ge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    RT_AVX2 V blend(V a, V b, V mask) { return _mm256_blendv_pd(a, b, mask); } // mask ? b : a
+    RT_AVX2 int movemask(V a) { return _mm256_movemask_pd(a); }
+};
+
+template<> struct Avx2Ops<float> {
+    typedef __m256 V;
+    static const int LANES = 8;
+
+    RT_AVX2 V set1(float x) { return _mm256_set1_ps(x); }
+    RT_AVX2 V zero() { return _mm256_setzero_ps(); }
+    RT_AVX2 V lane_index() { return _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0); }
+    RT_AVX2 V load(const float* p) { return _mm256_load_ps(p); }
+    RT_AVX2 V loadu(const float* p) { return _mm256_loadu_ps(p); }
+    RT_AVX2 void store(float* p, V a) { _mm256_store_ps(p, a); }
+    RT_AVX2 void storeu(float* p, V a) { _mm256_storeu_ps(p, a); }
+    RT_AVX2 V add(V a, V b) { return _mm256_add_ps(a, b); }
+    RT_AVX2 V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    RT_AVX2 V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    RT_AVX2 V div(V a, V b) { return _mm256_div_ps(a, b); }
+    RT_AVX2 V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    RT_AVX2 V bit_and(V a, V b) { return _mm256_and_ps(a, b); }
+    RT_AVX2 V bit_or(V a, V b) { return _mm256_or_ps(a, b); }
+    RT_AVX2 V bit_xor(V a, V b) { return _mm256_xor_ps(a, b); }
+    RT_AVX2 V and_not(V a, V b) { return _mm256_andnot_ps(a, b); }
+    RT_AVX2 V lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    RT_AVX2 V gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    RT_AVX2 V le(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    RT_AVX2 V ge(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    RT_AVX2 V blend(V a, V b, V mask) { return _mm256_blendv_ps(a, b, mask); }
+    RT_AVX2 int movemask(V a) { return _mm256_movemask_ps(a); }
+};
+
+// No AVX-512 as comparações dão máscaras de bits (M). Só AVX-512F: o xor de
+// ponto flutuante (AVX-512DQ) é feito sobre inteiros.
+template<> struct Avx512Ops<double> {
+    typedef __m512d V;
+    typedef __mmask8 M;
+    static const int LANES = 8;
+
+    RT_AVX512 V set1(double x) { return _mm512_set1_pd(x); }
+    RT_AVX512 V zero() { return _mm512_setzero_pd(); }
+    RT_AVX512 V loadu(const double* p) { return _mm512_loadu_pd(p); }
+    RT_AVX512 void storeu(double* p, V a) { _mm512_storeu_pd(p, a); }
+    RT_AVX512 V add(V a, V b) { return _mm512_add_pd(a, b); }
+    RT_AVX512 V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    RT_AVX512 V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    RT_AVX512 V div(V a, V b) { return _mm512_div_pd(a, b); }
+    RT_AVX512 V sqrt(M mask, V a) { return _mm512_maskz_sqrt_pd(mask, a); } // Zero fora da máscara
+    RT_AVX512 V neg(V a) {
+        return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(set1(-0.0))));
+    }
+    RT_AVX512 M lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    RT_AVX512 M gt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+    RT_AVX512 V blend(M mask, V a, V b) { return _mm512_mask_blend_pd(mask, a, b); } // mask ? b : a
+};
+
+template<> struct Avx512Ops<float> {
+    typedef __m512 V;
+    typedef __mmask16 M;
+    static const int LANES = 16;
+
+    RT_AVX512 V set1(float x) { return _mm512_set1_ps(x); }
+    RT_AVX512 V zero() { return _mm512_setzero_ps(); }
+    RT_AVX512 V loadu(const float* p) { return _mm512_loadu_ps(p); }
+    RT_AVX512 void storeu(float* p, V a) { _mm512_storeu_ps(p, a); }
+    RT_AVX512 V add(V a, V b) { return _mm512_add_ps(a, b); }
+    RT_AVX512 V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    RT_AVX512 V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    RT_AVX512 V div(V a, V b) { return _mm512_div_ps(a, b); }
+    RT_AVX512 V sqrt(M mask, V a) { return _mm512_maskz_sqrt_ps(mask, a); }
+    RT_AVX512 V neg(V a) {
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(set1(-0.0f))));
+    }
+    RT_AVX512 M lt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    RT_AVX512 M gt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    RT_AVX512 V blend(M mask, V a, V b) { return _mm512_mask_blend_ps(mask, a, b); }
+};
+
+#undef RT_AVX2
+#undef RT_AVX512
+
+#endif
+
+#endif
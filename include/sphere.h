@@ -7,54 +7,88 @@
 class Sphere : public Object {
 public:
     Vec3 center;
-    double radius;
+    Real radius;
     int pigmentIndex;
     int finishIndex;
 
     Sphere() {}
     Sphere(Vec3 cen, double r, int pigIdx, int finIdx) 
-        : center(cen), radius(r), pigmentIndex(pigIdx), finishIndex(finIdx) {};
+        : center(cen), radius(Real(r)), pigmentIndex(pigIdx), finishIndex(finIdx) {};
 
-    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    virtual ObjectType type() const { return OBJ_SPHERE; }
+
+    // As contas são em Real, com os limites convertidos para Real, na mesma
+    // ordem dos kernels em lote (sphere_batch.h), que dão o mesmo resultado
+    virtual bool hit(const Ray& r, double t_min_d, double t_max_d, HitRecord& rec) const {
+        Real t_min = Real(t_min_d), t_max = Real(t_max_d);
         Vec3 oc = r.origin - center; // Vetor do Centro da esfera até a Origem do raio
         
         // Coeficientes da equação quadrática
-        double a = dot(r.direction, r.direction);
-        double b = 2.0 * dot(oc, r.direction);
-        double c = dot(oc, oc) - radius * radius;
+        Real a = dot(r.direction, r.direction);
+        Real b = 2 * dot(oc, r.direction);
+        Real c = dot(oc, oc) - radius * radius;
         
-        double discriminant = b*b - 4*a*c;
+        Real discriminant = b*b - 4*a*c;
 
         if (discriminant > 0) {
-            double sqrt_delta = sqrt(discriminant);
+            Real sqrt_delta = std::sqrt(discriminant);
             
             // Tentamos a primeira raiz (a mais próxima da câmera: -b - sqrt)
-            double temp = (-b - sqrt_delta) / (2.0*a);
+            Real temp = (-b - sqrt_delta) / (2*a);
             
             // Verificamos se está dentro do intervalo aceitável (na frente da câmera)
             if (temp < t_max && temp > t_min) {
-                rec.t = temp;
-                rec.p = r.pointAt(rec.t);
-                // A normal de uma esfera é simplesmente (Ponto - Centro) / Raio
-                rec.normal = (rec.p - center) / radius; 
-                rec.pigmentIndex = pigmentIndex;
-                rec.finishIndex = finishIndex;
+                set_hit_record(r, temp, rec);
                 return true;
             }
             
             // Se a primeira raiz falhou, tentamos a segunda (+ sqrt)
-            temp = (-b + sqrt_delta) / (2.0*a);
+            temp = (-b + sqrt_delta) / (2*a);
             if (temp < t_max && temp > t_min) {
-                rec.t = temp;
-                rec.p = r.pointAt(rec.t);
-                rec.normal = (rec.p - center) / radius;
-                rec.pigmentIndex = pigmentIndex;
-                rec.finishIndex = finishIndex;
+                set_hit_record(r, temp, rec);
                 return true;
             }
         }
         return false;
     }
+
+    // Preenche o registro para uma interseção já encontrada em t
+    // (usado também pelo teste em lote de esferas da BVH)
+    void set_hit_record(const Ray& r, Real t, HitRecord& rec) const {
+        rec.t = t;
+        rec.p = r.pointAt(rec.t);
+        // A normal de uma esfera é simplesmente (Ponto - Centro) / Raio
+        rec.normal = (rec.p - center) / radius; 
+        rec.pigmentIndex = pigmentIndex;
+        rec.finishIndex = finishIndex;
+    }
+
+    // Mesmo teste de hit(), mas sem calcular ponto e normal
+    virtual bool occluded(const Ray& r, double t_min_d, double t_max_d) const {
+        Real t_min = Real(t_min_d), t_max = Real(t_max_d);
+        Vec3 oc = r.origin - center;
+
+        Real a = dot(r.direction, r.direction);
+        Real b = 2 * dot(oc, r.direction);
+        Real c = dot(oc, oc) - radius * radius;
+
+        Real discriminant = b*b - 4*a*c;
+        if (discriminant <= 0) return false;
+
+        Real sqrt_delta = std::sqrt(discriminant);
+        Real temp = (-b - sqrt_delta) / (2*a);
+        if (temp < t_max && temp > t_min) return true;
+
+        temp = (-b + sqrt_delta) / (2*a);
+        return temp < t_max && temp > t_min;
+    }
+
+    virtual bool bounding_box(AABB& box) const {
+        double rad = std::abs(radius);
+        Vec3 r(rad, rad, rad);
+        box = AABB(center - r, center + r);
+        return true;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef SPHERE_BATCH_H
+#define SPHERE_BATCH_H
+
+#include <vector>
+#include <string>
+#include "ray.h"
+#include "sphere.h"
+#include "packet.h"
+
+// Esferas em layout SoA (structure of arrays): centros e raios em vetores
+// contíguos, para que um único raio seja testado contra várias esferas
+// por instrução. Os índices são os mesmos de BVH::prims; posições que não
+// são esferas ficam sem uso. No tipo escalar do renderizador (SphereSoA):
+// com float cabem duas vezes mais esferas em cada vetor e em cada linha de cache.
+template<typename T>
+struct SphereSoAT {
+    // Folga no final para que as cargas vetoriais de uma folha nunca leiam fora
+    static const int PADDING = 16;
+
+    std::vector<T> cx, cy, cz;
+    std::vector<T> rr; // raio ao quadrado
+
+    void resize(size_t n) {
+        cx.assign(n + PADDING, T(0));
+        cy.assign(n + PADDING, T(0));
+        cz.assign(n + PADDING, T(0));
+        rr.assign(n + PADDING, T(0));
+    }
+
+    void set(size_t i, const Sphere& s) {
+        cx[i] = s.center.x;
+        cy[i] = s.center.y;
+        cz[i] = s.center.z;
+        rr[i] = s.radius * s.radius;
+    }
+};
+
+typedef SphereSoAT<Real> SphereSoA;
+
+// Conjunto de instruções usado pelos kernels em lote
+enum SimdLevel { SIMD_AUTO, SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512 };
+
+// Escolhe o nível (SIMD_AUTO detecta a CPU). Se o nível pedido não for
+// suportado, cai para o melhor disponível. Deve ser chamado antes de montar a BVH.
+void set_simd_level(SimdLevel level);
+SimdLevel simd_level();
+const char* simd_level_name(SimdLevel level);
+bool parse_simd_level(const std::string& name, SimdLevel& level);
+
+// Quantas esferas cada instrução testa no nível atual: 1, 4 ou 8 em double;
+// 1, 8 ou 16 em float
+int sphere_simd_width();
+
+// Testa o raio contra as esferas [first, first + count) (count <= 16).
+// t_out[k] recebe a raiz válida mais próxima em (t_min, t_max) da esfera
+// first + k, ou +infinito. As contas seguem exatamente a ordem de Sphere::hit,
+// em Real e com os limites convertidos para Real, então o resultado é
+// idêntico ao do caminho escalar.
+void sphere_batch_hit(const SphereSoA& s, int first, int count, const Ray& r,
+                      double t_min, double t_max, Real* t_out);
+
+// Alguma das esferas [first, first + count) intercepta o raio em (t_min, t_max)?
+bool sphere_batch_occluded(const SphereSoA& s, int first, int count, const Ray& r,
+                           double t_min, double t_max);
+
+// Versões para pacotes: a esfera i contra as lanes de `lanes`, cada uma com o
+// seu limite (t_min, limit[l]). Mesmas contas de Sphere::hit, com as lanes
+// nas instruções (AVX2 também no nível avx512). sphere_lanes_hit devolve as
+// lanes com raiz válida e a raiz em t_out[l]; sphere_lanes_occluded, as
+// lanes bloqueadas.
+LaneMask sphere_lanes_hit(const SphereSoA& s, int i, const LaneRays& p, LaneMask lanes,
+                          double t_min, const Real* limit, Real* t_out);
+LaneMask sphere_lanes_occluded(const SphereSoA& s, int i, const LaneRays& p, LaneMask lanes,
+                               double t_min, const Real* limit);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vec3.h"
+
+// Filtro usado na amostragem de texturas
+enum TextureFilter {
+    TEX_NEAREST,   // Texel mais próximo do nível 0 (comportamento original)
+    TEX_TRILINEAR, // Bilinear nos dois níveis de mip mais próximos da pegada
+    TEX_ANISO      // Várias amostras trilineares ao longo do eixo maior da pegada
+};
+
+const char* texture_filter_name(TextureFilter filter);
+bool parse_texture_filter(const std::string& name, TextureFilter& filter);
+
+// Um nível da pirâmide de mips; os texels ficam a partir de offset (em canais)
+struct MipLevel {
+    int width, height;
+    size_t offset;
+};
+
+// Textura RGB com texels compactos: 1 byte por canal (maxval <= 255) ou
+// 2 bytes por canal (PPM de 16 bits). Os valores inteiros do arquivo são
+// guardados sem perda e só convertidos para [0, 1] na amostragem, então a cor
+// devolvida é exatamente a mesma de antes (quando cada texel era um Vec3 de
+// doubles, 24 bytes).
+//
+// Depois da imagem original (nível 0) vêm os níveis de mip, cada um com metade
+// da resolução do anterior, no mesmo vetor de texels.
+struct Texture {
+    int width, height;
+    int max_value;
+    std::vector<uint8_t> texels8;   // RGB intercalado, usado quando max_value <= 255
+    std::vector<uint16_t> texels16; // RGB intercalado, usado quando max_value > 255
+    std::vector<MipLevel> mips;     // mips[0] é a imagem original
+
+    Texture() : width(0), height(0), max_value(255) {}
+
+    bool empty() const { return texels8.empty() && texels16.empty(); }
+
+    // Gera os níveis 1..n (média 2x2) a partir do nível 0 já carregado
+    void build_mipmaps();
+
+    // Bytes ocupados pelos texels
+    size_t memory_bytes() const {
+        return texels8.size() * sizeof(uint8_t) + texels16.size() * sizeof(uint16_t);
+    }
+
+    Vec3 texel(int i, int j) const {
+        size_t k = 3 * ((size_t)j * width + i);
+        return texel_at(k);
+    }
+
+    // Texel (i, j) do nível de mip indicado
+    Vec3 texel(int level, int i, int j) const {
+        const MipLevel& m = mips[level];
+        return texel_at(m.offset + 3 * ((size_t)j * m.width + i));
+    }
+
+    // Função para pegar a cor nas coordenadas (u, v)
+    Vec3 sample(double u, double v) const {
+        if (empty()) return Vec3(1, 0, 1); // Rosa de erro
+
+        // Tratamento de repetição (tiling)
+        u = u - floor(u);
+        v = v - floor(v);
+
+        // Mapeia 0..1 para 0..width-1
+        int i = int(u * width);
+        int j = int(v * height);
+
+        // Clamping de segurança
+        if (i < 0) i = 0;
+        if (j < 0) j = 0;
+        if (i >= width) i = width - 1;
+        if (j >= height) j = height - 1;
+
+        return texel(i, j);
+    }
+
+    // Amostragem filtrada. As derivadas dizem quanto (u, v) varia de um pixel
+    // para o vizinho em x e em y, e definem o nível de mip a usar.
+    Vec3 sample(double u, double v, double dudx, double dvdx, double dudy, double dvdy,
+                TextureFilter filter) const;
+
+private:
+    Vec3 texel_at(size_t k) const {
+        Real m = Real(max_value);
+        if (!texels8.empty()) return Vec3(texels8[k] / m, texels8[k + 1] / m, texels8[k + 2] / m);
+        return Vec3(texels16[k] / m, texels16[k + 1] / m, texels16[k + 2] / m);
+    }
+
+    Vec3 bilinear(int level, double u, double v) const;
+    Vec3 trilinear(double u, double v, double lod) const;
+};
+
+// Carrega um PPM P3 (ASCII) ou P6 (binário). O arquivo é mapeado em memória
+// e lido direto do mapeamento. Retorna nullptr em caso de erro.
+// Cenas não chamam diretamente: usam TextureCache (texture_cache.h).
+Texture* loadPPM(const std::string& filename);
+
+// Só a leitura do PPM (nível 0), sem mips e sem mensagem; usada também pelas
+// ferramentas em tools/. binary, se dado, recebe se o arquivo era P6.
+Texture* readPPM(const std::string& filename, bool* binary = nullptr);
+
+#endif
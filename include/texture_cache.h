@@ -0,0 +1,179 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "texture.h"
+
+class TextureCache;
+
+// Versão do conteúdo de um arquivo (data de modificação e tamanho), para
+// distinguir um arquivo alterado do que já está no cache; vazia se não existe
+std::string file_version(const std::string& path);
+
+// Textura referenciada por caminho. O arquivo só é lido na primeira amostragem,
+// então texturas de objetos que nenhum raio atinge nunca são carregadas.
+// Pode ser amostrada de várias threads ao mesmo tempo. O orçamento do cache
+// pode tirar os texels de um handle em uso; eles são lidos de novo no próximo
+// acesso.
+//
+// Com uma fonte, a textura é decodificada por ela em vez de lida do arquivo
+// (ex.: texels embutidos numa cena compilada); path() é então só o nome no cache.
+class TextureHandle {
+public:
+    typedef std::function<Texture*()> Source;
+
+    TextureHandle(const std::string& path, const std::string& version, Source src = Source())
+        : file(path), file_ver(version), source(src), ready(nullptr), loaded(false), load_order(0), cached_bytes(0) {}
+
+    TextureHandle(const TextureHandle&) = delete;
+    TextureHandle& operator=(const TextureHandle&) = delete;
+
+    const std::string& path() const { return file; }
+
+    // O arquivo mudou desde que o handle foi criado? Sempre falso com fonte:
+    // quem a dá (a cena compilada) controla a versão do que ela lê.
+    bool changed() const { return !source && file_version(file) != file_ver; }
+
+    // Textura decodificada (carregada se preciso) fixada enquanto o Pin existe:
+    // texels descartados pelo orçamento só são liberados quando nenhuma thread
+    // os tem fixados. Vazio se a leitura falhou ou o handle é nulo. Cada
+    // thread fixa uma textura por vez.
+    class Pin {
+    public:
+        explicit Pin(TextureHandle* handle);
+        ~Pin();
+
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+
+        explicit operator bool() const { return tex != nullptr; }
+        const Texture* operator->() const { return tex; }
+
+    private:
+        std::atomic<const Texture*>* slot;
+        const Texture* tex;
+    };
+
+    Vec3 sample(double u, double v) {
+        Pin t(this);
+        if (!t) return Vec3(1, 0, 1); // Rosa de erro
+        return t->sample(u, v);
+    }
+
+    Vec3 sample(double u, double v, double dudx, double dvdx, double dudy, double dvdy,
+                TextureFilter filter) {
+        Pin t(this);
+        if (!t) return Vec3(1, 0, 1);
+        return t->sample(u, v, dudx, dvdx, dudy, dvdy, filter);
+    }
+
+private:
+    friend class TextureCache;
+
+    // Lê a textura (se ainda não foi lida) e a fixa em pin
+    const Texture* load(std::atomic<const Texture*>& pin);
+
+    std::string file;
+    std::string file_ver; // file_version na criação (ou a versão dada com a fonte)
+    Source source;
+    std::atomic<const Texture*> ready; // Caminho rápido: publicado depois da carga, nulo depois do descarte
+    std::mutex load_mtx;
+    std::unique_ptr<Texture> data;
+    bool loaded;          // Já houve tentativa de leitura desde o último descarte (protegido por load_mtx)
+    uint64_t load_order;  // Ordem de carga, usada para descartar as mais antigas (protegido pelo cache)
+    size_t cached_bytes;  // Bytes dos texels em memória, 0 se descartados (protegido pelo cache)
+};
+
+// Cache de texturas do processo, indexado pelo caminho e pela versão do arquivo.
+// Pigmentos que usam o mesmo arquivo compartilham o mesmo TextureHandle; um
+// arquivo alterado ganha um handle novo, e o da versão anterior sai do cache
+// assim que nenhuma cena o referencia.
+//
+// O orçamento de memória vale para os texels decodificados. Quando o total passa
+// dele, os texels são descartados das texturas carregadas há mais tempo para as
+// mais recentes, estejam em uso ou não (a que acabou de ser carregada fica);
+// um handle em uso lê o arquivo de novo no próximo acesso. Os texels que
+// alguma thread está amostrando (ver TextureHandle::Pin) só são liberados
+// depois que ela termina; até lá continuam contados no total.
+class TextureCache {
+public:
+    static const size_t DEFAULT_BUDGET = size_t(1024) * 1024 * 1024; // 1 GB
+
+    static TextureCache& instance();
+
+    // Handle compartilhado para a versão atual do arquivo (criado se ainda não
+    // existe). Conta um acerto se ela já estava no cache e uma falta caso contrário.
+    std::shared_ptr<TextureHandle> acquire(const std::string& path);
+
+    // Mesmo que acquire(path), mas um handle novo carrega com a fonte dada.
+    // version identifica o conteúdo da fonte (ex.: file_version da cena compilada).
+    std::shared_ptr<TextureHandle> acquire(const std::string& name, const std::string& version,
+                                           TextureHandle::Source source);
+
+    // Orçamento em bytes; 0 desativa o limite
+    void set_budget(size_t bytes);
+    size_t budget() const;
+
+    // Descarta texels até caber no orçamento
+    void trim();
+
+    // Tira do cache todas as texturas sem referências externas, carregadas ou
+    // não, mesmo dentro do orçamento (ex.: entre execuções do benchmark, para
+    // medir a carga, ou quando o servidor descarta cenas)
+    void purge();
+
+    struct Stats {
+        uint64_t hits;       // acquire de uma versão já presente
+        uint64_t misses;     // acquire de um caminho ou versão novos
+        uint64_t loads;      // texturas efetivamente lidas
+        uint64_t evictions;  // texels descartados (pelo orçamento ou com a textura)
+        size_t entries;      // handles no cache
+        size_t resident;     // texturas decodificadas em memória
+        size_t bytes;        // bytes de texels em memória
+    };
+    // Libera antes os texels descartados que nenhuma thread fixa mais
+    Stats stats();
+
+private:
+    friend class TextureHandle;
+
+    TextureCache() : budget_bytes(DEFAULT_BUDGET), hits(0), misses(0), loads(0), evictions(0), bytes(0), next_order(0) {}
+
+    // Chamada por TextureHandle depois de ler o arquivo
+    void loaded(TextureHandle* handle, size_t texture_bytes);
+    void trim_locked(const TextureHandle* keep = nullptr);
+
+    typedef std::map<std::pair<std::string, std::string>, std::shared_ptr<TextureHandle>> Entries; // (caminho, versão)
+
+    // Tira a entrada do cache, descartando os texels se estavam carregados
+    void erase_locked(Entries::iterator it);
+
+    // Tira os texels do handle (que passa a recarregar no próximo acesso) e os
+    // deixa em retired até nenhuma thread os ter fixados
+    void evict_locked(TextureHandle* h);
+    // Libera os texels de retired que nenhuma thread fixa
+    void reclaim_locked();
+
+    struct Retired {
+        std::unique_ptr<Texture> texture;
+        size_t bytes;
+    };
+
+    mutable std::mutex mtx;
+    Entries entries;
+    std::vector<Retired> retired;
+    size_t budget_bytes;
+    uint64_t hits, misses, loads, evictions;
+    size_t bytes;
+    uint64_t next_order;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+// Retângulo de pixels [x0, x1) x [y0, y1) no framebuffer (linha 0 = topo da imagem)
+struct Tile {
+    int x0, y0, x1, y1;
+};
+
+// Divide a imagem em tiles quadrados de lado tile_size, em ordem de varredura
+std::vector<Tile> make_tiles(int width, int height, int tile_size);
+
+// Escalonador de tiles com roubo de trabalho (work stealing).
+// Os workers são criados uma única vez e reaproveitados a cada chamada de run().
+// Cada worker tem sua própria fila: consome do início da sua e, quando ela
+// esvazia, rouba do final da fila de outro worker.
+class TileScheduler {
+public:
+    // Função executada para cada tile: (tile, índice do worker)
+    typedef std::function<void(const Tile&, int)> TileJob;
+
+    // num_threads <= 0 usa o número de núcleos da máquina
+    explicit TileScheduler(int num_threads);
+    ~TileScheduler();
+
+    TileScheduler(const TileScheduler&) = delete;
+    TileScheduler& operator=(const TileScheduler&) = delete;
+
+    int thread_count() const { return (int)queues.size(); }
+
+    // Executa job para todos os tiles e só retorna quando todos terminarem.
+    // A thread que chama run() também trabalha (é o worker 0).
+    void run(const std::vector<Tile>& tiles, const TileJob& job);
+
+private:
+    struct WorkQueue {
+        std::mutex mtx;
+        std::deque<int> tiles; // índices em current_tiles
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable wake_cv;
+    std::condition_variable done_cv;
+    unsigned generation; // incrementado a cada run()
+    int active;          // workers auxiliares ainda processando a rodada atual
+    bool stopping;
+
+    const std::vector<Tile>* current_tiles;
+    const TileJob* current_job;
+
+    void worker_loop(int index);
+    void process(int index);
+    bool pop_local(int index, int& tile);
+    bool steal(int index, int& tile);
+};
+
+#endif
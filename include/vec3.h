@@ -4,56 +4,74 @@
 #include <cmath>
 #include <iostream>
 
-class Vec3 {
+// Precisão das contas de geometria e sombreamento, escolhida na compilação:
+// make PRECISION=float define RT_FLOAT (ver Makefile). O padrão é double.
+#ifdef RT_FLOAT
+typedef float Real;
+#else
+typedef double Real;
+#endif
+
+template<typename T>
+class Vec3T {
 public:
-    double x, y, z;
+    T x, y, z;
+
+    Vec3T() : x(0), y(0), z(0) {}
+    Vec3T(T x, T y, T z) : x(x), y(y), z(z) {}
 
-    Vec3() : x(0), y(0), z(0) {}
-    Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+    // Conversão explícita entre precisões
+    template<typename U>
+    explicit Vec3T(const Vec3T<U>& v) : x(T(v.x)), y(T(v.y)), z(T(v.z)) {}
 
     // Operações Básicas de Vetor
-    Vec3 operator-() const { return Vec3(-x, -y, -z); }
+    Vec3T operator-() const { return Vec3T(-x, -y, -z); }
 
-    Vec3 operator+(const Vec3& v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
-    Vec3 operator-(const Vec3& v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
-    Vec3 operator*(double t) const { return Vec3(x * t, y * t, z * t); }
-    Vec3 operator/(double t) const { return Vec3(x / t, y / t, z / t); }
+    Vec3T operator+(const Vec3T& v) const { return Vec3T(x + v.x, y + v.y, z + v.z); }
+    Vec3T operator-(const Vec3T& v) const { return Vec3T(x - v.x, y - v.y, z - v.z); }
+    Vec3T operator*(T t) const { return Vec3T(x * t, y * t, z * t); }
+    Vec3T operator/(T t) const { return Vec3T(x / t, y / t, z / t); }
     
     // Produto de componentes 
-    Vec3 operator*(const Vec3& v) const { return Vec3(x * v.x, y * v.y, z * v.z); }
+    Vec3T operator*(const Vec3T& v) const { return Vec3T(x * v.x, y * v.y, z * v.z); }
 
     // Comprimento do vetor 
-    double length() const {
+    T length() const {
         return std::sqrt(length_squared());
     }
 
-    double length_squared() const {
+    T length_squared() const {
         return x*x + y*y + z*z;
     }
 
     // Normalização 
-    Vec3 normalize() const {
-        double len = length();
+    Vec3T normalize() const {
+        T len = length();
         if (len > 0) return *this / len;
         return *this; // Evita divisão por zero
     }
+
+    // As funções livres são amigas (e não templates) para aceitar escalares
+    // de outro tipo, como em "2 * dot(v, n) * n"
+
+    // Produto Escalar (Dot Product) - para iluminação e textura 
+    friend T dot(const Vec3T& u, const Vec3T& v) {
+        return u.x * v.x + u.y * v.y + u.z * v.z;
+    }
+
+    // Produto Vetorial (Cross Product) - para o sistema de coordenadas da câmera 
+    friend Vec3T cross(const Vec3T& u, const Vec3T& v) {
+        return Vec3T(u.y * v.z - u.z * v.y,
+                     u.z * v.x - u.x * v.z,
+                     u.x * v.y - u.y * v.x);
+    }
+
+    // Sobrecarga para permitir "escalar * Vec3" 
+    friend Vec3T operator*(T t, const Vec3T& v) {
+        return Vec3T(t * v.x, t * v.y, t * v.z);
+    }
 };
 
-// Produto Escalar (Dot Product) - para iluminação e textura 
-inline double dot(const Vec3& u, const Vec3& v) {
-    return u.x * v.x + u.y * v.y + u.z * v.z;
-}
-
-// Produto Vetorial (Cross Product) - para o sistema de coordenadas da câmera 
-inline Vec3 cross(const Vec3& u, const Vec3& v) {
-    return Vec3(u.y * v.z - u.z * v.y,
-                u.z * v.x - u.x * v.z,
-                u.x * v.y - u.y * v.x);
-}
-
-// Sobrecarga para permitir "double * Vec3" 
-inline Vec3 operator*(double t, const Vec3& v) {
-    return Vec3(t * v.x, t * v.y, t * v.z);
-}
+typedef Vec3T<Real> Vec3;
 
 #endif
\ No newline at end of file
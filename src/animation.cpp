@@ -0,0 +1,104 @@
+#include "animation.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+Vec3 lerp(const Vec3& a, const Vec3& b, double t) {
+    return a + (b - a) * t;
+}
+
+// Chaves [begin, end) em ordem de quadro: índice da última com quadro <= frame
+// (ou begin) e a fração até a seguinte
+template<typename Key>
+size_t bracket(const std::vector<Key>& keys, size_t begin, size_t end, int frame, double& t) {
+    size_t k = begin;
+    while (k + 1 < end && keys[k + 1].frame <= frame) k++;
+    t = 0;
+    if (k + 1 < end && frame > keys[k].frame) {
+        t = double(frame - keys[k].frame) / double(keys[k + 1].frame - keys[k].frame);
+    }
+    return k;
+}
+
+}
+
+void Animation::apply(int frame, Scene& scene) const {
+    if (!camera.empty()) {
+        double t;
+        size_t k = bracket(camera, 0, camera.size(), frame, t);
+        const CameraKey& a = camera[k];
+        const CameraKey& b = camera[std::min(k + 1, camera.size() - 1)];
+        *scene.camera = Camera(lerp(a.eye, b.eye, t), lerp(a.at, b.at, t), lerp(a.up, b.up, t),
+                               a.fov + (b.fov - a.fov) * t, scene.camera->aspect);
+    }
+
+    for (size_t begin = 0; begin < spheres.size();) {
+        size_t end = begin;
+        while (end < spheres.size() && spheres[end].object == spheres[begin].object) end++;
+        double t;
+        size_t k = bracket(spheres, begin, end, frame, t);
+        const SphereKey& a = spheres[k];
+        const SphereKey& b = spheres[std::min(k + 1, end - 1)];
+        static_cast<Sphere*>(scene.objects[a.object])->center = lerp(a.center, b.center, t);
+        begin = end;
+    }
+}
+
+bool loadAnimation(const std::string& filename, const Scene& scene, Animation& anim) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Erro: Nao foi possivel abrir " << filename << std::endl;
+        return false;
+    }
+
+    int num_camera = 0, num_spheres = 0;
+    file >> anim.frames >> num_camera;
+    if (!file || anim.frames < 1 || num_camera < 0) {
+        std::cerr << "Erro: Cabecalho de animacao invalido em " << filename << std::endl;
+        return false;
+    }
+    anim.camera.resize(num_camera);
+    for (CameraKey& k : anim.camera) {
+        file >> k.frame >> k.eye.x >> k.eye.y >> k.eye.z >> k.at.x >> k.at.y >> k.at.z
+             >> k.up.x >> k.up.y >> k.up.z >> k.fov;
+    }
+    file >> num_spheres;
+    if (!file || num_spheres < 0) {
+        std::cerr << "Erro: Chaves de camera invalidas em " << filename << std::endl;
+        return false;
+    }
+    anim.spheres.resize(num_spheres);
+    for (SphereKey& k : anim.spheres) file >> k.object >> k.frame >> k.center.x >> k.center.y >> k.center.z;
+    if (!file) {
+        std::cerr << "Erro: Chaves de esferas invalidas em " << filename << std::endl;
+        return false;
+    }
+
+    for (const CameraKey& k : anim.camera) {
+        if (k.frame < 0 || k.frame >= anim.frames) {
+            std::cerr << "Erro: Chave de camera fora da animacao (quadro " << k.frame << ")" << std::endl;
+            return false;
+        }
+    }
+    for (const SphereKey& k : anim.spheres) {
+        if (k.frame < 0 || k.frame >= anim.frames) {
+            std::cerr << "Erro: Chave de esfera fora da animacao (quadro " << k.frame << ")" << std::endl;
+            return false;
+        }
+        if (k.object < 0 || k.object >= (int)scene.objects.size() ||
+            scene.objects[k.object]->type() != OBJ_SPHERE) {
+            std::cerr << "Erro: O objeto " << k.object << " da animacao nao e uma esfera da cena" << std::endl;
+            return false;
+        }
+    }
+
+    // Chaves repetidas (mesmo objeto e quadro) ficam com a última do arquivo
+    auto by_frame = [](const CameraKey& a, const CameraKey& b) { return a.frame < b.frame; };
+    std::stable_sort(anim.camera.begin(), anim.camera.end(), by_frame);
+    std::stable_sort(anim.spheres.begin(), anim.spheres.end(), [](const SphereKey& a, const SphereKey& b) {
+        return a.object != b.object ? a.object < b.object : a.frame < b.frame;
+    });
+    return true;
+}
@@ -0,0 +1,641 @@
+#include "bvh.h"
+#include "sphere.h"
+#include "polyhedron.h"
+#include "instance.h"
+#include "counters.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+const int SAH_BINS = 16;
+const int MAX_LEAF_SIZE = 16;  // Folhas maiores só com esferas, testadas em lote
+const int MAX_LEAF_OTHERS = 4; // Limite de primitivas que não são esferas por folha
+const int SPHERE_BATCH = 16;
+const int MAX_DEPTH = 48;     // Garante que a pilha de travessia (64) nunca estoura
+const int STACK_SIZE = 64;
+
+double component(const Vec3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+Vec3 inverse(const Vec3& d) {
+    return Vec3(1.0 / d.x, 1.0 / d.y, 1.0 / d.z);
+}
+
+// Caixa do objeto com margem para que pontos calculados com arredondamento
+// não caiam fora dela. Retorna false se o objeto não é limitado.
+bool padded_box(const Object* obj, AABB& b) {
+    if (!obj->bounding_box(b)) return false;
+    double extent = std::max({std::abs(b.min.x), std::abs(b.min.y), std::abs(b.min.z),
+                              std::abs(b.max.x), std::abs(b.max.y), std::abs(b.max.z)});
+    b.pad(1e-5 * (1.0 + extent));
+    return true;
+}
+
+// Teste de um objeto fora dos lotes de esferas, por `rays` raios (contado só
+// com RT_COUNTERS). Uma instância conta como um teste do seu protótipo.
+inline void count_test(const Object* obj, int rays = 1) {
+#ifdef RT_COUNTERS
+    if (obj->type() == OBJ_INSTANCE) obj = static_cast<const Instance*>(obj)->prototype;
+    if (obj->type() == OBJ_SPHERE) RT_COUNT(sphere_tests, rays);
+    else RT_COUNT(polyhedron_tests, rays);
+#else
+    (void)obj;
+    (void)rays;
+#endif
+}
+
+inline int lane_count(LaneMask m) {
+    return __builtin_popcountll(m);
+}
+
+// Esferas contadas como no caminho individual: o lote inteiro ao chegar ao seu início
+inline void count_sphere_batch(int i, int first, int sphere_end, LaneMask lanes) {
+#ifdef RT_COUNTERS
+    if ((i - first) % SPHERE_BATCH == 0) {
+        RT_COUNT(sphere_tests, lane_count(lanes) * std::min(SPHERE_BATCH, sphere_end - i));
+    }
+#else
+    (void)i;
+    (void)first;
+    (void)sphere_end;
+    (void)lanes;
+#endif
+}
+
+}
+
+void BVH::build(const std::vector<Object*>& objs) {
+    auto start = std::chrono::steady_clock::now();
+
+    objects = &objs;
+    nodes.clear();
+    prims.clear();
+    unbounded.clear();
+    prim_boxes.assign(objs.size(), AABB());
+    prim_sphere.assign(objs.size(), 0);
+    simd_width = sphere_simd_width();
+
+    for (int i = 0; i < (int)objs.size(); i++) {
+        AABB b;
+        if (padded_box(objs[i], b)) {
+            prim_boxes[i] = b;
+            prim_sphere[i] = objs[i]->type() == OBJ_SPHERE;
+            prims.push_back(i);
+        } else {
+            unbounded.push_back(i);
+        }
+    }
+
+    if (!prims.empty()) {
+        nodes.reserve(2 * prims.size());
+        nodes.push_back(BVHNode());
+        build_recursive(0, 0, (int)prims.size(), 0);
+    }
+
+    // Em cada folha as esferas vão para o início, e seus dados para o SoA
+    sphere_data.resize(prims.size());
+    for (BVHNode& node : nodes) {
+        if (node.count == 0) continue;
+        int* begin = prims.data() + node.first;
+        int* mid = std::stable_partition(begin, begin + node.count, [&](int p) { return prim_sphere[p] != 0; });
+        node.spheres = (int)(mid - begin);
+        for (int i = node.first; i < node.first + node.spheres; i++) {
+            sphere_data.set(i, *static_cast<const Sphere*>(objs[prims[i]]));
+        }
+    }
+
+    prim_boxes.clear();
+    prim_boxes.shrink_to_fit();
+    prim_sphere.clear();
+    prim_sphere.shrink_to_fit();
+    built_area = total_area();
+
+    auto end = std::chrono::steady_clock::now();
+    build_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool BVH::adopt(const std::vector<Object*>& objs) {
+    objects = &objs;
+    simd_width = sphere_simd_width();
+    build_time_ms = 0;
+
+    int n = (int)objs.size();
+    int num_nodes = (int)nodes.size();
+    int num_prims = (int)prims.size();
+    for (int p : prims) {
+        if (p < 0 || p >= n) return false;
+    }
+    for (int u : unbounded) {
+        if (u < 0 || u >= n) return false;
+    }
+    if (num_prims > 0 && num_nodes == 0) return false;
+
+    // Cada nó precisa ser alcançado uma única vez a partir da raiz, com
+    // profundidade que caiba na pilha de travessia
+    std::vector<int> depth(num_nodes, -1);
+    if (num_nodes > 0) depth[0] = 0;
+    sphere_data.resize(prims.size());
+    for (int k = 0; k < num_nodes; k++) {
+        const BVHNode& node = nodes[k];
+        if (depth[k] < 0) return false;
+        if (node.count == 0) {
+            // Nó interno: os filhos são first e first + 1, sempre depois do pai
+            if (node.first <= k || node.first + 1 >= num_nodes) return false;
+            if (depth[node.first] >= 0 || depth[node.first + 1] >= 0 || depth[k] >= MAX_DEPTH) return false;
+            depth[node.first] = depth[node.first + 1] = depth[k] + 1;
+            continue;
+        }
+        if (node.first < 0 || node.count < 0 || node.first + node.count > num_prims) return false;
+        if (node.spheres < 0 || node.spheres > node.count) return false;
+        for (int i = node.first; i < node.first + node.count; i++) {
+            bool sphere = objs[prims[i]]->type() == OBJ_SPHERE;
+            if (sphere != (i < node.first + node.spheres)) return false;
+            if (sphere) sphere_data.set(i, *static_cast<const Sphere*>(objs[prims[i]]));
+        }
+    }
+    built_area = total_area();
+    return true;
+}
+
+double BVH::refit() {
+    // Os filhos vêm sempre depois do pai, então de trás para frente cada nó
+    // interno encontra as caixas dos filhos já atualizadas
+    for (int k = (int)nodes.size() - 1; k >= 0; k--) {
+        BVHNode& node = nodes[k];
+        AABB box;
+        if (node.count == 0) {
+            box.expand(nodes[node.first].box);
+            box.expand(nodes[node.first + 1].box);
+        } else {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                const Object* obj = (*objects)[prims[i]];
+                AABB b;
+                padded_box(obj, b);
+                box.expand(b);
+                if (i < node.first + node.spheres) sphere_data.set(i, *static_cast<const Sphere*>(obj));
+            }
+        }
+        node.box = box;
+    }
+    return built_area > 0 ? total_area() / built_area : 1.0;
+}
+
+double BVH::total_area() const {
+    double area = 0;
+    for (const BVHNode& node : nodes) area += node.box.surface_area();
+    return area;
+}
+
+// Custo relativo de testar uma folha: esferas são testadas simd_width por vez
+double BVH::leaf_cost(int spheres, int others) const {
+    return (spheres + simd_width - 1) / simd_width + others;
+}
+
+// Preenche o nó index a partir de prims[begin, end)
+void BVH::build_recursive(int index, int begin, int end, int depth) {
+    AABB bounds, centroid_bounds;
+    int sphere_count = 0;
+    for (int i = begin; i < end; i++) {
+        bounds.expand(prim_boxes[prims[i]]);
+        centroid_bounds.expand(prim_boxes[prims[i]].center());
+        sphere_count += prim_sphere[prims[i]];
+    }
+
+    nodes[index].box = bounds;
+    nodes[index].first = begin;
+    nodes[index].count = end - begin;
+    nodes[index].axis = 0;
+    nodes[index].spheres = 0;
+
+    int count = end - begin;
+    if (count <= 1 || depth >= MAX_DEPTH) return;
+
+    // SAH com bins: custo = área_esq * custo_esq + área_dir * custo_dir (+ custo de travessia)
+    double best_cost = std::numeric_limits<double>::infinity();
+    int best_axis = -1;
+    int best_split = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        double lo = centroid_bounds.axis_min(axis);
+        double hi = centroid_bounds.axis_max(axis);
+        if (hi - lo < 1e-12) continue;
+
+        int bin_count[SAH_BINS] = {0};
+        int bin_spheres[SAH_BINS] = {0};
+        AABB bin_box[SAH_BINS];
+        double scale = SAH_BINS / (hi - lo);
+
+        for (int i = begin; i < end; i++) {
+            const AABB& b = prim_boxes[prims[i]];
+            int bin = std::min(SAH_BINS - 1, (int)((component(b.center(), axis) - lo) * scale));
+            bin_count[bin]++;
+            bin_spheres[bin] += prim_sphere[prims[i]];
+            bin_box[bin].expand(b);
+        }
+
+        // Varredura da direita para a esquerda acumulando área e contagem
+        double right_area[SAH_BINS];
+        int right_count[SAH_BINS];
+        int right_spheres[SAH_BINS];
+        AABB acc;
+        int n = 0, ns = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--) {
+            acc.expand(bin_box[b]);
+            n += bin_count[b];
+            ns += bin_spheres[b];
+            right_area[b] = acc.surface_area();
+            right_count[b] = n;
+            right_spheres[b] = ns;
+        }
+
+        acc = AABB();
+        n = 0;
+        ns = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++) {
+            acc.expand(bin_box[b]);
+            n += bin_count[b];
+            ns += bin_spheres[b];
+            if (n == 0 || right_count[b + 1] == 0) continue;
+            double cost = acc.surface_area() * leaf_cost(ns, n - ns) +
+                          right_area[b + 1] * leaf_cost(right_spheres[b + 1], right_count[b + 1] - right_spheres[b + 1]);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b + 1;
+            }
+        }
+    }
+
+    double cost_as_leaf = bounds.surface_area() * leaf_cost(sphere_count, count - sphere_count);
+    double traversal_cost = bounds.surface_area();
+    int mid;
+
+    if (best_axis == -1) {
+        // Todos os centróides coincidem: divide pela metade se a folha ficaria grande demais
+        if (count <= MAX_LEAF_SIZE && count - sphere_count <= MAX_LEAF_OTHERS) return;
+        mid = begin + count / 2;
+        best_axis = 0;
+    } else {
+        if (best_cost + traversal_cost >= cost_as_leaf &&
+            count <= MAX_LEAF_SIZE && count - sphere_count <= MAX_LEAF_OTHERS) return;
+
+        double lo = centroid_bounds.axis_min(best_axis);
+        double scale = SAH_BINS / (centroid_bounds.axis_max(best_axis) - lo);
+        int axis = best_axis;
+        int* split = std::partition(prims.data() + begin, prims.data() + end, [&](int p) {
+            double c = component(prim_boxes[p].center(), axis);
+            return std::min(SAH_BINS - 1, (int)((c - lo) * scale)) < best_split;
+        });
+        mid = (int)(split - prims.data());
+        if (mid == begin || mid == end) mid = begin + count / 2;
+    }
+
+    int left = (int)nodes.size();
+    nodes[index].first = left;
+    nodes[index].count = 0;
+    nodes[index].axis = best_axis;
+
+    // Os dois filhos ficam lado a lado: o direito é sempre left + 1
+    nodes.push_back(BVHNode());
+    nodes.push_back(BVHNode());
+    build_recursive(left, begin, mid, depth + 1);
+    build_recursive(left + 1, mid, end, depth + 1);
+}
+
+// O próximo valor depois de closest no tipo Real, em que as primitivas comparam t
+double BVH::ClosestHit::limit() const {
+    return hit_anything ? std::nextafter(Real(closest), std::numeric_limits<Real>::infinity()) : closest;
+}
+
+void BVH::test_object(int idx, const Ray& r, double t_min, ClosestHit& state) const {
+    HitRecord temp;
+    count_test((*objects)[idx]);
+    if ((*objects)[idx]->hit(r, t_min, state.limit(), temp) && state.better(temp.t, idx)) {
+        state.hit_anything = true;
+        state.closest = temp.t;
+        state.best = idx;
+        state.rec = temp;
+    }
+}
+
+void BVH::hit_leaf(const BVHNode& node, const Ray& r, double t_min, ClosestHit& state) const {
+    // Esferas da folha em lote (SIMD), depois as demais primitivas
+    int sphere_end = node.first + node.spheres;
+    for (int i = node.first; i < sphere_end; i += SPHERE_BATCH) {
+        int n = std::min(SPHERE_BATCH, sphere_end - i);
+        Real ts[SPHERE_BATCH];
+        RT_COUNT(sphere_tests, n);
+        sphere_batch_hit(sphere_data, i, n, r, t_min, state.limit(), ts);
+        for (int k = 0; k < n; k++) {
+            int idx = prims[i + k];
+            if (ts[k] != std::numeric_limits<Real>::infinity() && state.better(ts[k], idx)) {
+                state.hit_anything = true;
+                state.closest = ts[k];
+                state.best = idx;
+                static_cast<const Sphere*>((*objects)[idx])->set_hit_record(r, ts[k], state.rec);
+            }
+        }
+    }
+    for (int i = sphere_end; i < node.first + node.count; i++) test_object(prims[i], r, t_min, state);
+}
+
+bool BVH::occluded_leaf(const BVHNode& node, const Ray& r, double t_min, double t_max, int* occluder) const {
+    int sphere_end = node.first + node.spheres;
+    for (int i = node.first; i < sphere_end; i += SPHERE_BATCH) {
+        int n = std::min(SPHERE_BATCH, sphere_end - i);
+        RT_COUNT(sphere_tests, n);
+        if (sphere_batch_occluded(sphere_data, i, n, r, t_min, t_max)) {
+            // O lote só diz que alguma esfera bloqueia; a primeira é achada uma a uma
+            if (occluder) {
+                for (int k = 0; k < n; k++) {
+                    if ((*objects)[prims[i + k]]->occluded(r, t_min, t_max)) {
+                        *occluder = prims[i + k];
+                        break;
+                    }
+                }
+            }
+            return true;
+        }
+    }
+    for (int i = sphere_end; i < node.first + node.count; i++) {
+        count_test((*objects)[prims[i]]);
+        if ((*objects)[prims[i]]->occluded(r, t_min, t_max)) {
+            if (occluder) *occluder = prims[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    ClosestHit state(t_max);
+
+    for (int idx : unbounded) test_object(idx, r, t_min, state);
+
+    uint64_t visited = 0;
+    if (!nodes.empty()) {
+        Vec3 inv_dir = inverse(r.direction);
+        int stack[STACK_SIZE];
+        int sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0) {
+            const BVHNode& node = nodes[stack[--sp]];
+            double t_entry = t_min;
+            if (!node.box.hit(r, inv_dir, t_entry, state.limit())) continue;
+            visited++;
+
+            if (node.count > 0) {
+                hit_leaf(node, r, t_min, state);
+            } else {
+                // Empilha o filho distante primeiro para visitar o próximo antes
+                if (component(r.direction, node.axis) < 0) {
+                    stack[sp++] = node.first;
+                    stack[sp++] = node.first + 1;
+                } else {
+                    stack[sp++] = node.first + 1;
+                    stack[sp++] = node.first;
+                }
+            }
+        }
+    }
+
+    record_stats(visited);
+    if (state.hit_anything) rec = state.rec;
+    return state.hit_anything;
+}
+
+bool BVH::occluded(const Ray& r, double t_min, double t_max, int* occluder) const {
+    for (int idx : unbounded) {
+        count_test((*objects)[idx]);
+        if ((*objects)[idx]->occluded(r, t_min, t_max)) {
+            if (occluder) *occluder = idx;
+            record_stats(0);
+            return true;
+        }
+    }
+
+    uint64_t visited = 0;
+    if (!nodes.empty()) {
+        Vec3 inv_dir = inverse(r.direction);
+        int stack[STACK_SIZE];
+        int sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0) {
+            const BVHNode& node = nodes[stack[--sp]];
+            double t_entry = t_min;
+            if (!node.box.hit(r, inv_dir, t_entry, t_max)) continue;
+            visited++;
+
+            if (node.count > 0) {
+                if (occluded_leaf(node, r, t_min, t_max, occluder)) {
+                    record_stats(visited);
+                    return true;
+                }
+            } else {
+                stack[sp++] = node.first + 1;
+                stack[sp++] = node.first;
+            }
+        }
+    }
+
+    record_stats(visited);
+    return false;
+}
+
+// Folha para as lanes do pacote: cada primitiva é testada contra todas as
+// lanes de uma vez (sphere_lanes_hit, Polyhedron::hit_lanes), e cada lane
+// aceita o acerto com o seu ClosestHit, como em hit_leaf. O limite da lane
+// é atualizado a cada acerto; as instâncias são testadas lane a lane.
+void BVH::hit_leaf_lanes(const BVHNode& node, const LaneRays& p, const Ray* rays, LaneMask lanes,
+                         double t_min, ClosestHit* state, Real* limit) const {
+    Real ts[MAX_PACKET_LANES];
+    int faces[MAX_PACKET_LANES];
+    int sphere_end = node.first + node.spheres;
+    for (int i = node.first; i < sphere_end; i++) {
+        count_sphere_batch(i, node.first, sphere_end, lanes);
+        int idx = prims[i];
+        LaneMask got = sphere_lanes_hit(sphere_data, i, p, lanes, t_min, limit, ts);
+        for (; got; got &= got - 1) {
+            int l = __builtin_ctzll(got);
+            if (!state[l].better(ts[l], idx)) continue;
+            state[l].hit_anything = true;
+            state[l].closest = ts[l];
+            state[l].best = idx;
+            static_cast<const Sphere*>((*objects)[idx])->set_hit_record(rays[l], ts[l], state[l].rec);
+            limit[l] = Real(state[l].limit());
+        }
+    }
+    for (int i = sphere_end; i < node.first + node.count; i++) {
+        int idx = prims[i];
+        const Object* obj = (*objects)[idx];
+        if (obj->type() != OBJ_POLYHEDRON) {
+            for (LaneMask m = lanes; m; m &= m - 1) {
+                int l = __builtin_ctzll(m);
+                test_object(idx, rays[l], t_min, state[l]);
+                limit[l] = Real(state[l].limit());
+            }
+            continue;
+        }
+        count_test(obj, lane_count(lanes));
+        const Polyhedron* poly = static_cast<const Polyhedron*>(obj);
+        LaneMask got = poly->hit_lanes(p, lanes, t_min, limit, ts, faces);
+        for (; got; got &= got - 1) {
+            int l = __builtin_ctzll(got);
+            if (!state[l].better(ts[l], idx)) continue;
+            state[l].hit_anything = true;
+            state[l].closest = ts[l];
+            state[l].best = idx;
+            poly->set_hit_record(rays[l], ts[l], faces[l], state[l].rec);
+            limit[l] = Real(state[l].limit());
+        }
+    }
+}
+
+// Como occluded_leaf para as lanes do pacote; devolve as lanes bloqueadas.
+// Uma lane sai dos testes assim que é bloqueada, então o bloqueador é o
+// primeiro na ordem da folha, o mesmo do caminho individual.
+LaneMask BVH::occluded_leaf_lanes(const BVHNode& node, const LaneRays& p, const Ray* rays, LaneMask lanes,
+                                  double t_min, const double* t_max, const Real* limit, int* occluders) const {
+    LaneMask blocked = 0;
+    int sphere_end = node.first + node.spheres;
+    for (int i = node.first; i < sphere_end && lanes; i++) {
+        count_sphere_batch(i, node.first, sphere_end, lanes);
+        LaneMask got = sphere_lanes_occluded(sphere_data, i, p, lanes, t_min, limit);
+        if (occluders) {
+            for (LaneMask m = got; m; m &= m - 1) occluders[__builtin_ctzll(m)] = prims[i];
+        }
+        blocked |= got;
+        lanes &= ~got;
+    }
+    for (int i = sphere_end; i < node.first + node.count && lanes; i++) {
+        const Object* obj = (*objects)[prims[i]];
+        count_test(obj, lane_count(lanes));
+        LaneMask got = 0;
+        if (obj->type() == OBJ_POLYHEDRON) {
+            got = static_cast<const Polyhedron*>(obj)->occluded_lanes(p, lanes, t_min, limit);
+        } else {
+            for (LaneMask m = lanes; m; m &= m - 1) {
+                int l = __builtin_ctzll(m);
+                if (obj->occluded(rays[l], t_min, t_max[l])) got |= LaneMask(1) << l;
+            }
+        }
+        if (occluders) {
+            for (LaneMask m = got; m; m &= m - 1) occluders[__builtin_ctzll(m)] = prims[i];
+        }
+        blocked |= got;
+        lanes &= ~got;
+    }
+    return blocked;
+}
+
+template<int N>
+void BVH::hit_packet(const RayPacket<N>& p, double t_min, bool* hits, HitRecord* recs) const {
+    ClosestHit state[N];
+    alignas(32) Real limit[N];
+    LaneMask active = p.active_mask();
+
+    for (int l = 0; l < N; l++) {
+        state[l] = ClosestHit(p.t_max[l]);
+        limit[l] = 0;
+        if (!p.active[l]) continue;
+        for (int idx : unbounded) test_object(idx, p.rays[l], t_min, state[l]);
+        limit[l] = Real(state[l].limit());
+    }
+
+    uint64_t visited = 0;
+    if (!nodes.empty() && active) {
+        // A ordem de visita dos filhos segue a direção da primeira lane ativa
+        const Ray& lead = p.rays[__builtin_ctzll(active)];
+        LaneRays lanes = p.lanes();
+        int stack[STACK_SIZE];
+        int sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0) {
+            const BVHNode& node = nodes[stack[--sp]];
+            LaneMask mask = box_lanes(node.box, lanes, active, t_min, limit);
+            if (!mask) continue;
+            visited += lane_count(mask);
+
+            if (node.count > 0) {
+                hit_leaf_lanes(node, lanes, p.rays, mask, t_min, state, limit);
+            } else if (component(lead.direction, node.axis) < 0) {
+                stack[sp++] = node.first;
+                stack[sp++] = node.first + 1;
+            } else {
+                stack[sp++] = node.first + 1;
+                stack[sp++] = node.first;
+            }
+        }
+    }
+
+    for (int l = 0; l < N; l++) {
+        hits[l] = p.active[l] && state[l].hit_anything;
+        if (hits[l]) recs[l] = state[l].rec;
+    }
+    record_stats(visited, lane_count(active));
+}
+
+template<int N>
+void BVH::occluded_packet(const RayPacket<N>& p, double t_min, bool* occluded, int* occluders) const {
+    alignas(32) Real limit[N];
+    LaneMask alive = 0;
+
+    for (int l = 0; l < N; l++) {
+        occluded[l] = false;
+        if (occluders) occluders[l] = -1;
+        limit[l] = Real(p.t_max[l]);
+        if (!p.active[l]) continue;
+        for (int idx : unbounded) {
+            count_test((*objects)[idx]);
+            if ((*objects)[idx]->occluded(p.rays[l], t_min, p.t_max[l])) {
+                occluded[l] = true;
+                if (occluders) occluders[l] = idx;
+                break;
+            }
+        }
+        if (!occluded[l]) alive |= LaneMask(1) << l;
+    }
+
+    uint64_t visited = 0;
+    if (!nodes.empty() && alive) {
+        LaneRays lanes = p.lanes();
+        int stack[STACK_SIZE];
+        int sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0 && alive) {
+            const BVHNode& node = nodes[stack[--sp]];
+            LaneMask mask = box_lanes(node.box, lanes, alive, t_min, limit);
+            if (!mask) continue;
+            visited += lane_count(mask);
+
+            if (node.count > 0) {
+                LaneMask blocked = occluded_leaf_lanes(node, lanes, p.rays, mask, t_min, p.t_max, limit, occluders);
+                for (LaneMask m = blocked; m; m &= m - 1) occluded[__builtin_ctzll(m)] = true;
+                alive &= ~blocked;
+            } else {
+                stack[sp++] = node.first + 1;
+                stack[sp++] = node.first;
+            }
+        }
+    }
+
+    record_stats(visited, lane_count(p.active_mask()));
+}
+
+template void BVH::hit_packet<16>(const RayPacket<16>&, double, bool*, HitRecord*) const;
+template void BVH::hit_packet<64>(const RayPacket<64>&, double, bool*, HitRecord*) const;
+template void BVH::occluded_packet<16>(const RayPacket<16>&, double, bool*, int*) const;
+template void BVH::occluded_packet<64>(const RayPacket<64>&, double, bool*, int*) const;
+
+void BVH::record_stats(uint64_t visited, uint64_t queries) const {
+    if (!collect_stats) return;
+    stat_queries.fetch_add(queries, std::memory_order_relaxed);
+    stat_nodes_visited.fetch_add(visited, std::memory_order_relaxed);
+}
@@ -0,0 +1,101 @@
+#include "counters.h"
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace {
+
+// Contadores de todas as threads que já contaram algo. Ficam vivos até o fim
+// do processo, então as contagens de threads encerradas não se perdem.
+struct CounterRegistry {
+    std::mutex mtx;
+    std::deque<RayCounters> all;
+
+    // Referência para converter o relógio das fases em ns
+    int64_t steady0;
+    uint64_t clock0;
+
+    CounterRegistry() : steady0(steady_ns()), clock0(counters_clock()) {}
+
+    static int64_t steady_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // ns por unidade do relógio, medido desde a criação do registro
+    double ns_per_tick() const {
+#ifdef RT_COUNTERS_TSC
+        uint64_t ticks = counters_clock() - clock0;
+        return ticks ? double(steady_ns() - steady0) / double(ticks) : 0.0;
+#else
+        return 1.0;
+#endif
+    }
+};
+
+CounterRegistry& registry() {
+    static CounterRegistry r;
+    return r;
+}
+
+}
+
+const char* counter_phase_name(CounterPhase phase) {
+    switch (phase) {
+        case PHASE_PRIMARY: return "primarios";
+        case PHASE_SECONDARY: return "reflexao/refracao";
+        case PHASE_SHADOW: return "sombra";
+        case PHASE_SHADING: return "sombreamento";
+        case PHASE_TEXTURE: return "textura";
+        default: return "?";
+    }
+}
+
+void RayCounters::add(const RayCounters& o) {
+    primary_rays += o.primary_rays;
+    shadow_rays += o.shadow_rays;
+    reflection_rays += o.reflection_rays;
+    refraction_rays += o.refraction_rays;
+    sphere_tests += o.sphere_tests;
+    polyhedron_tests += o.polyhedron_tests;
+    shadow_cache_tests += o.shadow_cache_tests;
+    shadow_cache_hits += o.shadow_cache_hits;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        phase_ns[p] += o.phase_ns[p];
+        phase_ticks[p] += o.phase_ticks[p];
+    }
+}
+
+RayCounters counters_total() {
+    CounterRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    RayCounters total;
+    for (const RayCounters& c : r.all) total.add(c);
+    double scale = r.ns_per_tick();
+    for (int p = 0; p < NUM_PHASES; p++) total.phase_ns[p] = uint64_t(total.phase_ticks[p] * scale);
+    return total;
+}
+
+void counters_reset() {
+    CounterRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    for (RayCounters& c : r.all) {
+        int phase = c.current_phase;
+        uint64_t start = c.phase_start;
+        c = RayCounters();
+        c.current_phase = phase;
+        c.phase_start = start;
+    }
+}
+
+#ifdef RT_COUNTERS
+
+RayCounters& register_thread_counters() {
+    CounterRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    r.all.emplace_back();
+    tls_counters = &r.all.back();
+    return *tls_counters;
+}
+
+#endif
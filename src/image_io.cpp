@@ -0,0 +1,251 @@
+#include "image_io.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include "texture.h"
+
+namespace {
+
+// Comentário do cabeçalho que marca uma imagem parcial:
+// "# region x0 y0 largura_da_imagem altura_da_imagem"
+const char* REGION_COMMENT = "# region";
+
+std::string ppm_header(const Framebuffer& fb, ImageFormat format) {
+    std::string header = format == PPM_BINARY ? "P6\n" : "P3\n";
+    if (fb.is_region()) {
+        header += std::string(REGION_COMMENT) + " " + std::to_string(fb.x0) + " " + std::to_string(fb.y0) + " " +
+                  std::to_string(fb.image_width) + " " + std::to_string(fb.image_height) + "\n";
+    }
+    return header + std::to_string(fb.width) + " " + std::to_string(fb.height) + "\n255\n";
+}
+
+// Acrescenta as linhas [y0, y1) ao buffer no formato pedido
+void append_rows(std::string& out, const Framebuffer& fb, ImageFormat format, int y0, int y1) {
+    const Vec3* row = &fb.pixels[(size_t)y0 * fb.width];
+    size_t count = (size_t)(y1 - y0) * fb.width;
+
+    if (format == PPM_BINARY) {
+        size_t base = out.size();
+        out.resize(base + count * 3);
+        char* dst = &out[base];
+        for (size_t k = 0; k < count; k++) {
+            dst[3 * k + 0] = (char)color_to_byte(row[k].x);
+            dst[3 * k + 1] = (char)color_to_byte(row[k].y);
+            dst[3 * k + 2] = (char)color_to_byte(row[k].z);
+        }
+    } else {
+        out.reserve(out.size() + count * 12);
+        for (size_t k = 0; k < count; k++) {
+            out += std::to_string(int(255.99 * row[k].x));
+            out += ' ';
+            out += std::to_string(int(255.99 * row[k].y));
+            out += ' ';
+            out += std::to_string(int(255.99 * row[k].z));
+            out += '\n';
+        }
+    }
+}
+
+// Cor falsa de t em [0, 1]: preto -> azul -> vermelho -> amarelo -> branco
+Vec3 heat_color(double t) {
+    static const double stops[5][3] = {{0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 1, 0}, {1, 1, 1}};
+    t = std::min(1.0, std::max(0.0, t)) * 4;
+    int k = std::min(3, (int)t);
+    double f = t - k;
+    return Vec3(stops[k][0] + f * (stops[k + 1][0] - stops[k][0]),
+                stops[k][1] + f * (stops[k + 1][1] - stops[k][1]),
+                stops[k][2] + f * (stops[k + 1][2] - stops[k][2]));
+}
+
+// Sem buffer da stdio: cada fwrite vira uma escrita direta no arquivo
+std::FILE* open_unbuffered(const std::string& filename) {
+    std::FILE* f = std::fopen(filename.c_str(), "wb");
+    if (f) std::setvbuf(f, nullptr, _IONBF, 0);
+    return f;
+}
+
+}
+
+bool write_ppm(const std::string& filename, const Framebuffer& fb, ImageFormat format) {
+    std::string data = ppm_header(fb, format);
+    if (format == PPM_BINARY) data.reserve(data.size() + (size_t)fb.width * fb.height * 3);
+    append_rows(data, fb, format, 0, fb.height);
+
+    std::FILE* f = open_unbuffered(filename);
+    if (!f) {
+        std::cerr << "Erro: Nao foi possivel criar " << filename << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) std::cerr << "Erro: Falha ao escrever " << filename << std::endl;
+    return ok;
+}
+
+bool PPMStreamWriter::open(const std::string& filename, const Framebuffer& framebuffer, ImageFormat fmt) {
+    file = open_unbuffered(filename);
+    if (!file) {
+        std::cerr << "Erro: Nao foi possivel criar " << filename << std::endl;
+        return false;
+    }
+    fb = &framebuffer;
+    format = fmt;
+    next_row = 0;
+    failed = false;
+    done.assign(fb->height, 0);
+
+    std::string header = ppm_header(*fb, format);
+    failed = std::fwrite(header.data(), 1, header.size(), file) != header.size();
+    return !failed;
+}
+
+void PPMStreamWriter::rows_ready(int y0, int y1) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!file) return;
+    for (int y = y0; y < y1; y++) done[y] = 1;
+
+    // Grava de uma vez todas as linhas consecutivas já prontas
+    int end = next_row;
+    while (end < fb->height && done[end]) end++;
+    if (end == next_row) return;
+
+    buffer.clear();
+    append_rows(buffer, *fb, format, next_row, end);
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) failed = true;
+    next_row = end;
+}
+
+bool PPMStreamWriter::close() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!file) return !failed;
+    if (std::fclose(file) != 0) failed = true;
+    file = nullptr;
+    if (fb && next_row < fb->height) failed = true;
+    return !failed;
+}
+
+CostSummary summarize_cost(const Framebuffer& fb) {
+    CostSummary s = {0, 0, 0};
+    if (fb.cost.empty()) return s;
+    std::vector<float> sorted(fb.cost);
+    size_t k = std::min(sorted.size() - 1, (size_t)(0.995 * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+    s.p995 = sorted[k];
+    for (float c : fb.cost) {
+        s.max = std::max(s.max, (double)c);
+        s.mean += c;
+    }
+    s.mean /= fb.cost.size();
+    return s;
+}
+
+bool write_heatmap(const std::string& filename, const Framebuffer& fb, double scale) {
+    Framebuffer heat(fb.width, fb.height);
+    for (size_t k = 0; k < heat.pixels.size() && k < fb.cost.size(); k++) {
+        heat.pixels[k] = heat_color(scale > 0 ? fb.cost[k] / scale : 0.0);
+    }
+    return write_ppm(filename, heat, PPM_BINARY);
+}
+
+bool read_ppm_region(const std::string& filename, PPMRegion& region) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        std::cerr << "Erro: Nao foi possivel abrir " << filename << std::endl;
+        return false;
+    }
+    std::string magic;
+    in >> magic;
+    if (magic != "P3" && magic != "P6") {
+        std::cerr << "Erro: Apenas PPM P3 (ASCII) ou P6 (binario) sao suportados. Arquivo: " << filename << std::endl;
+        return false;
+    }
+
+    // Os comentários ficam entre a assinatura e as dimensões
+    bool has_region = false;
+    int dims[2];
+    size_t prefix = std::strlen(REGION_COMMENT);
+    for (int n = 0; n < 2;) {
+        in >> std::ws;
+        if (in.peek() == '#') {
+            std::string line;
+            std::getline(in, line);
+            if (line.compare(0, prefix, REGION_COMMENT) != 0) continue;
+            std::istringstream fields(line.substr(prefix));
+            has_region = bool(fields >> region.x0 >> region.y0 >> region.image_width >> region.image_height);
+        } else if (!(in >> dims[n++]) || dims[n - 1] <= 0) {
+            std::cerr << "Erro: Cabecalho PPM invalido. Arquivo: " << filename << std::endl;
+            return false;
+        }
+    }
+    region.width = dims[0];
+    region.height = dims[1];
+    if (!has_region) {
+        region.x0 = region.y0 = 0;
+        region.image_width = region.width;
+        region.image_height = region.height;
+    } else if (region.x0 < 0 || region.y0 < 0 || region.x0 + region.width > region.image_width ||
+               region.y0 + region.height > region.image_height) {
+        std::cerr << "Erro: Regiao invalida no cabecalho de " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool merge_ppm_parts(const std::vector<std::string>& parts, const std::string& output) {
+    int width = -1, height = -1;
+    std::vector<unsigned char> image;
+    std::vector<char> covered;
+
+    for (const std::string& part : parts) {
+        PPMRegion r;
+        if (!read_ppm_region(part, r)) return false;
+        std::unique_ptr<Texture> pixels(readPPM(part));
+        if (!pixels) return false;
+        if (pixels->max_value != 255 || pixels->texels8.empty()) {
+            std::cerr << "Erro: Apenas imagens de 8 bits podem ser juntadas. Arquivo: " << part << std::endl;
+            return false;
+        }
+        if (width < 0) {
+            width = r.image_width;
+            height = r.image_height;
+            image.assign((size_t)width * height * 3, 0);
+            covered.assign((size_t)width * height, 0);
+        } else if (r.image_width != width || r.image_height != height) {
+            std::cerr << "Erro: " << part << " e parte de uma imagem " << r.image_width << "x" << r.image_height
+                      << ", e nao " << width << "x" << height << std::endl;
+            return false;
+        }
+
+        for (int y = 0; y < r.height; y++) {
+            size_t dst = (size_t)(r.y0 + y) * width + r.x0;
+            std::memcpy(&image[dst * 3], &pixels->texels8[(size_t)y * r.width * 3], (size_t)r.width * 3);
+            std::memset(&covered[dst], 1, r.width);
+        }
+    }
+    if (width < 0) {
+        std::cerr << "Erro: Nenhuma imagem parcial para juntar." << std::endl;
+        return false;
+    }
+
+    size_t missing = std::count(covered.begin(), covered.end(), 0);
+    if (missing > 0) {
+        std::cerr << "Erro: " << missing << " pixel(s) da imagem " << width << "x" << height
+                  << " nao estao em nenhuma parte." << std::endl;
+        return false;
+    }
+
+    std::string data = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    data.append(image.begin(), image.end());
+    std::FILE* f = open_unbuffered(output);
+    if (!f) {
+        std::cerr << "Erro: Nao foi possivel criar " << output << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) std::cerr << "Erro: Falha ao escrever " << output << std::endl;
+    return ok;
+}
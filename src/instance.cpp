@@ -0,0 +1,70 @@
+#include "instance.h"
+#include <algorithm>
+#include <cmath>
+
+bool Affine::inverse(Affine& out) const {
+    // Inversa da parte linear pela adjunta (cofatores transpostos)
+    double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    double c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    double c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    double det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+
+    double scale = 0;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) scale = std::max(scale, std::abs(m[i][j]));
+    }
+    if (scale == 0 || std::abs(det) < 1e-12 * scale * scale * scale) return false;
+
+    double inv = 1.0 / det;
+    out.m[0][0] = c00 * inv;
+    out.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+    out.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+    out.m[1][0] = c01 * inv;
+    out.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+    out.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+    out.m[2][0] = c02 * inv;
+    out.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+    out.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+
+    // Translação: -L^-1 t
+    for (int i = 0; i < 3; i++) {
+        out.m[i][3] = -(out.m[i][0] * m[0][3] + out.m[i][1] * m[1][3] + out.m[i][2] * m[2][3]);
+    }
+    return true;
+}
+
+void Instance::compile() {
+    AABB local;
+    Affine to_world;
+    if (!prototype->bounding_box(local) || !to_object.inverse(to_world)) {
+        compile(nullptr);
+        return;
+    }
+    AABB box;
+    for (int k = 0; k < 8; k++) {
+        Vec3 corner((k & 1) ? local.max.x : local.min.x, (k & 2) ? local.max.y : local.min.y,
+                    (k & 4) ? local.max.z : local.min.z);
+        box.expand(to_world.point(corner));
+    }
+    compile(&box);
+}
+
+void Instance::compile(const AABB* box) {
+    bounded = box != nullptr;
+    if (bounded) bounds = *box;
+}
+
+bool Instance::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    if (!prototype->hit(to_local(r), t_min, t_max, rec)) return false;
+
+    // O t é o mesmo nos dois espaços; normais usam a transposta da inversa
+    rec.p = r.pointAt(rec.t);
+    if (!translation) rec.normal = to_object.transpose_vector(rec.normal).normalize();
+    if (pigmentIndex >= 0) rec.pigmentIndex = pigmentIndex;
+    if (finishIndex >= 0) rec.finishIndex = finishIndex;
+    return true;
+}
+
+bool Instance::occluded(const Ray& r, double t_min, double t_max) const {
+    return prototype->occluded(to_local(r), t_min, t_max);
+}
@@ -0,0 +1,130 @@
+#include "light_grid.h"
+#include <algorithm>
+#include <cmath>
+
+double light_radius(const Light& light, double cutoff) {
+    const double inf = std::numeric_limits<double>::infinity();
+    if (cutoff <= 0) return inf;
+
+    // a0 + a1 d + a2 d^2 = m / cutoff
+    double m = std::max(light.color.x, std::max(light.color.y, light.color.z));
+    double a0 = light.attenuation[0], a1 = light.attenuation[1], a2 = light.attenuation[2];
+    double target = m / cutoff - a0;
+    if (target <= 0) return 0.0;
+    if (a2 > 0) return (-a1 + std::sqrt(a1 * a1 + 4 * a2 * target)) / (2 * a2);
+    if (a1 > 0) return target / a1;
+    return inf;
+}
+
+void LightGrid::clear() {
+    bounds = AABB();
+    dims[0] = dims[1] = dims[2] = 0;
+    cell_start.clear();
+    cell_lights.clear();
+    unbounded.clear();
+}
+
+int LightGrid::cell_coord(double v, int axis) const {
+    int c = (int)((v - bounds.axis_min(axis)) * inv_cell[axis]);
+    return std::min(std::max(c, 0), dims[axis] - 1);
+}
+
+void LightGrid::build(const std::vector<Light>& lights) {
+    clear();
+
+    // Caixa das esferas de alcance finito; luzes de alcance zero não entram em nada
+    int bounded = 0;
+    for (size_t i = 0; i < lights.size(); i++) {
+        const Light& l = lights[i];
+        if (std::isinf(l.radius)) {
+            unbounded.push_back((int)i);
+        } else if (l.radius > 0) {
+            Vec3 r(l.radius, l.radius, l.radius);
+            bounds.expand(l.position - r);
+            bounds.expand(l.position + r);
+            bounded++;
+        }
+    }
+
+    // Em torno de 4 células por luz, com lados proporcionais à caixa
+    if (bounded == 0) {
+        bounds = AABB(Vec3(0, 0, 0), Vec3(0, 0, 0));
+        dims[0] = dims[1] = dims[2] = 1;
+    } else {
+        double extent[3];
+        double volume = 1;
+        for (int a = 0; a < 3; a++) {
+            extent[a] = std::max(bounds.axis_max(a) - bounds.axis_min(a), 1e-9);
+            volume *= extent[a];
+        }
+        double edge = std::cbrt(volume / (4.0 * bounded));
+        for (int a = 0; a < 3; a++) dims[a] = std::min(MAX_DIM, std::max(1, (int)std::ceil(extent[a] / edge)));
+        for (int a = 0; a < 3; a++) inv_cell[a] = dims[a] / extent[a];
+    }
+
+    // Duas passadas: conta as luzes de cada célula, depois preenche em ordem de índice
+    int cells = cell_count();
+    std::vector<int> count(cells, 0);
+    auto for_each_cell = [&](const Light& l, auto&& visit) {
+        if (std::isinf(l.radius)) {
+            for (int c = 0; c < cells; c++) visit(c);
+            return;
+        }
+        if (!(l.radius > 0)) return;
+        int lo[3], hi[3];
+        double p[3] = {l.position.x, l.position.y, l.position.z};
+        for (int a = 0; a < 3; a++) {
+            lo[a] = cell_coord(p[a] - l.radius, a);
+            hi[a] = cell_coord(p[a] + l.radius, a);
+        }
+        double r2 = l.radius * l.radius;
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    // Distância da luz à célula
+                    int c[3] = {x, y, z};
+                    double d2 = 0;
+                    for (int a = 0; a < 3; a++) {
+                        double c0 = bounds.axis_min(a) + c[a] / inv_cell[a];
+                        double c1 = bounds.axis_min(a) + (c[a] + 1) / inv_cell[a];
+                        double d = p[a] < c0 ? c0 - p[a] : (p[a] > c1 ? p[a] - c1 : 0.0);
+                        d2 += d * d;
+                    }
+                    if (d2 <= r2 * (1 + 1e-9)) visit((z * dims[1] + y) * dims[0] + x);
+                }
+            }
+        }
+    };
+
+    for (const Light& l : lights) for_each_cell(l, [&](int c) { count[c]++; });
+    cell_start.assign(cells + 1, 0);
+    for (int c = 0; c < cells; c++) cell_start[c + 1] = cell_start[c] + count[c];
+    cell_lights.resize(cell_start[cells]);
+    std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+    for (size_t i = 0; i < lights.size(); i++) {
+        for_each_cell(lights[i], [&](int c) { cell_lights[fill[c]++] = (int)i; });
+    }
+}
+
+const int* LightGrid::candidates(const Vec3& p, int& count) const {
+    double v[3] = {p.x, p.y, p.z};
+    for (int a = 0; a < 3; a++) {
+        if (!(v[a] >= bounds.axis_min(a) && v[a] <= bounds.axis_max(a))) {
+            count = (int)unbounded.size();
+            return unbounded.data();
+        }
+    }
+    int cell = (cell_coord(v[2], 2) * dims[1] + cell_coord(v[1], 1)) * dims[0] + cell_coord(v[0], 0);
+    count = cell_start[cell + 1] - cell_start[cell];
+    return cell_lights.data() + cell_start[cell];
+}
+
+double LightGrid::mean_lights_per_cell() const {
+    return empty() ? 0.0 : double(cell_lights.size()) / cell_count();
+}
+
+int LightGrid::max_lights_per_cell() const {
+    int m = 0;
+    for (int c = 0; c + 1 < (int)cell_start.size(); c++) m = std::max(m, cell_start[c + 1] - cell_start[c]);
+    return m;
+}
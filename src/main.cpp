@@ -1,204 +1,506 @@
+#include <algorithm>
 #include <iostream>
-#include <fstream>
-#include <algorithm> 
-#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <csignal>
+#include <atomic>
+#include <chrono>
 #include "scene.h"
+#include "render.h"
+#include "image_io.h"
+#include "scene_binary.h"
+#include "counters.h"
+#include "animation.h"
+#include "render_server.h"
 
 // Protótipo da função parser 
 bool loadScene(const std::string& filename, Scene& scene);
 
-// Auxiliar para limitar valores entre 0 e 1 (clamp)
-double clamp(double x) { return x < 0 ? 0 : (x > 1 ? 1 : x); }
-Vec3 clamp_color(Vec3 c) { return Vec3(clamp(c.x), clamp(c.y), clamp(c.z)); }
+// Ctrl+C no modo progressivo: termina a passada atual e grava a imagem
+static std::atomic<bool> interrupted(false);
 
-// Refletir um vetor em torno de uma normal
-Vec3 reflect(const Vec3& v, const Vec3& n) {
-    return v - 2 * dot(v, n) * n;
+static void on_sigint(int) {
+    interrupted = true;
 }
 
-// Refratar um vetor (Lei de Snell)
-bool refract(const Vec3& v, const Vec3& n, double ni_over_nt, Vec3& refracted) {
-    Vec3 uv = v.normalize();
-    double dt = dot(uv, n);
-    double discriminant = 1.0 - ni_over_nt * ni_over_nt * (1.0 - dt * dt);
-    if (discriminant > 0) {
-        refracted = ni_over_nt * (uv - n * dt) - n * sqrt(discriminant);
-        return true;
+// Recorta de fb o retângulo area, dado em coordenadas da imagem
+static Framebuffer crop(const Framebuffer& fb, const Tile& area) {
+    Framebuffer out(area.x1 - area.x0, area.y1 - area.y0);
+    out.image_width = fb.image_width;
+    out.image_height = fb.image_height;
+    out.x0 = area.x0;
+    out.y0 = area.y0;
+    if (!fb.cost.empty()) out.cost.resize(out.pixels.size());
+    for (int y = 0; y < out.height; y++) {
+        for (int x = 0; x < out.width; x++) {
+            int sx = area.x0 - fb.x0 + x;
+            int sy = area.y0 - fb.y0 + y;
+            out.at(x, y) = fb.at(sx, sy);
+            if (!fb.cost.empty()) out.cost[y * out.width + x] = fb.cost[sy * fb.width + sx];
+        }
     }
-    return false; // Reflexão interna total
+    return out;
 }
 
-Vec3 get_pigment_color(const Pigment& pig, const Vec3& p) {
-    if (pig.type == SOLID) {
-        return pig.color;
-    } 
-    else if (pig.type == CHECKER) {
-        double s = pig.cube_size;
-        // Adiciona um pequeno epsilon para estabilidade numérica nas bordas
-        int cx = (int)floor((p.x + 0.0001) / s);
-        int cy = (int)floor((p.y + 0.0001) / s);
-        int cz = (int)floor((p.z + 0.0001) / s);
-
-        if ((cx + cy + cz) % 2 == 0) return pig.color;
-        else return pig.color2;
-    } 
-    else if (pig.type == TEXMAP) {
-        // Se a textura não foi carregada corretamente, retorna rosa erro
-        if (!pig.textureData) return Vec3(1, 0, 1);
-
-        // P0 e P1 são os vetores de 4 elementos lidos do arquivo
-        
-        // s = P0 . PC (onde PC é x, y, z, 1)
-        double s = pig.tex_params[0] * p.x + 
-                   pig.tex_params[1] * p.y + 
-                   pig.tex_params[2] * p.z + 
-                   pig.tex_params[3]; 
-
-        // r = P1 . PC
-        double r = pig.tex_params[4] * p.x + 
-                   pig.tex_params[5] * p.y + 
-                   pig.tex_params[6] * p.z + 
-                   pig.tex_params[7]; 
-
-        return pig.textureData->sample(s, r);
+// Nome do arquivo de um quadro da animação: pattern com um %d (com largura
+// opcional, ex.: quadro%04d.ppm) ou, sem ele, o número inserido antes da
+// extensão (output.ppm -> output_0007.ppm). Vazio se pattern é inválido.
+static std::string frame_filename(const std::string& pattern, int frame) {
+    size_t pct = pattern.find('%');
+    if (pct == std::string::npos) {
+        size_t dot = pattern.rfind('.');
+        if (dot == std::string::npos || pattern.find('/', dot) != std::string::npos) dot = pattern.size();
+        char num[16];
+        std::snprintf(num, sizeof(num), "_%04d", frame);
+        return pattern.substr(0, dot) + num + pattern.substr(dot);
     }
-    return Vec3(0, 0, 0);
+    size_t d = pct + 1;
+    while (d < pattern.size() && pattern[d] >= '0' && pattern[d] <= '9') d++;
+    if (d >= pattern.size() || pattern[d] != 'd' || pattern.find('%', d) != std::string::npos) return "";
+    char num[32];
+    std::snprintf(num, sizeof(num), ("%" + pattern.substr(pct + 1, d - pct)).c_str(), frame);
+    return pattern.substr(0, pct) + num + pattern.substr(d + 1);
 }
 
-Vec3 cast_ray(const Ray& r, Scene& scene, int depth) {
-    // Limite de recursão para evitar loop infinito e estouro de pilha
-    if (depth > 5) return Vec3(0,0,0); 
-
-    HitRecord rec;
-    bool hit_anything = false;
-    double closest_so_far = 999999.0;
-    HitRecord temp_rec;
-
-    // 1. Interseção com a cena (encontrar o objeto mais próximo)
-    for (Object* obj : scene.objects) {
-        if (obj->hit(r, 0.001, closest_so_far, temp_rec)) {
-            hit_anything = true;
-            closest_so_far = temp_rec.t;
-            rec = temp_rec;
-        }
-    }
-
-    if (!hit_anything) return Vec3(0.0, 0.0, 0.0); // Fundo preto
-
-    const Pigment& pig = scene.pigments[rec.pigmentIndex];
-    const Finish& fin = scene.finishes[rec.finishIndex];
-    
-    Vec3 P = rec.p;
-    Vec3 N = rec.normal;
-    Vec3 V = -r.direction.normalize(); 
-    
-    Vec3 obj_color = get_pigment_color(pig, P); 
-
-    Vec3 local_color = fin.ka * scene.ambient_light * obj_color; // Ambiente
-
-    for (const auto& light : scene.lights) {
-        Vec3 L_vec = light.position - P;
-        double dist = L_vec.length();
-        Vec3 L = L_vec.normalize();
-
-        // Sombra
-        Ray shadow_ray(P, L);
-        bool in_shadow = false;
-        HitRecord srec;
-        for (Object* obj : scene.objects) {
-            if (obj->hit(shadow_ray, 0.001, dist, srec)) {
-                in_shadow = true;
-                break;
+// Com esferas em movimento, a BVH é ajustada (refit) a cada quadro e só é
+// reconstruída quando a soma das áreas das caixas passa deste múltiplo da
+// área logo após a construção
+static const double REBUILD_GROWTH = 1.5;
+
+// Renderiza os quadros da animação sobre a mesma cena: texturas, BVH e
+// luzes ficam carregadas entre quadros, e a cada quadro só mudam a câmera, as
+// esferas animadas e as caixas da BVH. load_ms é quanto custou preparar a cena
+// (leitura, BVH e luzes), que um processo por quadro pagaria em todo quadro.
+static bool render_animation(Scene& scene, const RenderSettings& settings, TileScheduler& scheduler,
+                             const Animation& anim, const std::string& pattern, Framebuffer& fb,
+                             const Tile* crop_area, ImageFormat format, double load_ms) {
+    typedef std::chrono::steady_clock Clock;
+    auto ms_since = [](Clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+    };
+    RenderSettings frame_settings = settings;
+    frame_settings.progress = false;
+
+    double setup_total = 0, render_total = 0;
+    int rebuilds = 0;
+    for (int f = 0; f < anim.frames; f++) {
+        Clock::time_point start = Clock::now();
+        anim.apply(f, scene);
+        const char* accel = "camera";
+        if (anim.moves_objects()) {
+            if (scene.bvh.refit() > REBUILD_GROWTH) {
+                scene.bvh.build(scene.objects);
+                rebuilds++;
+                accel = "BVH reconstruida";
+            } else {
+                accel = "refit da BVH";
             }
         }
-
-        if (!in_shadow) {
-            double n_dot_l = std::max(0.0, dot(N, L));
-            Vec3 diffuse = fin.kd * n_dot_l * (light.color * obj_color);
-            
-            Vec3 R = reflect(-L, N);
-            double r_dot_v = std::max(0.0, dot(R, V));
-            Vec3 specular = fin.ks * pow(r_dot_v, fin.alpha) * light.color;
-
-            double att = 1.0 / (light.attenuation[0] + light.attenuation[1]*dist + light.attenuation[2]*dist*dist);
-            local_color = local_color + (diffuse + specular) * att;
-        }
+        double setup = ms_since(start);
+
+        start = Clock::now();
+        render_image(scene, frame_settings, scheduler, fb);
+        double render = ms_since(start);
+
+        std::string name = frame_filename(pattern, f);
+        if (!write_ppm(name, crop_area ? crop(fb, *crop_area) : fb, format)) return false;
+        std::cout << "Quadro " << f + 1 << "/" << anim.frames << ": preparacao " << setup << " ms (" << accel
+                  << "), renderizacao " << render << " ms -> " << name << std::endl;
+        setup_total += setup;
+        render_total += render;
     }
 
-    Vec3 final_color = local_color;
+    std::cout << "Animacao: " << anim.frames << " quadro(s), preparacao media de " << setup_total / anim.frames
+              << " ms por quadro (" << rebuilds << " reconstrucao(oes) da BVH) contra " << load_ms
+              << " ms de leitura da cena, BVH e luzes por quadro com um processo por quadro; renderizacao media "
+              << render_total / anim.frames << " ms" << std::endl;
+    return true;
+}
 
-    // --- Componente Global: Reflexão (kr) --- 
-    if (fin.kr > 0) {
-        Vec3 reflected_dir = reflect(r.direction.normalize(), N);
-        Ray reflected_ray(P, reflected_dir);
-        Vec3 reflection_color = cast_ray(reflected_ray, scene, depth + 1);
-        final_color = final_color + fin.kr * reflection_color;
-    }
+static void print_usage(const char* prog) {
+    std::cerr << "Uso: " << prog << " <arquivo_cena> [output.ppm] [--width W] [--height H] [--region x0,y0,x1,y1] [--threads N] [--stats] [--simd auto|scalar|avx2|avx512] [--packet 4|8] [--ascii] [--stream] [--texture-budget MB] [--texture-filter nearest|trilinear|aniso] [--aa N] [--aa-threshold T] [--progressive] [--time-budget S] [--max-depth N] [--min-weight W] [--heatmap mapa.ppm] [--heatmap-metric time|rays] [--light-cutoff E] [--light-samples N] [--no-shadow-cache] [--wavefront] [--animate animacao.txt]" << std::endl;
+    std::cerr << "       " << prog << " <arquivo_cena> --compile <cena.rtb>" << std::endl;
+    std::cerr << "       " << prog << " --serve <socket> [--max-scenes N] [opcoes de renderizacao]" << std::endl;
+}
 
-    // --- Componente Global: Transmissão/Refração (kt) --- 
-    if (fin.kt > 0) {
-        Vec3 outward_normal;
-        double ni_over_nt;
-        Vec3 refracted_dir;
-        
-        // Verifica se o raio está entrando ou saindo do objeto
-        if (dot(r.direction, N) > 0) {
-            outward_normal = -N;
-            ni_over_nt = fin.ior; // Saindo: n2 / n1 
+int main(int argc, char** argv) {
+    RenderSettings settings;
+    std::vector<std::string> positional;
+    std::string compile_output;
+    std::string heatmap_output;
+    std::string animation_file;
+    std::string serve_socket;
+    int max_scenes = 8;
+
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if ((arg == "--width" || arg == "--height") && k + 1 < argc) {
+            int& size = arg == "--width" ? settings.width : settings.height;
+            size = std::atoi(argv[++k]);
+            if (size < 1) {
+                std::cerr << "Dimensao invalida: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--region" && k + 1 < argc) {
+            Tile& r = settings.region;
+            char extra;
+            if (std::sscanf(argv[++k], "%d,%d,%d,%d%c", &r.x0, &r.y0, &r.x1, &r.y1, &extra) != 4) {
+                std::cerr << "Regiao invalida (use x0,y0,x1,y1): " << argv[k] << std::endl;
+                return 1;
+            }
+            settings.has_region = true;
+        } else if (arg == "--threads" && k + 1 < argc) {
+            settings.threads = std::atoi(argv[++k]);
+        } else if (arg == "--stats") {
+            settings.stats = true;
+        } else if (arg == "--ascii") {
+            settings.ascii = true;
+        } else if (arg == "--stream") {
+            settings.stream = true;
+        } else if (arg == "--packet" && k + 1 < argc) {
+            settings.packet_size = std::atoi(argv[++k]);
+            if (settings.packet_size != 4 && settings.packet_size != 8) {
+                std::cerr << "Tamanho de pacote invalido (use 4 ou 8): " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--texture-budget" && k + 1 < argc) {
+            long mb = std::atol(argv[++k]);
+            if (mb < 0) {
+                std::cerr << "Orcamento de texturas invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+            TextureCache::instance().set_budget(size_t(mb) * 1024 * 1024);
+        } else if (arg == "--max-depth" && k + 1 < argc) {
+            settings.max_depth = std::atoi(argv[++k]);
+            if (settings.max_depth < 0) {
+                std::cerr << "Profundidade invalida: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--min-weight" && k + 1 < argc) {
+            settings.min_weight = std::atof(argv[++k]);
+        } else if (arg == "--light-cutoff" && k + 1 < argc) {
+            settings.light_cutoff = std::atof(argv[++k]);
+            if (settings.light_cutoff < 0) {
+                std::cerr << "Corte de luz invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--light-samples" && k + 1 < argc) {
+            settings.light_samples = std::atoi(argv[++k]);
+            if (settings.light_samples < 0) {
+                std::cerr << "Numero de amostras de luz invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--no-shadow-cache") {
+            settings.shadow_cache = false;
+        } else if (arg == "--wavefront") {
+            settings.wavefront = true;
+        } else if (arg == "--compile" && k + 1 < argc) {
+            compile_output = argv[++k];
+        } else if (arg == "--animate" && k + 1 < argc) {
+            animation_file = argv[++k];
+        } else if (arg == "--serve" && k + 1 < argc) {
+            serve_socket = argv[++k];
+        } else if (arg == "--max-scenes" && k + 1 < argc) {
+            max_scenes = std::atoi(argv[++k]);
+            if (max_scenes < 1) {
+                std::cerr << "Numero de cenas invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--heatmap" && k + 1 < argc) {
+            heatmap_output = argv[++k];
+        } else if (arg == "--heatmap-metric" && k + 1 < argc) {
+            std::string metric = argv[++k];
+            if (metric == "time") {
+                settings.heat_metric = HEAT_TIME;
+            } else if (metric == "rays") {
+                settings.heat_metric = HEAT_RAYS;
+            } else {
+                std::cerr << "Medida de mapa de calor invalida (use time ou rays): " << metric << std::endl;
+                return 1;
+            }
+        } else if (arg == "--progressive") {
+            settings.progressive = true;
+        } else if (arg == "--time-budget" && k + 1 < argc) {
+            settings.time_budget = std::atof(argv[++k]);
+            settings.progressive = true; // Só o modo progressivo tem imagem parcial para entregar
+        } else if (arg == "--aa" && k + 1 < argc) {
+            settings.aa_samples = std::atoi(argv[++k]);
+            if (settings.aa_samples < 1) {
+                std::cerr << "Numero de amostras invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--aa-threshold" && k + 1 < argc) {
+            settings.aa_threshold = std::atof(argv[++k]);
+        } else if (arg == "--texture-filter" && k + 1 < argc) {
+            if (!parse_texture_filter(argv[++k], settings.texture_filter)) {
+                std::cerr << "Filtro de textura invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--simd" && k + 1 < argc) {
+            if (!parse_simd_level(argv[++k], settings.simd)) {
+                std::cerr << "Nivel SIMD invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Opcao desconhecida: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
         } else {
-            outward_normal = N;
-            ni_over_nt = 1.0 / fin.ior; // Entrando: n1 / n2
+            positional.push_back(arg);
         }
-
-        if (refract(r.direction, outward_normal, ni_over_nt, refracted_dir)) {
-            Ray refracted_ray(P, refracted_dir);
-            Vec3 refraction_color = cast_ray(refracted_ray, scene, depth + 1);
-            final_color = final_color + fin.kt * refraction_color;
-        } 
     }
 
-    return clamp_color(final_color);
-}
-
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::cerr << "Uso: " << argv[0] << " <arquivo_cena> [output.ppm]" << std::endl;
+    if (positional.empty() && serve_socket.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const Tile& region = settings.region;
+    if (settings.has_region && (region.x0 < 0 || region.y0 < 0 || region.x1 > settings.width ||
+                                region.y1 > settings.height || region.x0 >= region.x1 || region.y0 >= region.y1)) {
+        std::cerr << "Regiao fora da imagem " << settings.width << "x" << settings.height << ": " << region.x0
+                  << "," << region.y0 << "," << region.x1 << "," << region.y1 << std::endl;
         return 1;
     }
+    if (settings.has_region && settings.stream && settings.aa_samples > 1) {
+        std::cerr << "--stream com --region nao pode ser usado com --aa" << std::endl;
+        return 1;
+    }
+    if (!animation_file.empty() && (settings.progressive || settings.stream || !heatmap_output.empty())) {
+        std::cerr << "--animate nao pode ser usado com --progressive, --stream nem --heatmap" << std::endl;
+        return 1;
+    }
+    if (settings.progressive && settings.stream) {
+        std::cerr << "--stream nao pode ser usado com --progressive" << std::endl;
+        return 1;
+    }
+    if (settings.wavefront && (settings.packet_size || settings.progressive)) {
+        std::cerr << "--wavefront nao pode ser usado com --packet nem com --progressive" << std::endl;
+        return 1;
+    }
+    if (!heatmap_output.empty() && settings.progressive) {
+        std::cerr << "--heatmap nao pode ser usado com --progressive" << std::endl;
+        return 1;
+    }
+    if (settings.heat_metric == HEAT_RAYS && !COUNTERS_ENABLED) {
+        std::cerr << "--heatmap-metric rays requer os contadores (compile com make COUNTERS=1)" << std::endl;
+        return 1;
+    }
+
+    // O nível SIMD define o tamanho das folhas, então vem antes da BVH
+    // (também a de uma cena compilada, cujos dados em lote são refeitos na carga)
+    set_simd_level(settings.simd);
+
+    if (!serve_socket.empty()) {
+        // Cada pedido traz a cena, a saída e as dimensões; as opções da linha de
+        // comando são o padrão dos pedidos
+        if (!positional.empty() || settings.has_region || settings.progressive || settings.stream ||
+            !heatmap_output.empty() || !animation_file.empty() || !compile_output.empty()) {
+            std::cerr << "--serve nao aceita cena, --region, --progressive, --stream, --heatmap, --animate nem --compile"
+                      << std::endl;
+            return 1;
+        }
+        return run_render_server(serve_socket, settings, max_scenes);
+    }
 
+    std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
     Scene scene;
-    if (loadScene(argv[1], scene)) {
-        // Dimensões da imagem (padrão 800x600 ou lidas da câmera se implementado)
-        int nx = 800;
-        int ny = 600;
+    bool compiled = is_compiled_scene(positional[0]);
+    bool loaded = compiled ? loadCompiledScene(positional[0], scene) : loadScene(positional[0], scene);
+    if (loaded && !compile_output.empty()) {
+        if (!compiled) scene.build_acceleration();
+        if (!writeCompiledScene(compile_output, scene)) return 1;
+        std::cout << "Cena compilada: " << compile_output << " (" << scene.objects.size() << " objetos, "
+                  << scene.bvh.nodes.size() << " nos de BVH)" << std::endl;
+        return 0;
+    }
+    if (loaded) {
+        // Dimensões da imagem (padrão 800x600, ou --width/--height) e a parte
+        // dela a renderizar
+        int nx = settings.width;
+        int ny = settings.height;
+        Tile area = settings.has_region ? settings.region : Tile{0, 0, nx, ny};
+
+        // Com antialiasing, a região ganha uma borda de um pixel que é
+        // renderizada e descartada: o refinamento de um pixel depende do
+        // contraste com os vizinhos, e sem ela a beirada da região seria
+        // refinada de outro jeito que na imagem inteira
+        Tile render_area = area;
+        if (settings.has_region && settings.aa_samples > 1) {
+            render_area = Tile{std::max(0, area.x0 - 1), std::max(0, area.y0 - 1),
+                               std::min(nx, area.x1 + 1), std::min(ny, area.y1 + 1)};
+        }
+        bool cropped = render_area.x0 != area.x0 || render_area.y0 != area.y0 ||
+                       render_area.x1 != area.x1 || render_area.y1 != area.y1;
+
+        std::string output_file = (positional.size() >= 2) ? positional[1] : "output.ppm";
+
+        // A tela virtual da câmera segue a proporção da imagem inteira
+        scene.camera->set_aspect(double(nx) / ny);
+        scene.texture_filter = settings.texture_filter;
+        scene.max_depth = settings.max_depth;
+        scene.min_weight = settings.min_weight;
+        scene.light_cutoff = settings.light_cutoff;
+        scene.light_samples = settings.light_samples;
+        scene.shadow_cache = settings.shadow_cache;
+        if (!compiled) scene.build_acceleration(); // A cena compilada já traz a BVH
+        scene.prepare_lights();
+        double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+
+        Animation anim;
+        if (!animation_file.empty()) {
+            if (!loadAnimation(animation_file, scene, anim)) return 1;
+            if (frame_filename(output_file, 0).empty()) {
+                std::cerr << "Nome de saida invalido para a animacao (use um unico %d): " << output_file << std::endl;
+                return 1;
+            }
+        }
+        scene.bvh.collect_stats = settings.stats;
+        if (settings.stats) {
+            std::cout << "BVH: " << scene.bvh.nodes.size() << " nos, "
+                      << scene.bvh.prims.size() << " objetos limitados, "
+                      << scene.bvh.unbounded.size() << " ilimitados, ";
+            if (compiled) std::cout << "carregada da cena compilada";
+            else std::cout << "construida em " << scene.bvh.build_time_ms << " ms";
+            std::cout << " (esferas em lote: " << simd_level_name(simd_level()) << ")" << std::endl;
+            std::cout << "Cena: " << scene.sphere_pool.size() << " esferas, "
+                      << scene.polyhedron_pool.size() << " poliedros, "
+                      << scene.face_pool.faces.size() << " faces, "
+                      << scene.instance_pool.size() << " instancias de " << scene.prototypes.size() << " prototipo(s), "
+                      << scene.storage_bytes() / 1024 << " KB em pools" << std::endl;
+            if (!scene.light_grid.empty()) {
+                const LightGrid& g = scene.light_grid;
+                std::cout << "Luzes: " << scene.lights.size() << ", grade " << g.dim(0) << "x" << g.dim(1) << "x"
+                          << g.dim(2) << ", media de " << g.mean_lights_per_cell() << " luzes por celula (maximo "
+                          << g.max_lights_per_cell() << ")" << std::endl;
+            }
+        }
 
-        std::string output_file = (argc >= 3) ? argv[2] : "output.ppm";
-        std::ofstream out_file(output_file);
-        
-        // Cabeçalho PPM
-        out_file << "P3\n" << nx << " " << ny << "\n255\n";
+        TileScheduler scheduler(settings.threads);
 
-        std::cout << "Renderizando " << nx << "x" << ny << " para " << output_file << "..." << std::endl;
+        std::cout << "Renderizando " << nx << "x" << ny;
+        if (settings.has_region) {
+            std::cout << " (regiao " << area.x0 << "," << area.y0 << "," << area.x1 << "," << area.y1 << ")";
+        }
+        std::cout << " para " << output_file << " com " << scheduler.thread_count() << " thread(s)..." << std::endl;
+
+        Framebuffer fb(render_area.x1 - render_area.x0, render_area.y1 - render_area.y0);
+        fb.image_width = nx;
+        fb.image_height = ny;
+        fb.x0 = render_area.x0;
+        fb.y0 = render_area.y0;
+        ImageFormat format = settings.ascii ? PPM_ASCII : PPM_BINARY;
+
+        if (!animation_file.empty()) {
+            return render_animation(scene, settings, scheduler, anim, output_file, fb, cropped ? &area : nullptr,
+                                    format, load_ms) ? 0 : 1;
+        }
 
-        // Loop de Renderização
-        for (int j = ny - 1; j >= 0; j--) {
-            if (j % 50 == 0) std::cout << "Linhas restantes: " << j << std::endl;
+        if (!heatmap_output.empty()) fb.cost.assign(fb.pixels.size(), 0.0f);
+        counters_reset();
+        bool written;
+        RenderStats render_stats;
+        bool complete = true;
+
+        if (settings.progressive) {
+            // Cada passada sobrescreve o arquivo (via temporário + rename, para
+            // que um leitor nunca veja uma imagem pela metade)
+            std::signal(SIGINT, on_sigint);
+            std::string temp_file = output_file + ".tmp";
+            written = true;
+            complete = render_progressive(scene, settings, scheduler, fb,
+                [&](int pass, int passes, bool pass_complete) {
+                    bool ok = write_ppm(temp_file, cropped ? crop(fb, area) : fb, format) &&
+                              std::rename(temp_file.c_str(), output_file.c_str()) == 0;
+                    written = written && ok;
+                    std::cout << (pass_complete ? "Passada " : "Interrompido na passada ") << pass
+                              << "/" << passes << ", imagem gravada em " << output_file << std::endl;
+                }, &interrupted, &render_stats);
+            std::signal(SIGINT, SIG_DFL);
+            if (!complete) std::cout << "Renderizacao interrompida; a imagem gravada e a melhor ate aqui." << std::endl;
+        } else if (settings.stream) {
+            // Faixas de linhas vão para o disco assim que ficam prontas, em ordem
+            PPMStreamWriter writer;
+            if (!writer.open(output_file, fb, format)) return 1;
+            render_image(scene, settings, scheduler, fb,
+                         [&](int y0, int y1) { writer.rows_ready(y0, y1); }, &render_stats);
+            written = writer.close();
+        } else {
+            // O arquivo é escrito uma única vez, depois que todos os tiles terminaram
+            render_image(scene, settings, scheduler, fb, RowsReady(), &render_stats);
+            written = write_ppm(output_file, cropped ? crop(fb, area) : fb, format);
+        }
 
-            for (int i = 0; i < nx; i++) {
-                double u = double(i) / double(nx);
-                double v = double(j) / double(ny);
+        if (!written) {
+            std::cerr << "Falha ao gravar a imagem." << std::endl;
+            return 1;
+        }
 
-                Ray r = scene.camera->get_ray(u, v);
-                Vec3 col = cast_ray(r, scene, 0);
+        if (!heatmap_output.empty()) {
+            Framebuffer region_fb = cropped ? crop(fb, area) : Framebuffer(0, 0);
+            const Framebuffer& out = cropped ? region_fb : fb;
+            CostSummary cost = summarize_cost(out);
+            if (!write_heatmap(heatmap_output, out, cost.p995)) {
+                std::cerr << "Falha ao gravar o mapa de calor." << std::endl;
+                return 1;
+            }
+            std::cout << "Mapa de calor (" << (settings.heat_metric == HEAT_RAYS ? "raios" : "ns")
+                      << " por pixel): " << heatmap_output << ", branco = " << cost.p995
+                      << " (percentil 99.5), maximo " << cost.max << ", media " << cost.mean << std::endl;
+        }
 
-                int ir = int(255.99 * col.x);
-                int ig = int(255.99 * col.y);
-                int ib = int(255.99 * col.z);
+        if (settings.aa_samples > 1 && complete) {
+            // Comparação com a mesma cota de amostras aplicada a todos os pixels
+            uint64_t pixels = render_stats.primary_samples;
+            uint64_t spent = pixels + render_stats.extra_samples;
+            uint64_t uniform = pixels * (uint64_t)settings.aa_samples;
+            std::cout << "Antialiasing: " << render_stats.refined_pixels << " de " << pixels
+                      << " pixels refinados, " << spent << " raios primarios ("
+                      << double(spent) / double(pixels) << " por pixel) contra " << uniform
+                      << " com " << settings.aa_samples << " por pixel uniforme ("
+                      << 100.0 * double(spent) / double(uniform) << "%)" << std::endl;
+        }
 
-                out_file << ir << " " << ig << " " << ib << "\n";
+        if (settings.stats) {
+            uint64_t queries = scene.bvh.stat_queries.load();
+            uint64_t visited = scene.bvh.stat_nodes_visited.load();
+            std::cout << "BVH: " << queries << " consultas, media de "
+                      << (queries ? double(visited) / double(queries) : 0.0)
+                      << " nos visitados por raio" << std::endl;
+
+            TextureCache::Stats tex = TextureCache::instance().stats();
+            std::cout << "Texturas: " << tex.entries << " arquivo(s), " << tex.hits << " acertos, "
+                      << tex.misses << " faltas no cache, " << tex.loads << " carregada(s), "
+                      << tex.resident << " em memoria (" << tex.bytes / 1024 << " KB), "
+                      << tex.evictions << " descartada(s)" << std::endl;
+
+            if (COUNTERS_ENABLED) {
+                RayCounters c = counters_total();
+                uint64_t pixels = (uint64_t)fb.width * fb.height;
+                std::cout << "Raios: " << c.primary_rays << " primarios, " << c.shadow_rays << " de sombra, "
+                          << c.reflection_rays << " de reflexao, " << c.refraction_rays << " de refracao ("
+                          << double(c.rays()) / double(pixels) << " por pixel)" << std::endl;
+                std::cout << "Testes de intersecao: " << c.sphere_tests << " esferas, "
+                          << c.polyhedron_tests << " poliedros" << std::endl;
+                std::cout << "Cache de sombras: " << c.shadow_cache_hits << " de " << c.shadow_cache_tests
+                          << " testes bloqueados pelo ultimo bloqueador ("
+                          << (c.shadow_cache_tests ? 100.0 * c.shadow_cache_hits / c.shadow_cache_tests : 0.0)
+                          << "%), " << (c.shadow_rays ? 100.0 * c.shadow_cache_hits / c.shadow_rays : 0.0)
+                          << "% dos raios de sombra sem BVH" << std::endl;
+                uint64_t total_ns = 0;
+                for (int p = 0; p < NUM_PHASES; p++) total_ns += c.phase_ns[p];
+                std::cout << "Tempo por fase (soma das threads):";
+                for (int p = 0; p < NUM_PHASES; p++) {
+                    std::cout << (p ? ", " : " ") << counter_phase_name(CounterPhase(p)) << " "
+                              << c.phase_ns[p] / 1e6 << " ms ("
+                              << (total_ns ? 100.0 * c.phase_ns[p] / total_ns : 0.0) << "%)";
+                }
+                std::cout << std::endl;
+            } else {
+                std::cout << "Contadores de raios desligados (compile com make COUNTERS=1)" << std::endl;
             }
         }
-        out_file.close();
         std::cout << "Concluido!" << std::endl;
     } else {
         std::cerr << "Falha ao carregar a cena." << std::endl;
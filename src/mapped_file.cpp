@@ -0,0 +1,63 @@
+#include "mapped_file.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RT_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+
+#ifdef RT_HAVE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    length = (size_t)st.st_size;
+    if (length == 0) {
+        // mmap não aceita tamanho zero; um arquivo vazio é válido mas sem dados
+        ::close(fd);
+        return true;
+    }
+
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // O mapeamento continua válido depois de fechar o descritor
+    if (p == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    ptr = static_cast<const unsigned char*>(p);
+    return true;
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    length = (size_t)file.tellg();
+    file.seekg(0);
+    fallback.resize(length);
+    if (length > 0 && !file.read(reinterpret_cast<char*>(fallback.data()), length)) {
+        fallback.clear();
+        length = 0;
+        return false;
+    }
+    ptr = fallback.data();
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef RT_HAVE_MMAP
+    if (ptr) munmap(const_cast<unsigned char*>(ptr), length);
+#endif
+    fallback.clear();
+    ptr = nullptr;
+    length = 0;
+}
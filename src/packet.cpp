@@ -0,0 +1,71 @@
+#include "packet.h"
+#include "sphere_batch.h"
+#include "simd_ops.h"
+
+namespace {
+
+// --- Caminho escalar: AABB::hit lane a lane ---
+
+template<typename T>
+LaneMask box_scalar(const AABB& box, const LaneRaysT<T>& p, LaneMask lanes, double t_min, const T* limit) {
+    LaneMask out = 0;
+    for (LaneMask m = lanes; m; m &= m - 1) {
+        int l = __builtin_ctzll(m);
+        double t_entry = t_min;
+        Vec3T<T> inv_dir(p.inv_dx[l], p.inv_dy[l], p.inv_dz[l]);
+        if (box.hit(p.ray(l), inv_dir, t_entry, limit[l])) out |= LaneMask(1) << l;
+    }
+    return out;
+}
+
+#ifdef RT_X86_SIMD
+
+// --- AVX2: 4 lanes por instrução em double, 8 em float ---
+// As trocas de AABB::hit (inv < 0) viram blends; NaN nunca substitui lo ou
+// hi, como nas comparações do escalar.
+
+template<typename T>
+__attribute__((target("avx2")))
+LaneMask box_avx2(const AABB& box, const LaneRaysT<T>& p, LaneMask lanes, double t_min, const T* limit) {
+    typedef Avx2Ops<T> O;
+    typedef typename O::V V;
+    const LaneMask group = (LaneMask(1) << O::LANES) - 1;
+    const V zero = O::zero();
+    const V vmin = O::set1(T(t_min));
+    const T bmin[3] = {box.min.x, box.min.y, box.min.z};
+    const T bmax[3] = {box.max.x, box.max.y, box.max.z};
+    const T* origin[3] = {p.ox, p.oy, p.oz};
+    const T* inv[3] = {p.inv_dx, p.inv_dy, p.inv_dz};
+
+    LaneMask out = 0;
+    for (int k = 0; k < p.n; k += O::LANES) {
+        LaneMask want = (lanes >> k) & group;
+        if (!want) continue;
+        V lo = vmin;
+        V hi = O::loadu(limit + k);
+        for (int axis = 0; axis < 3; axis++) {
+            V o = O::loadu(origin[axis] + k);
+            V id = O::loadu(inv[axis] + k);
+            V t0 = O::mul(O::sub(O::set1(bmin[axis]), o), id);
+            V t1 = O::mul(O::sub(O::set1(bmax[axis]), o), id);
+            V neg = O::lt(id, zero);
+            V a = O::blend(t0, t1, neg);
+            V b = O::blend(t1, t0, neg);
+            lo = O::blend(lo, a, O::gt(a, lo));
+            hi = O::blend(hi, b, O::lt(b, hi));
+        }
+        out |= (LaneMask(O::movemask(O::le(lo, hi))) & want) << k;
+    }
+    return out;
+}
+
+#endif
+
+}
+
+LaneMask box_lanes(const AABB& box, const LaneRays& p, LaneMask lanes, double t_min, const Real* limit) {
+#ifdef RT_X86_SIMD
+    if (simd_level() >= SIMD_AVX2) return box_avx2(box, p, lanes, t_min, limit);
+#endif
+    return box_scalar(box, p, lanes, t_min, limit);
+}
@@ -7,49 +7,6 @@
 
 using namespace std;
 
-// --- Função Auxiliar para ler PPM ---
-Texture* loadPPM(const string& filename) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        cerr << "Erro: Nao foi possivel abrir textura " << filename << endl;
-        return nullptr;
-    }
-
-    string header;
-    file >> header;
-
-    if (header != "P3") {
-        cerr << "Erro: Apenas formato PPM P3 (ASCII) eh suportado no momento. Arquivo: " << filename << endl;
-        return nullptr;
-    }
-
-    Texture* tex = new Texture();
-    int max_val;
-
-    // Ignorar comentários (#) no PPM
-    auto skip_comments = [&](ifstream& f) {
-        char c;
-        while (f >> ws && f.peek() == '#') {
-            f.ignore(4096, '\n');
-        }
-    };
-
-    skip_comments(file); file >> tex->width;
-    skip_comments(file); file >> tex->height;
-    skip_comments(file); file >> max_val;
-
-    tex->pixels.resize(tex->width * tex->height);
-
-    for (int i = 0; i < tex->width * tex->height; ++i) {
-        int r, g, b;
-        file >> r >> g >> b;
-        tex->pixels[i] = Vec3(r / (double)max_val, g / (double)max_val, b / (double)max_val);
-    }
-    
-    cout << "Textura carregada: " << filename << " (" << tex->width << "x" << tex->height << ")" << endl;
-    return tex;
-}
-
 // --- Função Principal do Parser ---
 bool loadScene(const string& filename, Scene& scene) {
     ifstream file(filename);
@@ -66,7 +23,7 @@ bool loadScene(const string& filename, Scene& scene) {
     file >> up.x >> up.y >> up.z;
     file >> fov;
 
-    scene.camera = new Camera(eye, at, up, fov, 1.333);
+    scene.camera = new Camera(eye, at, up, fov, DEFAULT_CAMERA_ASPECT);
 
     // 2. Luzes 
     int num_lights;
@@ -102,8 +59,8 @@ bool loadScene(const string& filename, Scene& scene) {
             file >> p.tex_file;
             for (int k = 0; k < 8; k++) file >> p.tex_params[k];
             
-            // Carregamento da textura
-            p.textureData = loadPPM(p.tex_file);
+            // A textura vem do cache e só é lida quando for amostrada
+            p.textureData = TextureCache::instance().acquire(p.tex_file);
         }
         scene.pigments.push_back(p);
     }
@@ -117,6 +74,8 @@ bool loadScene(const string& filename, Scene& scene) {
         scene.finishes.push_back(f);
     }
 
+    // "prototype" antes do tipo: a geometria fica fora da cena e só aparece
+    // através das linhas "instance", que a referenciam pela ordem dos protótipos
     int num_objects;
     file >> num_objects;
     for (int i = 0; i < num_objects; ++i) {
@@ -124,23 +83,46 @@ bool loadScene(const string& filename, Scene& scene) {
         string obj_type;
         file >> pig_idx >> fin_idx >> obj_type;
 
+        bool prototype = obj_type == "prototype";
+        if (prototype) file >> obj_type;
+        size_t added = scene.objects.size();
+
         if (obj_type == "sphere") {
             Vec3 center;
             double radius;
             file >> center.x >> center.y >> center.z >> radius;
-            scene.objects.push_back(new Sphere(center, radius, pig_idx, fin_idx));
+            scene.add_sphere(center, radius, pig_idx, fin_idx);
         } 
         else if (obj_type == "polyhedron") {
             int num_faces;
             file >> num_faces;
-            Polyhedron* poly = new Polyhedron(pig_idx, fin_idx);
+            Polyhedron* poly = scene.add_polyhedron(pig_idx, fin_idx);
             for (int k = 0; k < num_faces; k++) {
                 double a, b, c, d;
                 file >> a >> b >> c >> d;
                 poly->add_face(a, b, c, d);
             }
-            scene.objects.push_back(poly);
         }
+        else if (obj_type == "instance" && !prototype) {
+            // Índice do protótipo e a transformação [L | t] em três linhas de 4
+            int proto;
+            Affine to_world, to_object;
+            file >> proto;
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < 4; c++) file >> to_world.m[r][c];
+            }
+            if (proto < 0 || proto >= (int)scene.prototypes.size()) {
+                cerr << "Erro: Instancia de um prototipo inexistente (" << proto << ") em " << filename << endl;
+                return false;
+            }
+            if (!to_world.inverse(to_object)) {
+                cerr << "Erro: Transformacao de instancia nao inversivel em " << filename << endl;
+                return false;
+            }
+            scene.add_instance(proto, to_object, pig_idx, fin_idx);
+        }
+
+        if (prototype && scene.objects.size() > added) scene.make_prototype();
     }
 
     return true;
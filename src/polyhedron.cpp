@@ -0,0 +1,395 @@
+#include "polyhedron.h"
+#include "sphere_batch.h"
+#include "simd_ops.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double T_START = 1e9; // t_enter começa em -T_START e t_exit em +T_START
+
+// Os kernels são templates no tipo escalar T (instanciados com Real, o tipo
+// dos blocos de planos); os limites chegam em double e são convertidos uma vez.
+
+// --- Caminho escalar ---
+// Mesmas contas, na mesma ordem, do laço original sobre as faces
+
+template<typename T>
+bool slab_scalar(const PlaneBlockT<T>* blocks, int count, const RayT<T>& r,
+                 double t_min_d, double t_max_d, T& t_enter, T& t_exit, int& enter_face) {
+    typedef PlaneBlockT<T> Block;
+    T t_min = T(t_min_d), t_max = T(t_max_d);
+    t_enter = T(-T_START);
+    t_exit = T(T_START);
+    enter_face = -1;
+
+    for (int k = 0; k < count; k++) {
+        const Block& b = blocks[k / Block::WIDTH];
+        int l = k % Block::WIDTH;
+
+        // O denominador é o produto escalar da direção do raio com a normal do plano
+        T denom = b.nx[l] * r.direction.x + b.ny[l] * r.direction.y + b.nz[l] * r.direction.z;
+
+        // Numerador da equação de interseção t = -(P0 . N + d) / (D . N)
+        T dist = -((b.nx[l] * r.origin.x + b.ny[l] * r.origin.y + b.nz[l] * r.origin.z) + b.d[l]);
+
+        // Raio paralelo ao plano: se a origem está "fora", o raio erra o objeto todo
+        if (std::abs(denom) < T(1e-6)) {
+            if (dist < 0) return false;
+            continue;
+        }
+
+        T t = dist / denom;
+        if (denom < 0) {
+            // Entrando no semi-espaço
+            if (t > t_enter) {
+                t_enter = t;
+                enter_face = k;
+            }
+        } else {
+            // Saindo do semi-espaço
+            if (t < t_exit) t_exit = t;
+        }
+
+        if (t_enter >= t_exit || t_exit <= t_min || t_enter >= t_max) return false;
+    }
+    return true;
+}
+
+// Pacotes: o laço escalar para cada lane
+template<typename T>
+LaneMask slab_lanes_scalar(const PlaneBlockT<T>* blocks, int count, const LaneRaysT<T>& p, LaneMask lanes,
+                           double t_min, const T* t_max, T* t_enter, T* t_exit, int* enter_face) {
+    LaneMask ok = 0;
+    for (LaneMask m = lanes; m; m &= m - 1) {
+        int l = __builtin_ctzll(m);
+        if (slab_scalar(blocks, count, p.ray(l), t_min, t_max[l], t_enter[l], t_exit[l], enter_face[l])) {
+            ok |= LaneMask(1) << l;
+        }
+    }
+    return ok;
+}
+
+#ifdef RT_X86_SIMD
+
+// --- AVX2: um bloco (4 faces em double, 8 em float) por instrução ---
+// Sem FMA, como nos kernels de esferas. Cada lane guarda sua maior entrada
+// (com o índice da face) e sua menor saída; a redução no final escolhe, em
+// empates, a face de menor índice, como o laço escalar.
+
+template<typename T>
+__attribute__((target("avx2")))
+bool slab_avx2(const PlaneBlockT<T>* blocks, int count, const RayT<T>& r,
+               double t_min_d, double t_max_d, T& t_enter, T& t_exit, int& enter_face) {
+    typedef Avx2Ops<T> O;
+    typedef typename O::V V;
+    typedef PlaneBlockT<T> Block;
+    static_assert(Block::WIDTH == O::LANES, "um bloco de planos por vetor AVX2");
+    const int W = Block::WIDTH;
+    T t_min = T(t_min_d), t_max = T(t_max_d);
+
+    const V dx = O::set1(r.direction.x);
+    const V dy = O::set1(r.direction.y);
+    const V dz = O::set1(r.direction.z);
+    const V ox = O::set1(r.origin.x);
+    const V oy = O::set1(r.origin.y);
+    const V oz = O::set1(r.origin.z);
+    const V sign = O::set1(T(-0.0));
+    const V zero = O::zero();
+    const V eps = O::set1(T(1e-6));
+
+    V te = O::set1(T(-T_START));
+    V tx = O::set1(T(T_START));
+    V ti = O::set1(T(-1));
+    V idx = O::lane_index();
+    const V step = O::set1(T(W));
+
+    int nblocks = (count + W - 1) / W;
+    for (int bi = 0; bi < nblocks; bi++) {
+        const Block& b = blocks[bi];
+        V nx = O::load(b.nx);
+        V ny = O::load(b.ny);
+        V nz = O::load(b.nz);
+
+        V denom = O::add(O::add(O::mul(nx, dx), O::mul(ny, dy)), O::mul(nz, dz));
+        V no = O::add(O::add(O::mul(nx, ox), O::mul(ny, oy)), O::mul(nz, oz));
+        V dist = O::bit_xor(O::add(no, O::load(b.d)), sign);
+
+        V parallel = O::lt(O::and_not(sign, denom), eps);
+        if (O::movemask(O::bit_and(parallel, O::lt(dist, zero)))) return false;
+
+        V t = O::div(dist, denom);
+        V entering = O::lt(denom, zero);
+        V upd_enter = O::and_not(parallel, O::bit_and(entering, O::gt(t, te)));
+        V upd_exit = O::and_not(O::bit_or(parallel, entering), O::lt(t, tx));
+        te = O::blend(te, t, upd_enter);
+        ti = O::blend(ti, idx, upd_enter);
+        tx = O::blend(tx, t, upd_exit);
+        idx = O::add(idx, step);
+
+        // Saída antecipada: basta comparar os extremos do bloco atual
+        alignas(32) T e[W], x[W];
+        O::store(e, te);
+        O::store(x, tx);
+        T emax = e[0], xmin = x[0];
+        for (int l = 1; l < W; l++) {
+            emax = std::max(emax, e[l]);
+            xmin = std::min(xmin, x[l]);
+        }
+        if (emax >= xmin || xmin <= t_min || emax >= t_max) return false;
+    }
+
+    alignas(32) T e[W], x[W], i[W];
+    O::store(e, te);
+    O::store(x, tx);
+    O::store(i, ti);
+    t_enter = T(-T_START);
+    t_exit = T(T_START);
+    enter_face = -1;
+    for (int l = 0; l < W; l++) {
+        if (x[l] < t_exit) t_exit = x[l];
+        if (i[l] < 0) continue;
+        if (e[l] > t_enter || (e[l] == t_enter && (int)i[l] < enter_face)) {
+            t_enter = e[l];
+            enter_face = (int)i[l];
+        }
+    }
+    return true;
+}
+
+// Pacotes com AVX2: as lanes (4 em double, 8 em float) ocupam o vetor e os
+// planos são replicados um a um, na ordem do laço escalar, então cada lane
+// faz exatamente as contas e os desempates de slab_scalar. As condições de
+// saída ficam para o fim do bloco: t_enter só cresce e t_exit só diminui,
+// então uma lane que o escalar abandonaria continua falhando até o final.
+template<typename T>
+__attribute__((target("avx2")))
+LaneMask slab_lanes_avx2(const PlaneBlockT<T>* blocks, int count, const LaneRaysT<T>& p, LaneMask lanes,
+                         double t_min_d, const T* t_max, T* t_enter, T* t_exit, int* enter_face) {
+    typedef Avx2Ops<T> O;
+    typedef typename O::V V;
+    typedef PlaneBlockT<T> Block;
+    const int W = O::LANES;
+    const LaneMask group = (LaneMask(1) << W) - 1;
+    const V sign = O::set1(T(-0.0));
+    const V zero = O::zero();
+    const V eps = O::set1(T(1e-6));
+    const V vmin = O::set1(T(t_min_d));
+
+    LaneMask ok = 0;
+    for (int k = 0; k < p.n; k += W) {
+        LaneMask want = (lanes >> k) & group;
+        if (!want) continue;
+        const V dx = O::loadu(p.dx + k);
+        const V dy = O::loadu(p.dy + k);
+        const V dz = O::loadu(p.dz + k);
+        const V ox = O::loadu(p.ox + k);
+        const V oy = O::loadu(p.oy + k);
+        const V oz = O::loadu(p.oz + k);
+        const V vmax = O::loadu(t_max + k);
+
+        V te = O::set1(T(-T_START));
+        V tx = O::set1(T(T_START));
+        V ti = O::set1(T(-1));
+        V fail = zero;
+        for (int f = 0; f < count; f++) {
+            const Block& b = blocks[f / Block::WIDTH];
+            int l = f % Block::WIDTH;
+            V nx = O::set1(b.nx[l]);
+            V ny = O::set1(b.ny[l]);
+            V nz = O::set1(b.nz[l]);
+
+            V denom = O::add(O::add(O::mul(nx, dx), O::mul(ny, dy)), O::mul(nz, dz));
+            V no = O::add(O::add(O::mul(nx, ox), O::mul(ny, oy)), O::mul(nz, oz));
+            V dist = O::bit_xor(O::add(no, O::set1(b.d[l])), sign);
+
+            V parallel = O::lt(O::and_not(sign, denom), eps);
+            fail = O::bit_or(fail, O::bit_and(parallel, O::lt(dist, zero)));
+
+            V t = O::div(dist, denom);
+            V entering = O::lt(denom, zero);
+            V upd_enter = O::and_not(parallel, O::bit_and(entering, O::gt(t, te)));
+            V upd_exit = O::and_not(O::bit_or(parallel, entering), O::lt(t, tx));
+            te = O::blend(te, t, upd_enter);
+            ti = O::blend(ti, O::set1(T(f)), upd_enter);
+            tx = O::blend(tx, t, upd_exit);
+
+            if (l == Block::WIDTH - 1 || f == count - 1) {
+                fail = O::bit_or(fail, O::bit_or(O::ge(te, tx), O::bit_or(O::le(tx, vmin), O::ge(te, vmax))));
+                if ((LaneMask(O::movemask(fail)) & want) == want) break;
+            }
+        }
+
+        alignas(32) T face[W];
+        O::storeu(t_enter + k, te);
+        O::storeu(t_exit + k, tx);
+        O::store(face, ti);
+        for (int l = 0; l < W; l++) enter_face[k + l] = (int)face[l];
+        ok |= (LaneMask(~O::movemask(fail)) & want) << k;
+    }
+    return ok;
+}
+
+#endif
+
+}
+
+void Polyhedron::compile() {
+    compile(nullptr);
+    bounded = compute_bounds(bounds);
+}
+
+void Polyhedron::compile(const AABB* box) {
+    FaceRange faces = this->faces();
+    int count = (int)num_faces;
+    size_t nblocks = block_count();
+    // Recompilado com o mesmo número de blocos: reaproveita a faixa
+    if (nblocks != num_blocks) {
+        first_block = pool->blocks.size();
+        num_blocks = nblocks;
+        pool->blocks.resize(first_block + nblocks);
+    }
+    PlaneBlock* blocks = pool->blocks.data() + first_block;
+    for (int k = 0; k < (int)nblocks * PlaneBlock::WIDTH; k++) {
+        PlaneBlock& b = blocks[k / PlaneBlock::WIDTH];
+        int l = k % PlaneBlock::WIDTH;
+        if (k < count) {
+            b.nx[l] = faces[k].normal.x;
+            b.ny[l] = faces[k].normal.y;
+            b.nz[l] = faces[k].normal.z;
+            b.d[l] = faces[k].d;
+        } else {
+            b.nx[l] = b.ny[l] = b.nz[l] = 0;
+            b.d[l] = -1;
+        }
+    }
+
+    bounded = box != nullptr;
+    if (box) bounds = *box;
+}
+
+bool Polyhedron::slab_interval(const Ray& r, double t_min, double t_max,
+                               Real& t_enter, Real& t_exit, int& enter_face) const {
+    int count = (int)num_faces;
+    const PlaneBlock* blocks = pool->blocks.data() + first_block;
+#ifdef RT_X86_SIMD
+    if (simd_level() >= SIMD_AVX2) {
+        return slab_avx2(blocks, count, r, t_min, t_max, t_enter, t_exit, enter_face);
+    }
+#endif
+    return slab_scalar(blocks, count, r, t_min, t_max, t_enter, t_exit, enter_face);
+}
+
+AABB Polyhedron::padded_bounds() const {
+    AABB box = bounds;
+    double extent = std::max(box.max.x - box.min.x, std::max(box.max.y - box.min.y, box.max.z - box.min.z));
+    box.pad(1e-5 * (1.0 + extent)); // Os vértices vêm de contas arredondadas
+    return box;
+}
+
+bool Polyhedron::box_rejects(const Ray& r, double t_min, double t_max) const {
+    if (!bounded || (int)num_faces < BOX_TEST_MIN_FACES) return false;
+    Vec3 inv_dir(1.0 / r.direction.x, 1.0 / r.direction.y, 1.0 / r.direction.z);
+    return !padded_bounds().hit(r, inv_dir, t_min, t_max);
+}
+
+// box_rejects seguido de slab_interval para as lanes do pacote
+LaneMask Polyhedron::lanes_interval(const LaneRays& p, LaneMask lanes, double t_min, const Real* t_max,
+                                    Real* t_enter, Real* t_exit, int* enter_face) const {
+    if (bounded && (int)num_faces >= BOX_TEST_MIN_FACES) {
+        lanes = box_lanes(padded_bounds(), p, lanes, t_min, t_max);
+        if (!lanes) return 0;
+    }
+    int count = (int)num_faces;
+    const PlaneBlock* blocks = pool->blocks.data() + first_block;
+#ifdef RT_X86_SIMD
+    if (simd_level() >= SIMD_AVX2) {
+        return slab_lanes_avx2(blocks, count, p, lanes, t_min, t_max, t_enter, t_exit, enter_face);
+    }
+#endif
+    return slab_lanes_scalar(blocks, count, p, lanes, t_min, t_max, t_enter, t_exit, enter_face);
+}
+
+void Polyhedron::set_hit_record(const Ray& r, Real t, int enter_face, HitRecord& rec) const {
+    rec.t = t;
+    rec.p = r.pointAt(t);
+    const Face* faces = pool->faces.data() + first_face;
+    if (enter_face >= 0) rec.normal = faces[enter_face].normal;
+    else rec.normal = faces[0].normal; // Fallback
+
+    rec.pigmentIndex = pigmentIndex;
+    rec.finishIndex = finishIndex;
+}
+
+bool Polyhedron::hit(const Ray& r, double t_min_d, double t_max_d, HitRecord& rec) const {
+    if (box_rejects(r, t_min_d, t_max_d)) return false;
+
+    Real t_enter, t_exit;
+    int enter_face;
+    if (!slab_interval(r, t_min_d, t_max_d, t_enter, t_exit, enter_face)) return false;
+
+    // Comparações em Real, como nos kernels
+    Real t_min = Real(t_min_d), t_max = Real(t_max_d);
+
+    // Verifica se a interseção é válida
+    if (t_enter < t_exit && t_exit > t_min) {
+        Real t = t_enter;
+        // Se a entrada está atrás da câmera, verificamos a saída (estamos dentro do objeto)
+        if (t < t_min) {
+            t = t_exit;
+             // Nota: Se estamos saindo, a normal deveria ser invertida,
+             // mas para convexos opacos simples, focamos na entrada.
+        }
+
+        if (t > t_min && t < t_max) {
+            set_hit_record(r, t, enter_face, rec);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Polyhedron::occluded(const Ray& r, double t_min_d, double t_max_d) const {
+    if (box_rejects(r, t_min_d, t_max_d)) return false;
+
+    Real t_enter, t_exit;
+    int enter_face;
+    if (!slab_interval(r, t_min_d, t_max_d, t_enter, t_exit, enter_face)) return false;
+
+    Real t_min = Real(t_min_d), t_max = Real(t_max_d);
+    if (t_enter < t_exit && t_exit > t_min) {
+        Real t = (t_enter < t_min) ? t_exit : t_enter;
+        return t > t_min && t < t_max;
+    }
+    return false;
+}
+
+LaneMask Polyhedron::hit_lanes(const LaneRays& p, LaneMask lanes, double t_min_d, const Real* t_max,
+                               Real* t_out, int* face_out) const {
+    Real t_enter[MAX_PACKET_LANES], t_exit[MAX_PACKET_LANES];
+    int enter_face[MAX_PACKET_LANES];
+    LaneMask inside = lanes_interval(p, lanes, t_min_d, t_max, t_enter, t_exit, enter_face);
+
+    // A mesma escolha de t de hit(), lane a lane
+    Real t_min = Real(t_min_d);
+    LaneMask out = 0;
+    for (LaneMask m = inside; m; m &= m - 1) {
+        int l = __builtin_ctzll(m);
+        if (t_enter[l] < t_exit[l] && t_exit[l] > t_min) {
+            Real t = t_enter[l] < t_min ? t_exit[l] : t_enter[l];
+            if (t > t_min && t < t_max[l]) {
+                t_out[l] = t;
+                face_out[l] = enter_face[l];
+                out |= LaneMask(1) << l;
+            }
+        }
+    }
+    return out;
+}
+
+LaneMask Polyhedron::occluded_lanes(const LaneRays& p, LaneMask lanes, double t_min, const Real* t_max) const {
+    Real t[MAX_PACKET_LANES];
+    int face[MAX_PACKET_LANES];
+    return hit_lanes(p, lanes, t_min, t_max, t, face);
+}
@@ -0,0 +1,1172 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include "render.h"
+#include "counters.h"
+#include "simd_ops.h"
+
+// Auxiliar para limitar valores entre 0 e 1 (clamp)
+Real clamp(Real x) { return x < 0 ? 0 : (x > 1 ? 1 : x); }
+Vec3 clamp_color(Vec3 c) { return Vec3(clamp(c.x), clamp(c.y), clamp(c.z)); }
+
+// Refletir um vetor em torno de uma normal
+Vec3 reflect(const Vec3& v, const Vec3& n) {
+    return v - 2 * dot(v, n) * n;
+}
+
+// Refratar um vetor (Lei de Snell)
+bool refract(const Vec3& v, const Vec3& n, Real ni_over_nt, Vec3& refracted) {
+    Vec3 uv = v.normalize();
+    Real dt = dot(uv, n);
+    Real discriminant = 1.0 - ni_over_nt * ni_over_nt * (1.0 - dt * dt);
+    if (discriminant > 0) {
+        refracted = ni_over_nt * (uv - n * dt) - n * sqrt(discriminant);
+        return true;
+    }
+    return false; // Reflexão interna total
+}
+
+// Derivada de v / |v| dada a derivada dv de v
+static Vec3 d_normalize(const Vec3& v, const Vec3& dv) {
+    Real vv = dot(v, v);
+    if (vv <= 0) return Vec3(0, 0, 0);
+    return (dv * vv - v * dot(v, dv)) / (vv * std::sqrt(vv));
+}
+
+// Leva os diferenciais do raio até o ponto atingido (plano tangente em rec):
+// dP = dO + t dD + dt D, com dt escolhido para dP ficar no plano.
+static bool transfer_differential(const Ray& r, const HitRecord& rec, const RayDifferential& diff,
+                                  Vec3& dPdx, Vec3& dPdy) {
+    Real dn = dot(r.direction, rec.normal);
+    if (std::fabs(dn) < 1e-12) return false;
+    Vec3 ax = diff.dOdx + rec.t * diff.dDdx;
+    Vec3 ay = diff.dOdy + rec.t * diff.dDdy;
+    dPdx = ax - r.direction * (dot(ax, rec.normal) / dn);
+    dPdy = ay - r.direction * (dot(ay, rec.normal) / dn);
+    return true;
+}
+
+// Diferenciais do raio refletido em P (mesma conta de reflect). A normal é
+// tratada como constante na vizinhança, o que ignora a curvatura das esferas.
+static RayDifferential reflect_differential(const Vec3& v, const Vec3& n, const RayDifferential& diff,
+                                            const Vec3& dPdx, const Vec3& dPdy) {
+    Vec3 dux = d_normalize(v, diff.dDdx);
+    Vec3 duy = d_normalize(v, diff.dDdy);
+    RayDifferential out;
+    out.dOdx = dPdx;
+    out.dOdy = dPdy;
+    out.dDdx = dux - 2 * dot(dux, n) * n;
+    out.dDdy = duy - 2 * dot(duy, n) * n;
+    return out;
+}
+
+// Diferenciais do raio refratado em P (derivada da fórmula de refract, com a
+// mesma aproximação de normal constante)
+static RayDifferential refract_differential(const Vec3& v, const Vec3& n, Real ni_over_nt,
+                                            const RayDifferential& diff, const Vec3& dPdx, const Vec3& dPdy) {
+    Vec3 uv = v.normalize();
+    Real dt = dot(uv, n);
+    Real root = std::sqrt(1.0 - ni_over_nt * ni_over_nt * (1.0 - dt * dt));
+    Vec3 dux = d_normalize(v, diff.dDdx);
+    Vec3 duy = d_normalize(v, diff.dDdy);
+    Real ddtx = dot(dux, n);
+    Real ddty = dot(duy, n);
+    Real k = ni_over_nt * ni_over_nt * dt / root;
+    RayDifferential out;
+    out.dOdx = dPdx;
+    out.dOdy = dPdy;
+    out.dDdx = ni_over_nt * (dux - n * ddtx) - n * (k * ddtx);
+    out.dDdy = ni_over_nt * (duy - n * ddty) - n * (k * ddty);
+    return out;
+}
+
+// Cor do pigmento em p. dPdx/dPdy (opcionais) são as variações de p entre
+// pixels vizinhos; com elas as texturas são filtradas conforme scene.texture_filter.
+Vec3 get_pigment_color(const Pigment& pig, const Vec3& p, TextureFilter filter,
+                       const Vec3* dPdx, const Vec3* dPdy) {
+    if (pig.type == SOLID) {
+        return pig.color;
+    } 
+    else if (pig.type == CHECKER) {
+        double s = pig.cube_size;
+        // Adiciona um pequeno epsilon para estabilidade numérica nas bordas
+        int cx = (int)floor((p.x + 0.0001) / s);
+        int cy = (int)floor((p.y + 0.0001) / s);
+        int cz = (int)floor((p.z + 0.0001) / s);
+
+        if ((cx + cy + cz) % 2 == 0) return pig.color;
+        else return pig.color2;
+    } 
+    else if (pig.type == TEXMAP) {
+        // Sem textura (ou se a leitura falhar em sample), retorna rosa erro
+        if (!pig.textureData) return Vec3(1, 0, 1);
+        RT_PHASE(PHASE_TEXTURE);
+
+        // P0 e P1 são os vetores de 4 elementos lidos do arquivo
+        
+        // s = P0 . PC (onde PC é x, y, z, 1)
+        double s = pig.tex_params[0] * p.x + 
+                   pig.tex_params[1] * p.y + 
+                   pig.tex_params[2] * p.z + 
+                   pig.tex_params[3]; 
+
+        // r = P1 . PC
+        double r = pig.tex_params[4] * p.x + 
+                   pig.tex_params[5] * p.y + 
+                   pig.tex_params[6] * p.z + 
+                   pig.tex_params[7]; 
+
+        if (filter == TEX_NEAREST) return pig.textureData->sample(s, r);
+
+        // As coordenadas são lineares em p, então as derivadas também são
+        double dsdx = 0, drdx = 0, dsdy = 0, drdy = 0;
+        if (dPdx && dPdy) {
+            dsdx = pig.tex_params[0] * dPdx->x + pig.tex_params[1] * dPdx->y + pig.tex_params[2] * dPdx->z;
+            drdx = pig.tex_params[4] * dPdx->x + pig.tex_params[5] * dPdx->y + pig.tex_params[6] * dPdx->z;
+            dsdy = pig.tex_params[0] * dPdy->x + pig.tex_params[1] * dPdy->y + pig.tex_params[2] * dPdy->z;
+            drdy = pig.tex_params[4] * dPdy->x + pig.tex_params[5] * dPdy->y + pig.tex_params[6] * dPdy->z;
+        }
+        return pig.textureData->sample(s, r, dsdx, drdx, dsdy, drdy, filter);
+    }
+    return Vec3(0, 0, 0);
+}
+
+// Gerador determinístico por pixel (splitmix64): as amostras de um pixel não
+// dependem da thread nem da ordem dos tiles, então a imagem é reprodutível.
+struct PixelRng {
+    uint64_t state;
+
+    PixelRng(int x, int y) : state(((uint64_t)(uint32_t)x << 32) ^ (uint32_t)y) {}
+    explicit PixelRng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniforme em [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// A luz pode contribuir para o ponto P (normal N, direção para o observador V)?
+// Fora do alcance da luz, ou com a superfície de costas para ela e sem brilho
+// especular possível, a contribuição é exatamente zero e a sombra não precisa
+// ser traçada. L e dist são a direção e a distância até a luz.
+static bool light_reaches(const Light& light, const Finish& fin, const Vec3& N, const Vec3& V,
+                          const Vec3& L, Real dist) {
+    if (dist > light.radius) return false;
+    if (dot(N, L) > 0) return true;
+    if (fin.alpha <= 0) return true; // pow(0, alpha) não se anula
+    if (fin.ks == 0) return false;
+    return dot(reflect(-L, N), V) > 0;
+}
+
+// Difusa + especular de uma luz não bloqueada, já atenuada
+static Vec3 light_contribution(const Light& light, const Finish& fin, const Vec3& obj_color,
+                               const Vec3& N, const Vec3& V, const Vec3& L, Real dist) {
+    Real n_dot_l = std::max(Real(0), dot(N, L));
+    Vec3 diffuse = fin.kd * n_dot_l * (light.color * obj_color);
+
+    Vec3 R = reflect(-L, N);
+    Real r_dot_v = std::max(Real(0), dot(R, V));
+    Vec3 specular = fin.ks * pow(r_dot_v, fin.alpha) * light.color;
+
+    Real att = 1.0 / (light.attenuation[0] + light.attenuation[1]*dist + light.attenuation[2]*dist*dist);
+    return (diffuse + specular) * att;
+}
+
+// Luzes a considerar num ponto: as da célula da grade, ou todas sem grade
+struct LightCandidates {
+    const int* index;
+    int count;
+
+    LightCandidates(const Scene& scene, const Vec3& P) : index(nullptr), count((int)scene.lights.size()) {
+        if (!scene.light_grid.empty()) index = scene.light_grid.candidates(P, count);
+    }
+
+    int operator[](int k) const { return index ? index[k] : k; }
+};
+
+// Semente do sorteio de luzes a partir do ponto: a mesma em qualquer thread
+static uint64_t point_seed(const Vec3& P) {
+    double c[3] = {P.x, P.y, P.z};
+    uint64_t h = 0x243F6A8885A308D3ULL;
+    for (int k = 0; k < 3; k++) {
+        uint64_t bits;
+        std::memcpy(&bits, &c[k], sizeof(bits));
+        h = (h ^ bits) * 0x100000001B3ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+// Último objeto que bloqueou cada luz, por thread. Pixels vizinhos costumam
+// ter a sombra de uma luz feita pelo mesmo objeto; testá-lo primeiro evita
+// percorrer a BVH. O índice é só um palpite: um valor velho (de outra cena ou
+// de outra região da imagem) custa um teste a mais, mas não muda o resultado.
+static int* shadow_cache(const Scene& scene) {
+    thread_local std::vector<int> last;
+    if (last.size() < scene.lights.size()) last.resize(scene.lights.size(), -1);
+    return last.data();
+}
+
+// O cache de sombra da luz li bloqueia o raio?
+static bool cached_occluder_blocks(const Scene& scene, int cached, const Ray& r, double t_max) {
+    if (cached < 0 || cached >= (int)scene.objects.size()) return false;
+    RT_COUNT(shadow_cache_tests, 1);
+    if (!scene.objects[cached]->occluded(r, 0.001, t_max)) return false;
+    RT_COUNT(shadow_cache_hits, 1);
+    return true;
+}
+
+// Raio de sombra até a luz li, passando primeiro pelo cache
+static bool shadow_occluded(const Scene& scene, const Ray& r, Real dist, int li) {
+    RT_COUNT(shadow_rays, 1);
+    RT_PHASE(PHASE_SHADOW);
+    if (!scene.shadow_cache) return scene.occluded(r, 0.001, dist);
+
+    int& last = shadow_cache(scene)[li];
+    if (cached_occluder_blocks(scene, last, r, dist)) return true;
+    int occluder = -1;
+    if (!scene.occluded(r, 0.001, dist, &occluder)) return false;
+    if (occluder >= 0) last = occluder;
+    return true;
+}
+
+// Iluminação direta por amostragem: em vez de uma sombra por luz, sorteia
+// scene.light_samples luzes com probabilidade proporcional à contribuição sem
+// sombra (o maior canal) e divide cada uma pela sua probabilidade, o que dá,
+// em média, a mesma soma. Com poucas luzes relevantes todas são traçadas.
+static Vec3 sample_lights(const Scene& scene, const Finish& fin, const Vec3& obj_color,
+                          const Vec3& P, const Vec3& N, const Vec3& V) {
+    struct Candidate {
+        Vec3 L, contribution;
+        Real dist;
+        double weight;
+        int light;
+    };
+    thread_local std::vector<Candidate> cands;
+    cands.clear();
+
+    double total = 0;
+    LightCandidates lights(scene, P);
+    for (int k = 0; k < lights.count; k++) {
+        const Light& light = scene.lights[lights[k]];
+        Vec3 L_vec = light.position - P;
+        Real dist = L_vec.length();
+        Vec3 L = L_vec.normalize();
+        if (!light_reaches(light, fin, N, V, L, dist)) continue;
+        Vec3 c = light_contribution(light, fin, obj_color, N, V, L, dist);
+        double w = std::max(c.x, std::max(c.y, c.z));
+        if (!(w > 0)) continue;
+        cands.push_back(Candidate{L, c, dist, w, lights[k]});
+        total += w;
+    }
+
+    auto visible = [&](const Candidate& c) { return !shadow_occluded(scene, Ray(P, c.L), c.dist, c.light); };
+
+    Vec3 sum(0, 0, 0);
+    int n = scene.light_samples;
+    if ((int)cands.size() <= n) {
+        for (const Candidate& c : cands) {
+            if (visible(c)) sum = sum + c.contribution;
+        }
+        return sum;
+    }
+
+    PixelRng rng(point_seed(P));
+    for (int s = 0; s < n; s++) {
+        double u = rng.uniform() * total;
+        size_t k = 0;
+        while (k + 1 < cands.size() && u >= cands[k].weight) u -= cands[k++].weight;
+        const Candidate& c = cands[k];
+        if (visible(c)) sum = sum + c.contribution * Real(total / (n * c.weight));
+    }
+    return sum;
+}
+
+namespace {
+
+// Nó da árvore de raios de um pixel (raio primário, reflexões e refrações)
+struct RayNode {
+    Ray ray;
+    RayDifferential diff;
+    bool has_diff;
+    int depth;
+    double weight;        // Produto dos kr/kt do caminho até aqui
+    int parent;           // -1 na raiz
+    int slot;             // 0: reflexão do pai, 1: refração do pai
+    Vec3 local;           // Iluminação local no ponto atingido
+    Real kr, kt;
+    bool reflects, refracts;
+    Vec3 child[2];        // Cor dos filhos (zero se não foram traçados)
+};
+
+}
+
+// Cor do pigmento no ponto rec do nó, e pegada do pixel na superfície
+// (dPdx/dPdy, só usada para filtrar texturas, aqui e nos raios filhos)
+static Vec3 surface_color(const Scene& scene, const RayNode& node, const HitRecord& rec,
+                          Vec3& dPdx, Vec3& dPdy, bool& footprint) {
+    const Pigment& pig = scene.pigments[rec.pigmentIndex];
+    footprint = node.has_diff && scene.texture_filter != TEX_NEAREST &&
+                transfer_differential(node.ray, rec, node.diff, dPdx, dPdy);
+    return footprint ? get_pigment_color(pig, rec.p, scene.texture_filter, &dPdx, &dPdy)
+                     : get_pigment_color(pig, rec.p, scene.texture_filter, nullptr, nullptr);
+}
+
+// Cria os raios de reflexão e refração do nó idx no ponto rec; os índices dos
+// novos nós vão para spawned, se dado. Filhos com profundidade acima de
+// max_depth ou peso abaixo de min_weight não são criados e contribuem com
+// preto (como um raio além do limite).
+static void spawn_children(const Scene& scene, std::vector<RayNode>& nodes, int idx, const HitRecord& rec,
+                           bool footprint, const Vec3& dPdx, const Vec3& dPdy, std::vector<int>* spawned) {
+    const Ray r = nodes[idx].ray;
+    const Finish& fin = scene.finishes[rec.finishIndex];
+    Vec3 P = rec.p;
+    Vec3 N = rec.normal;
+
+    nodes[idx].kr = fin.kr;
+    nodes[idx].kt = fin.kt;
+    nodes[idx].reflects = false;
+    nodes[idx].refracts = false;
+
+    int depth = nodes[idx].depth;
+    double weight = nodes[idx].weight;
+    auto spawn = [&](const Ray& child_ray, const RayDifferential* child_diff, int slot, double k) {
+        if (depth + 1 > scene.max_depth || weight * k < scene.min_weight) return;
+        RayNode child;
+        child.ray = child_ray;
+        child.has_diff = child_diff != nullptr;
+        if (child_diff) child.diff = *child_diff;
+        child.depth = depth + 1;
+        child.weight = weight * k;
+        child.parent = idx;
+        child.slot = slot;
+        if (spawned) spawned->push_back((int)nodes.size());
+        nodes.push_back(child);
+    };
+
+    // --- Componente Global: Reflexão (kr) --- 
+    if (fin.kr > 0) {
+        nodes[idx].reflects = true;
+        Vec3 reflected_dir = reflect(r.direction.normalize(), N);
+        Ray reflected_ray(P, reflected_dir);
+        RayDifferential reflected_diff;
+        if (footprint) reflected_diff = reflect_differential(r.direction, N, nodes[idx].diff, dPdx, dPdy);
+        spawn(reflected_ray, footprint ? &reflected_diff : nullptr, 0, fin.kr);
+    }
+
+    // --- Componente Global: Transmissão/Refração (kt) --- 
+    if (fin.kt > 0) {
+        Vec3 outward_normal;
+        Real ni_over_nt;
+        Vec3 refracted_dir;
+        
+        // Verifica se o raio está entrando ou saindo do objeto
+        if (dot(r.direction, N) > 0) {
+            outward_normal = -N;
+            ni_over_nt = fin.ior; // Saindo: n2 / n1 
+        } else {
+            outward_normal = N;
+            ni_over_nt = 1.0 / fin.ior; // Entrando: n1 / n2
+        }
+
+        if (refract(r.direction, outward_normal, ni_over_nt, refracted_dir)) {
+            nodes[idx].refracts = true;
+            Ray refracted_ray(P, refracted_dir);
+            RayDifferential refracted_diff;
+            if (footprint) {
+                refracted_diff = refract_differential(r.direction, outward_normal, ni_over_nt,
+                                                      nodes[idx].diff, dPdx, dPdy);
+            }
+            spawn(refracted_ray, footprint ? &refracted_diff : nullptr, 1, fin.kt);
+        } 
+    }
+}
+
+// Iluminação local do ponto rec e criação dos raios filhos do nó idx
+static void expand_node(const Scene& scene, std::vector<RayNode>& nodes, int idx, const HitRecord& rec,
+                        const bool* light_visible, std::vector<int>& stack) {
+    RT_PHASE(PHASE_SHADING);
+    const Finish& fin = scene.finishes[rec.finishIndex];
+    
+    Vec3 P = rec.p;
+    Vec3 N = rec.normal;
+    Vec3 V = -nodes[idx].ray.direction.normalize(); 
+    
+    Vec3 dPdx, dPdy;
+    bool footprint;
+    Vec3 obj_color = surface_color(scene, nodes[idx], rec, dPdx, dPdy, footprint);
+
+    Vec3 local_color = fin.ka * scene.ambient_light * obj_color; // Ambiente
+
+    if (scene.light_samples > 0 && !light_visible) {
+        local_color = local_color + sample_lights(scene, fin, obj_color, P, N, V);
+    } else {
+        LightCandidates lights(scene, P);
+        for (int k = 0; k < lights.count; k++) {
+            int li = lights[k];
+            const Light& light = scene.lights[li];
+            Vec3 L_vec = light.position - P;
+            Real dist = L_vec.length();
+            Vec3 L = L_vec.normalize();
+            if (!light_reaches(light, fin, N, V, L, dist)) continue;
+
+            // Sombra (já traçada em pacote, ou traçada aqui)
+            bool in_shadow;
+            if (light_visible) {
+                in_shadow = !light_visible[li];
+            } else {
+                Ray shadow_ray(P, L);
+                in_shadow = shadow_occluded(scene, shadow_ray, dist, li);
+            }
+
+            if (!in_shadow) local_color = local_color + light_contribution(light, fin, obj_color, N, V, L, dist);
+        }
+    }
+
+    nodes[idx].local = local_color;
+    spawn_children(scene, nodes, idx, rec, footprint, dPdx, dPdy, &stack);
+}
+
+// Avalia a árvore de raios com uma pilha explícita em vez de recursão.
+// A cor de cada nó é clamp(local + kr * reflexão + kt * refração), como na
+// versão recursiva; por isso os nós são avaliados de trás para frente (todo
+// filho é criado depois do pai). root_rec/root_visible, se dados, são a
+// interseção e as sombras já calculadas do raio raiz.
+static Vec3 trace_tree(const Scene& scene, const Ray& r, int depth, const RayDifferential* diff,
+                       const HitRecord* root_rec, const bool* root_visible) {
+    if (depth > scene.max_depth) return Vec3(0, 0, 0);
+
+    // Reaproveitados entre chamadas da mesma thread
+    thread_local std::vector<RayNode> nodes;
+    thread_local std::vector<int> stack;
+    nodes.clear();
+    stack.clear();
+
+    RayNode root;
+    root.ray = r;
+    root.has_diff = diff != nullptr;
+    if (diff) root.diff = *diff;
+    root.depth = depth;
+    root.weight = 1.0;
+    root.parent = -1;
+    root.slot = 0;
+    nodes.push_back(root);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        int idx = stack.back();
+        stack.pop_back();
+
+        HitRecord rec;
+        const bool* visible = nullptr;
+        if (idx == 0 && root_rec) {
+            rec = *root_rec;
+            visible = root_visible;
+        } else {
+            bool found;
+            if (idx == 0) {
+                RT_COUNT(primary_rays, 1);
+                RT_PHASE(PHASE_PRIMARY);
+                found = scene.hit(nodes[idx].ray, 0.001, 999999.0, rec);
+            } else {
+                if (nodes[idx].slot == 0) RT_COUNT(reflection_rays, 1);
+                else RT_COUNT(refraction_rays, 1);
+                RT_PHASE(PHASE_SECONDARY);
+                found = scene.hit(nodes[idx].ray, 0.001, 999999.0, rec);
+            }
+            if (!found) {
+                // Fundo preto
+                nodes[idx].local = Vec3(0, 0, 0);
+                nodes[idx].reflects = nodes[idx].refracts = false;
+                continue;
+            }
+        }
+        expand_node(scene, nodes, idx, rec, visible, stack);
+    }
+
+    Vec3 result;
+    for (int idx = (int)nodes.size() - 1; idx >= 0; idx--) {
+        const RayNode& n = nodes[idx];
+        Vec3 final_color = n.local;
+        if (n.reflects) final_color = final_color + n.kr * n.child[0];
+        if (n.refracts) final_color = final_color + n.kt * n.child[1];
+        final_color = clamp_color(final_color);
+
+        if (n.parent >= 0) nodes[n.parent].child[n.slot] = final_color;
+        else result = final_color;
+    }
+    return result;
+}
+
+Vec3 cast_ray(const Ray& r, const Scene& scene, int depth, const RayDifferential* diff) {
+    return trace_tree(scene, r, depth, diff, nullptr, nullptr);
+}
+
+Vec3 shade_hit(const Ray& r, const HitRecord& rec, const Scene& scene, int depth, const bool* light_visible,
+               const RayDifferential* diff) {
+    return trace_tree(scene, r, depth, diff, &rec, light_visible);
+}
+
+namespace {
+
+// Raio de sombra pendente do modo wavefront: se não estiver bloqueado,
+// contribution entra na iluminação local do nó
+struct ShadowQuery {
+    Ray ray;
+    Real dist;
+    int light;
+    int node;
+    Vec3 contribution;
+};
+
+// Filas do modo wavefront, reaproveitadas entre os tiles de uma thread
+struct Wavefront {
+    std::vector<RayNode> nodes;     // Todos os nós do tile; cada geração é uma faixa contígua
+    std::vector<HitRecord> recs;    // Interseções da geração atual
+    std::vector<uint8_t> found;
+    std::vector<std::pair<uint64_t, int>> order; // Chave de material e posição na geração
+    std::vector<ShadowQuery> shadows;
+};
+
+}
+
+// Chave de ordenação dos pontos atingidos: tipo do pigmento (sólido, xadrez ou
+// textura), pigmento e acabamento. O tipo da primitiva fica de fora: o
+// sombreamento só lê ponto, normal e material do HitRecord, e é o mesmo para
+// todas as primitivas; e a interseção não é ordenada, porque o tipo só é
+// conhecido depois que a travessia da BVH (comum a todos os tipos) termina.
+static uint64_t material_key(const Scene& scene, const HitRecord& rec) {
+    return (uint64_t(scene.pigments[rec.pigmentIndex].type) << 48) |
+           (uint64_t(uint32_t(rec.pigmentIndex) & 0xFFFFFF) << 24) | (uint32_t(rec.finishIndex) & 0xFFFFFF);
+}
+
+// Estágio de sombreamento do nó idx: iluminação ambiente, um raio de sombra
+// pendente por luz que alcança o ponto e os raios filhos da próxima geração.
+// Com sorteio de luzes as sombras são traçadas aqui mesmo.
+static void wavefront_shade(const Scene& scene, Wavefront& wf, int idx, const HitRecord& rec) {
+    RT_PHASE(PHASE_SHADING);
+    const Finish& fin = scene.finishes[rec.finishIndex];
+
+    Vec3 P = rec.p;
+    Vec3 N = rec.normal;
+    Vec3 V = -wf.nodes[idx].ray.direction.normalize();
+
+    Vec3 dPdx, dPdy;
+    bool footprint;
+    Vec3 obj_color = surface_color(scene, wf.nodes[idx], rec, dPdx, dPdy, footprint);
+
+    Vec3 local_color = fin.ka * scene.ambient_light * obj_color;
+
+    if (scene.light_samples > 0) {
+        local_color = local_color + sample_lights(scene, fin, obj_color, P, N, V);
+    } else {
+        LightCandidates lights(scene, P);
+        for (int k = 0; k < lights.count; k++) {
+            int li = lights[k];
+            const Light& light = scene.lights[li];
+            Vec3 L_vec = light.position - P;
+            Real dist = L_vec.length();
+            Vec3 L = L_vec.normalize();
+            if (!light_reaches(light, fin, N, V, L, dist)) continue;
+            wf.shadows.push_back(ShadowQuery{Ray(P, L), dist, li, idx,
+                                             light_contribution(light, fin, obj_color, N, V, L, dist)});
+        }
+    }
+
+    wf.nodes[idx].local = local_color;
+    spawn_children(scene, wf.nodes, idx, rec, footprint, dPdx, dPdy, nullptr);
+}
+
+// Modo wavefront: em vez de seguir a árvore de cada pixel até o fim, o tile
+// inteiro avança uma geração de raios por vez (primários, depois reflexões e
+// refrações de primeiro nível, e assim por diante). Cada geração passa pelos
+// estágios de interseção, ordenação dos pontos atingidos por material,
+// sombreamento (que enfileira as sombras e cria a geração seguinte) e sombras.
+// No fim a cor de cada nó é composta de trás para frente, como em trace_tree,
+// e a imagem é a mesma.
+static void render_tile_wavefront(const Scene& scene, const Tile& tile, Framebuffer& fb) {
+    thread_local Wavefront wf;
+    std::vector<RayNode>& nodes = wf.nodes;
+    nodes.clear();
+
+    // Geração: um raio primário por pixel, em ordem de varredura (as mesmas
+    // contas de trace_sample)
+    Camera& cam = *scene.camera;
+    int nx = fb.image_width;
+    int ny = fb.image_height;
+    for (int y = tile.y0; y < tile.y1; y++) {
+        for (int i = tile.x0; i < tile.x1; i++) {
+            double u = double(fb.x0 + i) / double(nx);
+            double v = double(ny - 1 - (fb.y0 + y)) / double(ny);
+            RayNode root;
+            root.ray = cam.get_ray(u, v);
+            root.has_diff = scene.texture_filter != TEX_NEAREST;
+            if (root.has_diff) cam.ray_differential(u, v, 1.0 / nx, -1.0 / ny, root.diff);
+            root.depth = 0;
+            root.weight = 1.0;
+            root.parent = -1;
+            root.slot = 0;
+            nodes.push_back(root);
+        }
+    }
+
+    size_t begin = 0, end = nodes.size();
+    while (begin < end) {
+        size_t count = end - begin;
+        bool primary = begin == 0;
+
+        // Interseção
+        wf.recs.resize(count);
+        wf.found.resize(count);
+        {
+            if (primary) RT_COUNT(primary_rays, count);
+            RT_PHASE(primary ? PHASE_PRIMARY : PHASE_SECONDARY);
+            for (size_t k = 0; k < count; k++) {
+                RayNode& n = nodes[begin + k];
+                if (!primary) {
+                    if (n.slot == 0) RT_COUNT(reflection_rays, 1);
+                    else RT_COUNT(refraction_rays, 1);
+                }
+                wf.found[k] = scene.hit(n.ray, 0.001, 999999.0, wf.recs[k]);
+            }
+        }
+
+        // Ordenação por material; quem não atingiu nada fica com o fundo preto
+        wf.order.clear();
+        for (size_t k = 0; k < count; k++) {
+            if (wf.found[k]) {
+                wf.order.emplace_back(material_key(scene, wf.recs[k]), (int)k);
+            } else {
+                RayNode& n = nodes[begin + k];
+                n.local = Vec3(0, 0, 0);
+                n.reflects = n.refracts = false;
+            }
+        }
+        std::sort(wf.order.begin(), wf.order.end());
+
+        // Sombreamento (nodes cresce com a próxima geração)
+        wf.shadows.clear();
+        for (const auto& o : wf.order) wavefront_shade(scene, wf, int(begin + o.second), wf.recs[o.second]);
+
+        // Sombras, na ordem em que foram enfileiradas: as de um mesmo nó vêm em
+        // ordem crescente de luz, então a soma da iluminação local é a mesma de expand_node
+        for (const ShadowQuery& q : wf.shadows) {
+            if (!shadow_occluded(scene, q.ray, q.dist, q.light)) nodes[q.node].local = nodes[q.node].local + q.contribution;
+        }
+
+        begin = end;
+        end = nodes.size();
+    }
+
+    int w = tile.x1 - tile.x0;
+    for (int idx = (int)nodes.size() - 1; idx >= 0; idx--) {
+        const RayNode& n = nodes[idx];
+        Vec3 final_color = n.local;
+        if (n.reflects) final_color = final_color + n.kr * n.child[0];
+        if (n.refracts) final_color = final_color + n.kt * n.child[1];
+        final_color = clamp_color(final_color);
+
+        if (n.parent >= 0) nodes[n.parent].child[n.slot] = final_color;
+        else fb.at(tile.x0 + idx % w, tile.y0 + idx / w) = final_color;
+    }
+}
+
+// Uma amostra na posição (x, y) da tela virtual, em pixels (a amostra original
+// de cada pixel fica no canto inteiro). Os diferenciais cobrem um pixel.
+static Vec3 trace_sample(const Scene& scene, int nx, int ny, double x, double y) {
+    double u = x / double(nx);
+    double v = y / double(ny);
+
+    Ray r = scene.camera->get_ray(u, v);
+    if (scene.texture_filter == TEX_NEAREST) return cast_ray(r, scene, 0);
+
+    RayDifferential diff;
+    scene.camera->ray_differential(u, v, 1.0 / nx, -1.0 / ny, diff);
+    return cast_ray(r, scene, 0, &diff);
+}
+
+#ifdef RT_X86_SIMD
+// Direções dos raios primários com AVX2 (4 lanes por instrução em double, 8
+// em float): as contas de Camera::get_ray e de Vec3::normalize na mesma
+// ordem e sem FMA, e o inverso da direção de RayPacket::finalize.
+template<int N>
+__attribute__((target("avx2")))
+static void primary_directions_avx2(const Camera& cam, const Real* s, const Real* t, RayPacket<N>& p) {
+    typedef Avx2Ops<Real> O;
+    typedef O::V V;
+    const Real corner[3] = {cam.lower_left_corner.x, cam.lower_left_corner.y, cam.lower_left_corner.z};
+    const Real hor[3] = {cam.horizontal.x, cam.horizontal.y, cam.horizontal.z};
+    const Real ver[3] = {cam.vertical.x, cam.vertical.y, cam.vertical.z};
+    const Real eye[3] = {cam.origin.x, cam.origin.y, cam.origin.z};
+    Real* dir[3] = {p.dx, p.dy, p.dz};
+    Real* inv[3] = {p.inv_dx, p.inv_dy, p.inv_dz};
+
+    for (int k = 0; k < N; k += O::LANES) {
+        V vs = O::loadu(s + k);
+        V vt = O::loadu(t + k);
+        V d[3];
+        for (int a = 0; a < 3; a++) {
+            d[a] = O::add(O::add(O::set1(corner[a]), O::mul(vs, O::set1(hor[a]))), O::mul(vt, O::set1(ver[a])));
+            d[a] = O::sub(d[a], O::set1(eye[a]));
+        }
+        V len = O::sqrt(O::add(O::add(O::mul(d[0], d[0]), O::mul(d[1], d[1])), O::mul(d[2], d[2])));
+        V positive = O::gt(len, O::zero());
+        for (int a = 0; a < 3; a++) {
+            d[a] = O::blend(d[a], O::div(d[a], len), positive);
+            O::storeu(dir[a] + k, d[a]);
+            O::storeu(inv[a] + k, O::div(O::set1(Real(1)), d[a]));
+        }
+    }
+}
+#endif
+
+// Raios primários do pacote para as coordenadas de tela (s[l], t[l]),
+// idênticos aos de Camera::get_ray
+template<int N>
+static void primary_rays(const Camera& cam, const Real* s, const Real* t, RayPacket<N>& p) {
+#ifdef RT_X86_SIMD
+    if (simd_level() >= SIMD_AVX2) {
+        primary_directions_avx2(cam, s, t, p);
+        for (int l = 0; l < N; l++) {
+            p.ox[l] = cam.origin.x;
+            p.oy[l] = cam.origin.y;
+            p.oz[l] = cam.origin.z;
+            p.rays[l] = Ray(cam.origin, Vec3(p.dx[l], p.dy[l], p.dz[l]));
+        }
+        return;
+    }
+#endif
+    for (int l = 0; l < N; l++) p.rays[l] = cam.get_ray(s[l], t[l]);
+    p.finalize();
+}
+
+// Renderiza um bloco B x B de pixels do tile como pacote: os raios primários
+// e, para cada luz, os raios de sombra de todas as lanes atravessam a BVH
+// juntos. A sombra de cada lane é então repassada para shade_hit.
+template<int B>
+static void render_block_packet(const Scene& scene, const Tile& tile, int bx, int by, Framebuffer& fb) {
+    const int N = B * B;
+    const Camera& cam = *scene.camera;
+    int nx = fb.image_width;
+    int ny = fb.image_height;
+
+    // Raios primários com as contas da câmera, os mesmos de trace_sample
+    // (get_ray converte s e t para Real)
+    RayPacket<N> primary;
+    alignas(32) Real s[N], t[N];
+    for (int l = 0; l < N; l++) {
+        int i = bx + l % B;
+        int y = by + l / B;
+        primary.active[l] = i < tile.x1 && y < tile.y1;
+
+        s[l] = Real(double(fb.x0 + i) / double(nx));
+        t[l] = Real(double(ny - 1 - (fb.y0 + y)) / double(ny));
+        primary.t_max[l] = 999999.0;
+    }
+    primary_rays(cam, s, t, primary);
+
+    bool hits[N];
+    HitRecord recs[N];
+    int lanes = 0;
+    for (int l = 0; l < N; l++) lanes += primary.active[l];
+    RT_COUNT(primary_rays, lanes);
+    {
+        RT_PHASE(PHASE_PRIMARY);
+        scene.hit_packet(primary, 0.001, hits, recs);
+    }
+
+    // Raios de sombra: um pacote por luz com as lanes que atingiram algo e que
+    // a luz alcança (ver light_reaches). Com sorteio de luzes, as sombras são
+    // traçadas em shade_hit, só para as luzes sorteadas.
+    bool sampled = scene.light_samples > 0;
+    size_t num_lights = sampled ? 0 : scene.lights.size();
+    // Reaproveitado entre blocos da mesma thread; só cresce
+    thread_local std::unique_ptr<bool[]> visible;
+    thread_local size_t visible_size = 0;
+    if (visible_size < N * num_lights + 1) {
+        visible_size = N * num_lights + 1;
+        visible.reset(new bool[visible_size]);
+    }
+    RayPacket<N> shadow;
+    Vec3 V[N];
+    for (int l = 0; l < N; l++) {
+        if (hits[l]) V[l] = -primary.rays[l].direction.normalize();
+    }
+
+    for (size_t li = 0; li < num_lights; li++) {
+        const Light& light = scene.lights[li];
+        int shadow_lanes = 0;
+        for (int l = 0; l < N; l++) {
+            shadow.active[l] = false;
+            if (!hits[l]) continue;
+            // As mesmas contas de expand_node, para que as decisões e os raios coincidam
+            Vec3 L_vec = light.position - recs[l].p;
+            Real dist = L_vec.length();
+            Vec3 L = L_vec.normalize();
+            shadow.active[l] = light_reaches(light, scene.finishes[recs[l].finishIndex], recs[l].normal, V[l], L, dist);
+            shadow.rays[l] = Ray(recs[l].p, L);
+            shadow.t_max[l] = dist;
+            shadow_lanes += shadow.active[l];
+        }
+        if (shadow_lanes == 0) {
+            for (int l = 0; l < N; l++) visible[l * num_lights + li] = false;
+            continue;
+        }
+        shadow.finalize();
+
+        bool occluded[N];
+        int occluders[N];
+        RT_COUNT(shadow_rays, shadow_lanes);
+        {
+            RT_PHASE(PHASE_SHADOW);
+            // Lanes bloqueadas pelo último bloqueador da luz saem do pacote
+            bool cached[N] = {};
+            if (scene.shadow_cache) {
+                int last = shadow_cache(scene)[li];
+                for (int l = 0; l < N; l++) {
+                    if (shadow.active[l] && cached_occluder_blocks(scene, last, shadow.rays[l], shadow.t_max[l])) {
+                        cached[l] = true;
+                        shadow.active[l] = false;
+                    }
+                }
+            }
+            scene.occluded_packet(shadow, 0.001, occluded, occluders);
+            for (int l = 0; l < N; l++) {
+                if (cached[l]) occluded[l] = true;
+                else if (scene.shadow_cache && occluded[l] && occluders[l] >= 0) shadow_cache(scene)[li] = occluders[l];
+            }
+        }
+        for (int l = 0; l < N; l++) visible[l * num_lights + li] = !occluded[l];
+    }
+
+    for (int l = 0; l < N; l++) {
+        if (!primary.active[l]) continue;
+        Vec3 col(0.0, 0.0, 0.0); // Fundo preto
+        if (hits[l]) {
+            if (scene.texture_filter == TEX_NEAREST) {
+                col = shade_hit(primary.rays[l], recs[l], scene, 0, sampled ? nullptr : &visible[l * num_lights]);
+            } else {
+                RayDifferential diff;
+                double u = double(fb.x0 + bx + l % B) / double(nx);
+                double v = double(ny - 1 - (fb.y0 + by + l / B)) / double(ny);
+                cam.ray_differential(u, v, 1.0 / nx, -1.0 / ny, diff);
+                col = shade_hit(primary.rays[l], recs[l], scene, 0, sampled ? nullptr : &visible[l * num_lights],
+                                &diff);
+            }
+        }
+        fb.at(bx + l % B, by + l / B) = col;
+    }
+}
+
+namespace {
+
+// Custo de pixels para o mapa de calor: tempo ou raios desde start(),
+// somado em fb.cost por charge(). Não faz nada se fb.cost estiver vazio.
+class PixelCost {
+public:
+    PixelCost(const RenderSettings& settings, Framebuffer& fb)
+        : fb(fb), metric(settings.heat_metric), on(!fb.cost.empty()), mark(0) {}
+
+    void start() {
+        if (on) mark = now();
+    }
+
+    // Divide o custo desde start() entre os pixels [x0, x1) x [y0, y1)
+    void charge(int x0, int y0, int x1, int y1) {
+        if (!on) return;
+        float c = float((now() - mark) / double((x1 - x0) * (y1 - y0)));
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) fb.cost[y * fb.width + x] += c;
+        }
+    }
+
+private:
+    Framebuffer& fb;
+    HeatMetric metric;
+    bool on;
+    double mark;
+
+    double now() const {
+        if (metric == HEAT_RAYS) return double(thread_ray_count());
+        return std::chrono::duration<double, std::nano>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+}
+
+void render_tile(const Scene& scene, const RenderSettings& settings, const Tile& tile, Framebuffer& fb) {
+    PixelCost cost(settings, fb);
+
+    if (settings.wavefront) {
+        cost.start();
+        render_tile_wavefront(scene, tile, fb);
+        cost.charge(tile.x0, tile.y0, tile.x1, tile.y1);
+        return;
+    }
+
+    if (settings.packet_size == 4 || settings.packet_size == 8) {
+        int b = settings.packet_size;
+        for (int by = tile.y0; by < tile.y1; by += b) {
+            for (int bx = tile.x0; bx < tile.x1; bx += b) {
+                cost.start();
+                if (b == 4) render_block_packet<4>(scene, tile, bx, by, fb);
+                else render_block_packet<8>(scene, tile, bx, by, fb);
+                cost.charge(bx, by, std::min(bx + b, tile.x1), std::min(by + b, tile.y1));
+            }
+        }
+        return;
+    }
+
+    int nx = fb.image_width;
+    int ny = fb.image_height;
+
+    for (int y = tile.y0; y < tile.y1; y++) {
+        // A linha y do framebuffer corresponde a j = ny - 1 - y na tela virtual
+        // (contando a partir do topo da imagem, não da região)
+        int j = ny - 1 - (fb.y0 + y);
+        for (int i = tile.x0; i < tile.x1; i++) {
+            cost.start();
+            fb.at(i, y) = trace_sample(scene, nx, ny, double(fb.x0 + i), double(j));
+            cost.charge(i, y, i + 1, y + 1);
+        }
+    }
+}
+
+// Maior diferença (entre canais) do pixel para os 4 vizinhos na primeira passada
+static Real local_contrast(const Framebuffer& base, int x, int y) {
+    const Vec3& c = base.at(x, y);
+    Real m = 0;
+    const int off[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    for (int k = 0; k < 4; k++) {
+        int xx = x + off[k][0];
+        int yy = y + off[k][1];
+        if (xx < 0 || yy < 0 || xx >= base.width || yy >= base.height) continue;
+        const Vec3& n = base.at(xx, yy);
+        m = std::max(m, std::max(std::fabs(c.x - n.x), std::max(std::fabs(c.y - n.y), std::fabs(c.z - n.z))));
+    }
+    return m;
+}
+
+void refine_tile(const Scene& scene, const RenderSettings& settings, const Tile& tile,
+                 const Framebuffer& base, Framebuffer& fb, RenderStats& stats) {
+    int nx = fb.image_width;
+    int ny = fb.image_height;
+    const int BATCH = 4;
+    uint64_t samples = 0, refined = 0;
+    PixelCost cost(settings, fb);
+
+    for (int y = tile.y0; y < tile.y1; y++) {
+        int j = ny - 1 - (fb.y0 + y);
+        for (int i = tile.x0; i < tile.x1; i++) {
+            if (local_contrast(base, i, y) <= settings.aa_threshold) continue;
+
+            // A amostra da primeira passada (canto do pixel) entra na média;
+            // as demais vêm em lotes de 4, uma em cada quadrante do pixel
+            // (jitter estratificado)
+            Vec3 first = base.at(i, y);
+            Vec3 sum = first;
+            Vec3 sum_sq = first * first;
+            int n = 1;
+            PixelRng rng(fb.x0 + i, fb.y0 + y);
+            cost.start();
+            while (n < settings.aa_samples) {
+                int batch = std::min(BATCH, settings.aa_samples - n);
+                for (int k = 0; k < batch; k++) {
+                    double jx = ((k & 1) + rng.uniform()) * 0.5;
+                    double jy = ((k >> 1) + rng.uniform()) * 0.5;
+                    Vec3 c = trace_sample(scene, nx, ny, fb.x0 + i + jx, j + jy);
+                    sum = sum + c;
+                    sum_sq = sum_sq + c * c;
+                }
+                n += batch;
+
+                // Para quando o erro padrão da média fica abaixo do limiar em todos os canais
+                Vec3 mean = sum / n;
+                Vec3 var = sum_sq / n - mean * mean;
+                double worst = std::max(var.x, std::max(var.y, var.z));
+                if (n >= 2 * BATCH && std::sqrt(std::max(0.0, worst) / n) < 0.5 * settings.aa_threshold) break;
+            }
+            fb.at(i, y) = sum / n;
+            cost.charge(i, y, i + 1, y + 1);
+            samples += n - 1;
+            refined++;
+        }
+    }
+
+    stats.extra_samples += samples;
+    stats.refined_pixels += refined;
+}
+
+void render_image(const Scene& scene, const RenderSettings& settings,
+                  TileScheduler& scheduler, Framebuffer& fb, const RowsReady& rows_ready,
+                  RenderStats* stats) {
+    std::vector<Tile> tiles = make_tiles(fb.width, fb.height, settings.tile_size);
+    bool adaptive = settings.aa_samples > 1;
+    RenderStats local_stats;
+    RenderStats& st = stats ? *stats : local_stats;
+    st.primary_samples = (uint64_t)fb.width * fb.height;
+
+    std::mutex print_mtx;
+    int total = (int)tiles.size();
+    int bands = (fb.height + settings.tile_size - 1) / settings.tile_size;
+
+    // Uma passada por todos os tiles. final_pass: as linhas ficam prontas ao fim dela
+    auto run_pass = [&](const char* label, bool final_pass, const TileScheduler::TileJob& job) {
+        std::atomic<int> done(0);
+
+        // Tiles restantes em cada faixa horizontal, para avisar quando linhas ficam prontas
+        std::unique_ptr<std::atomic<int>[]> band_remaining(new std::atomic<int>[bands]);
+        for (int b = 0; b < bands; b++) band_remaining[b] = 0;
+        for (const Tile& t : tiles) band_remaining[t.y0 / settings.tile_size]++;
+
+        scheduler.run(tiles, [&](const Tile& tile, int worker) {
+            job(tile, worker);
+
+            if (final_pass && rows_ready && --band_remaining[tile.y0 / settings.tile_size] == 0) {
+                rows_ready(tile.y0, tile.y1);
+            }
+
+            // Progresso a cada 10% dos tiles concluídos
+            int d = ++done;
+            if (settings.progress && d * 10 / total != (d - 1) * 10 / total) {
+                std::lock_guard<std::mutex> lock(print_mtx);
+                std::cout << label << d * 100 / total << "%" << std::endl;
+            }
+        });
+    };
+
+    run_pass("Progresso: ", !adaptive, [&](const Tile& tile, int) {
+        render_tile(scene, settings, tile, fb);
+    });
+    if (!adaptive) return;
+
+    // Antialiasing: o contraste é medido sobre uma cópia da primeira passada,
+    // já que os pixels vizinhos (de outros tiles) mudam durante o refinamento
+    Framebuffer base = fb;
+    std::atomic<uint64_t> extra(0), refined(0);
+    run_pass("Refinamento: ", true, [&](const Tile& tile, int) {
+        RenderStats tile_stats;
+        refine_tile(scene, settings, tile, base, fb, tile_stats);
+        extra += tile_stats.extra_samples;
+        refined += tile_stats.refined_pixels;
+    });
+    st.extra_samples = extra.load();
+    st.refined_pixels = refined.load();
+}
+
+// Passada progressiva com blocos b x b: traça o canto de cada bloco (exceto os
+// já traçados na passada anterior, de blocos 2b) e pinta o bloco inteiro com a cor.
+// Retorna o número de amostras; para no meio se stop() ficar verdadeiro.
+template<typename Stop>
+static uint64_t render_tile_blocks(const Scene& scene, const Tile& tile, int b, bool first_pass,
+                                   Framebuffer& fb, const Stop& stop) {
+    int nx = fb.image_width;
+    int ny = fb.image_height;
+    uint64_t samples = 0;
+    int x_start = (tile.x0 + b - 1) / b * b;
+    int y_start = (tile.y0 + b - 1) / b * b;
+
+    for (int y = y_start; y < tile.y1; y += b) {
+        if (stop()) break;
+        for (int x = x_start; x < tile.x1; x += b) {
+            if (!first_pass && x % (2 * b) == 0 && y % (2 * b) == 0) continue;
+            Vec3 col = trace_sample(scene, nx, ny, double(fb.x0 + x), double(ny - 1 - (fb.y0 + y)));
+            samples++;
+            int x1 = std::min(x + b, tile.x1);
+            int y1 = std::min(y + b, tile.y1);
+            for (int yy = y; yy < y1; yy++) {
+                for (int xx = x; xx < x1; xx++) fb.at(xx, yy) = col;
+            }
+        }
+    }
+    return samples;
+}
+
+bool render_progressive(const Scene& scene, const RenderSettings& settings, TileScheduler& scheduler,
+                        Framebuffer& fb, const PassDone& pass_done, const std::atomic<bool>* cancel,
+                        RenderStats* stats) {
+    typedef std::chrono::steady_clock Clock;
+    std::vector<Tile> tiles = make_tiles(fb.width, fb.height, settings.tile_size);
+    RenderStats local_stats;
+    RenderStats& st = stats ? *stats : local_stats;
+    st = RenderStats();
+
+    Clock::time_point start = Clock::now();
+    bool has_deadline = settings.time_budget > 0;
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double>(settings.time_budget));
+    std::atomic<bool> stopped(false);
+    auto stop = [&]() {
+        if (stopped.load(std::memory_order_relaxed)) return true;
+        if ((cancel && cancel->load()) || (has_deadline && Clock::now() >= deadline)) {
+            stopped = true;
+            return true;
+        }
+        return false;
+    };
+
+    // Blocos 8x8, 4x4, 2x2 e 1x1; a última passada é a imagem normal, com uma
+    // amostra exata por pixel. O antialiasing, se ligado, vem depois.
+    std::vector<int> blocks = {8, 4, 2, 1};
+    int passes = (int)blocks.size() + (settings.aa_samples > 1 ? 1 : 0);
+    std::mutex print_mtx;
+    int total = (int)tiles.size();
+
+    for (int pass = 0; pass < passes; pass++) {
+        std::atomic<int> done(0);
+        std::atomic<uint64_t> samples(0);
+        Clock::time_point pass_start = Clock::now();
+        bool aa_pass = pass == (int)blocks.size();
+
+        // O antialiasing mede o contraste sobre a imagem da passada anterior
+        Framebuffer base = aa_pass ? fb : Framebuffer(0, 0);
+        std::atomic<uint64_t> refined(0);
+
+        scheduler.run(tiles, [&](const Tile& tile, int) {
+            if (stop()) return;
+
+            uint64_t n;
+            if (aa_pass) {
+                RenderStats tile_stats;
+                refine_tile(scene, settings, tile, base, fb, tile_stats);
+                n = tile_stats.extra_samples;
+                refined += tile_stats.refined_pixels;
+            } else {
+                n = render_tile_blocks(scene, tile, blocks[pass], pass == 0, fb, stop);
+            }
+            uint64_t so_far = (samples += n);
+
+            // Progresso a cada 10% dos tiles, em raios primários por segundo
+            int d = ++done;
+            if (settings.progress && d * 10 / total != (d - 1) * 10 / total) {
+                double secs = std::chrono::duration<double>(Clock::now() - pass_start).count();
+                std::lock_guard<std::mutex> lock(print_mtx);
+                std::cout << "Passada " << pass + 1 << "/" << passes << ": " << d * 100 / total << "%, "
+                          << (secs > 0 ? double(so_far) / secs / 1e6 : 0.0) << " M raios/s" << std::endl;
+            }
+        });
+
+        if (aa_pass) {
+            st.extra_samples = samples.load();
+            st.refined_pixels = refined.load();
+        } else {
+            st.primary_samples += samples.load();
+        }
+
+        bool complete = !stopped.load();
+        if (pass_done) pass_done(pass + 1, passes, complete);
+        if (!complete) return false;
+    }
+    return true;
+}
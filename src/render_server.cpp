@@ -0,0 +1,534 @@
+#include "render_server.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "image_io.h"
+#include "scene_binary.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RT_HAVE_UNIX_SOCKETS 1
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef RT_HAVE_UNIX_SOCKETS
+
+// Protótipo da função parser
+bool loadScene(const std::string& filename, Scene& scene);
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double ms_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// SIGINT/SIGTERM: para de aceitar conexões e termina os pedidos da fila
+std::atomic<bool> stop_signal(false);
+
+void on_signal(int) {
+    stop_signal = true;
+}
+
+// Maior linha de pedido aceita e quanto esperar por ela (só a thread que lê
+// aquela conexão espera)
+const size_t MAX_REQUEST = 64 * 1024;
+const int REQUEST_TIMEOUT_S = 2;
+
+// Latências guardadas para a mediana e o percentil 95 do status
+const size_t LATENCY_WINDOW = 4096;
+
+// Pedido de renderização e a conexão que espera a resposta
+struct Job {
+    int fd = -1;
+    uint64_t id = 0;
+    std::string scene_file;
+    std::string output;
+    RenderSettings settings;
+    bool has_camera = false; // --camera: substitui a câmera da cena neste pedido
+    Vec3 eye, at, up;
+    double fov = 0;
+    Clock::time_point queued;
+};
+
+// Lê uma linha (sem o '\n') da conexão; false se ela fechou antes, demorou
+// demais ou passou de MAX_REQUEST
+bool read_line(int fd, std::string& line) {
+    timeval timeout = {REQUEST_TIMEOUT_S, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    line.clear();
+    char buf[4096];
+    while (line.size() < MAX_REQUEST) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) return false;
+        line.append(buf, n);
+        size_t end = line.find('\n');
+        if (end != std::string::npos) {
+            line.resize(end);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Responde e fecha a conexão. Um cliente que já foi embora não derruba o
+// servidor (SIGPIPE é ignorado).
+void reply(int fd, const std::string& text) {
+    std::string msg = text + "\n";
+    size_t sent = 0;
+    while (sent < msg.size()) {
+        ssize_t n = write(fd, msg.data() + sent, msg.size() - sent);
+        if (n <= 0) break;
+        sent += n;
+    }
+    close(fd);
+}
+
+std::vector<std::string> split_fields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    if (!fields.empty() && !fields.back().empty() && fields.back().back() == '\r') fields.back().pop_back();
+    return fields;
+}
+
+// Preenche job a partir dos campos de "render"; devolve a mensagem de erro ou ""
+std::string parse_job(const std::vector<std::string>& f, Job& job) {
+    if (f.size() < 3) return "uso: render <cena> <saida.ppm> [opcoes]";
+    job.scene_file = f[1];
+    job.output = f[2];
+    RenderSettings& s = job.settings;
+    for (size_t k = 3; k < f.size(); k++) {
+        const std::string& arg = f[k];
+        bool has_value = k + 1 < f.size();
+        if ((arg == "--width" || arg == "--height") && has_value) {
+            int& size = arg == "--width" ? s.width : s.height;
+            size = std::atoi(f[++k].c_str());
+            if (size < 1) return "dimensao invalida: " + f[k];
+        } else if (arg == "--camera" && k + 10 < f.size()) {
+            double v[10];
+            for (double& x : v) x = std::atof(f[++k].c_str());
+            job.eye = Vec3(Real(v[0]), Real(v[1]), Real(v[2]));
+            job.at = Vec3(Real(v[3]), Real(v[4]), Real(v[5]));
+            job.up = Vec3(Real(v[6]), Real(v[7]), Real(v[8]));
+            job.fov = v[9];
+            job.has_camera = true;
+        } else if (arg == "--aa" && has_value) {
+            s.aa_samples = std::atoi(f[++k].c_str());
+            if (s.aa_samples < 1) return "numero de amostras invalido: " + f[k];
+        } else if (arg == "--aa-threshold" && has_value) {
+            s.aa_threshold = std::atof(f[++k].c_str());
+        } else if (arg == "--max-depth" && has_value) {
+            s.max_depth = std::atoi(f[++k].c_str());
+            if (s.max_depth < 0) return "profundidade invalida: " + f[k];
+        } else if (arg == "--min-weight" && has_value) {
+            s.min_weight = std::atof(f[++k].c_str());
+        } else if (arg == "--texture-filter" && has_value) {
+            if (!parse_texture_filter(f[++k].c_str(), s.texture_filter)) return "filtro de textura invalido: " + f[k];
+        } else if (arg == "--ascii") {
+            s.ascii = true;
+        } else {
+            return "opcao desconhecida ou incompleta: " + arg;
+        }
+    }
+    return "";
+}
+
+class RenderServer {
+public:
+    RenderServer(const RenderSettings& s, int max_scenes)
+        : defaults(s), max_scenes(std::max(1, max_scenes)), scheduler(s.threads) {
+        defaults.progress = false;
+    }
+
+    int run(const std::string& socket_path);
+
+private:
+    // Cena lida e preparada, com a câmera original do arquivo (os pedidos com
+    // --camera a trocam só durante a renderização)
+    struct CachedScene {
+        std::unique_ptr<Scene> scene;
+        Camera camera;
+        std::filesystem::file_time_type mtime;
+        uint64_t last_use = 0;
+    };
+
+    RenderSettings defaults;
+    int max_scenes;
+    TileScheduler scheduler;
+
+    // Usadas só pela thread de renderização
+    std::map<std::string, CachedScene> scenes; // Por caminho absoluto
+    uint64_t use_clock = 0;
+
+    // Fila e estatísticas, protegidas por mtx
+    std::mutex mtx;
+    std::condition_variable queue_cv;
+    std::deque<Job> queue;
+    bool stopping = false;
+    bool busy = false;     // Há um pedido sendo renderizado
+    int readers = 0;       // Conexões sendo lidas, cada uma na sua thread
+    std::condition_variable readers_cv;
+    uint64_t next_id = 1;
+    uint64_t done = 0, failed = 0;
+    uint64_t scene_hits = 0, scene_loads = 0;
+    size_t cached_scenes = 0;
+    double latency_sum = 0, latency_max = 0;
+    std::vector<double> latencies; // Anel com as últimas LATENCY_WINDOW
+    size_t latency_next = 0;
+
+    void listen_loop(int listen_fd);
+    void handle_connection(int fd);
+    std::string status();
+    void process(Job& job);
+    CachedScene* acquire_scene(const std::string& file, bool& hit, std::string& error);
+    void record(double latency_ms, bool ok);
+};
+
+int RenderServer::run(const std::string& socket_path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Erro: Caminho de socket invalido ou longo demais: " << socket_path << std::endl;
+        return 1;
+    }
+    std::strcpy(addr.sun_path, socket_path.c_str());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Erro: Nao foi possivel criar o socket." << std::endl;
+        return 1;
+    }
+
+    // Um socket que sobrou de um servidor encerrado é removido; um que ainda
+    // aceita conexões (ou um arquivo que não é socket) não é tocado
+    struct stat st;
+    if (lstat(socket_path.c_str(), &st) == 0) {
+        bool in_use = connect(listen_fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+        close(listen_fd);
+        if (!S_ISSOCK(st.st_mode) || in_use) {
+            std::cerr << "Erro: " << socket_path << " ja existe" << (in_use ? " e esta em uso." : ".") << std::endl;
+            return 1;
+        }
+        unlink(socket_path.c_str());
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    }
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0) {
+        std::cerr << "Erro: Nao foi possivel escutar em " << socket_path << ": " << std::strerror(errno) << std::endl;
+        close(listen_fd);
+        return 1;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    std::cout << "Servidor em " << socket_path << " com " << scheduler.thread_count() << " thread(s), ate "
+              << max_scenes << " cena(s) em memoria" << std::endl;
+
+    // A thread que chama run() renderiza (o escalonador a usa como worker 0);
+    // outra aceita as conexões e enche a fila
+    std::thread listener(&RenderServer::listen_loop, this, listen_fd);
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            queue_cv.wait(lock, [this] { return !queue.empty() || stopping; });
+            if (queue.empty()) break;
+            job = queue.front();
+            queue.pop_front();
+            busy = true;
+        }
+        process(job);
+        std::lock_guard<std::mutex> lock(mtx);
+        busy = false;
+    }
+    listener.join();
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+
+    std::cout << "Servidor encerrado: " << status() << std::endl;
+    return 0;
+}
+
+void RenderServer::listen_loop(int listen_fd) {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (stopping) break;
+        }
+        if (stop_signal) break;
+        // Acorda de tempos em tempos para ver se chegou um sinal
+        pollfd p = {listen_fd, POLLIN, 0};
+        if (poll(&p, 1, 200) <= 0) continue;
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+        // Cada conexão é lida e interpretada numa thread própria, para que um
+        // cliente lento não atrase os outros; a fila continua com uma só
+        // thread renderizando
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            readers++;
+        }
+        std::thread([this, fd] {
+            handle_connection(fd);
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--readers == 0) readers_cv.notify_all();
+        }).detach();
+    }
+    // As leituras em andamento terminam (ou estouram o tempo) antes de o
+    // servidor encerrar
+    std::unique_lock<std::mutex> lock(mtx);
+    readers_cv.wait(lock, [this] { return readers == 0; });
+    stopping = true;
+    queue_cv.notify_all();
+}
+
+void RenderServer::handle_connection(int fd) {
+    std::string line;
+    if (!read_line(fd, line)) {
+        reply(fd, "erro pedido incompleto");
+        return;
+    }
+    std::vector<std::string> fields = split_fields(line);
+    const std::string& command = fields[0];
+
+    if (command == "render") {
+        Job job;
+        job.settings = defaults;
+        std::string error = parse_job(fields, job);
+        if (!error.empty()) {
+            reply(fd, "erro " + error);
+            return;
+        }
+        job.fd = fd;
+        job.queued = Clock::now();
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopping) {
+            // A thread de renderização pode já ter saído com a fila vazia
+            reply(fd, "erro servidor encerrando");
+            return;
+        }
+        job.id = next_id++;
+        queue.push_back(job);
+        queue_cv.notify_all();
+    } else if (command == "status") {
+        reply(fd, "ok " + status());
+    } else if (command == "stop") {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+        queue_cv.notify_all();
+        reply(fd, "ok encerrando depois de " + std::to_string(queue.size() + (busy ? 1 : 0)) + " pedido(s)");
+    } else {
+        reply(fd, "erro comando desconhecido: " + command);
+    }
+}
+
+// Estado do servidor em campos chave=valor (latências em ms, desde o início)
+std::string RenderServer::status() {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<double> recent = latencies;
+    std::sort(recent.begin(), recent.end());
+    auto percentile = [&](double p) { return recent.empty() ? 0.0 : recent[size_t(p * (recent.size() - 1))]; };
+    uint64_t finished = done + failed;
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "fila=" << queue.size() << " em_andamento=" << (busy ? 1 : 0)
+        << " atendidos=" << done << " falhas=" << failed
+        << " latencia_media_ms=" << (finished ? latency_sum / finished : 0.0)
+        << " latencia_mediana_ms=" << percentile(0.5) << " latencia_p95_ms=" << percentile(0.95)
+        << " latencia_max_ms=" << latency_max << " cenas=" << cached_scenes
+        << " cenas_em_cache=" << scene_hits << " cenas_lidas=" << scene_loads;
+    return out.str();
+}
+
+void RenderServer::record(double latency_ms, bool ok) {
+    std::lock_guard<std::mutex> lock(mtx);
+    (ok ? done : failed)++;
+    latency_sum += latency_ms;
+    latency_max = std::max(latency_max, latency_ms);
+    if (latencies.size() < LATENCY_WINDOW) {
+        latencies.push_back(latency_ms);
+    } else {
+        latencies[latency_next] = latency_ms;
+        latency_next = (latency_next + 1) % LATENCY_WINDOW;
+    }
+}
+
+// Alguma textura lida de arquivo mudou desde que a cena foi lida?
+static bool textures_changed(const Scene& scene) {
+    for (const Pigment& p : scene.pigments) {
+        if (p.textureData && p.textureData->changed()) return true;
+    }
+    return false;
+}
+
+// Cena do arquivo, da memória se nem ele nem as suas texturas mudaram desde a
+// leitura. Uma cena nova tira da memória a usada há mais tempo quando já há
+// max_scenes.
+RenderServer::CachedScene* RenderServer::acquire_scene(const std::string& file, bool& hit, std::string& error) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    std::string key = fs::absolute(file, ec).lexically_normal().string();
+    fs::file_time_type mtime = fs::last_write_time(key, ec);
+    if (ec) {
+        error = "cena nao encontrada: " + file;
+        return nullptr;
+    }
+
+    auto it = scenes.find(key);
+    hit = it != scenes.end() && it->second.mtime == mtime && !textures_changed(*it->second.scene);
+    if (hit) {
+        it->second.last_use = ++use_clock;
+        std::lock_guard<std::mutex> lock(mtx);
+        scene_hits++;
+        return &it->second;
+    }
+    if (it != scenes.end()) {
+        scenes.erase(it); // Arquivo ou textura alterados
+        std::lock_guard<std::mutex> lock(mtx);
+        cached_scenes = scenes.size();
+    }
+
+    std::unique_ptr<Scene> scene(new Scene());
+    bool compiled = is_compiled_scene(key);
+    bool loaded = compiled ? loadCompiledScene(key, *scene) : loadScene(key, *scene);
+    if (!loaded || !scene->camera) {
+        error = "falha ao carregar a cena: " + file;
+        return nullptr;
+    }
+    scene->light_cutoff = defaults.light_cutoff;
+    scene->light_samples = defaults.light_samples;
+    scene->shadow_cache = defaults.shadow_cache;
+    if (!compiled) scene->build_acceleration();
+    scene->prepare_lights();
+
+    while ((int)scenes.size() >= max_scenes) {
+        auto oldest = std::min_element(scenes.begin(), scenes.end(), [](const auto& a, const auto& b) {
+            return a.second.last_use < b.second.last_use;
+        });
+        scenes.erase(oldest);
+    }
+    // Texturas que só as cenas que saíram usavam (e versões antigas de arquivos
+    // alterados) deixam o cache, com os mapeamentos das cenas compiladas
+    TextureCache::instance().purge();
+
+    CachedScene& entry = scenes[key];
+    entry.camera = *scene->camera;
+    entry.scene = std::move(scene);
+    entry.mtime = mtime;
+    entry.last_use = ++use_clock;
+    std::lock_guard<std::mutex> lock(mtx);
+    scene_loads++;
+    cached_scenes = scenes.size();
+    return &entry;
+}
+
+void RenderServer::process(Job& job) {
+    Clock::time_point start = Clock::now();
+    bool hit = false;
+    std::string error;
+    CachedScene* entry = acquire_scene(job.scene_file, hit, error);
+    Clock::time_point loaded = Clock::now();
+
+    double render_ms = 0;
+    if (entry) {
+        Scene& scene = *entry->scene;
+        const RenderSettings& s = job.settings;
+        // A tela virtual segue a resolução do pedido
+        double aspect = double(s.width) / s.height;
+        if (job.has_camera) {
+            *scene.camera = Camera(job.eye, job.at, job.up, job.fov, aspect);
+        } else {
+            *scene.camera = entry->camera;
+            scene.camera->set_aspect(aspect);
+        }
+        scene.texture_filter = s.texture_filter;
+        scene.max_depth = s.max_depth;
+        scene.min_weight = s.min_weight;
+
+        Framebuffer fb(s.width, s.height);
+        render_image(scene, s, scheduler, fb);
+        render_ms = ms_between(loaded, Clock::now());
+        if (!write_ppm(job.output, fb, s.ascii ? PPM_ASCII : PPM_BINARY)) {
+            error = "falha ao gravar " + job.output;
+        }
+    }
+    Clock::time_point finished = Clock::now();
+
+    double wait_ms = ms_between(job.queued, start);
+    double load_ms = ms_between(start, loaded);
+    double total_ms = ms_between(job.queued, finished);
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    if (error.empty()) {
+        out << "ok espera_ms=" << wait_ms << " cena_ms=" << load_ms << " cena=" << (hit ? "cache" : "lida")
+            << " renderizacao_ms=" << render_ms << " total_ms=" << total_ms;
+    } else {
+        out << "erro " << error;
+    }
+    reply(job.fd, out.str());
+    record(total_ms, error.empty());
+
+    size_t waiting;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        waiting = queue.size();
+    }
+    std::ostringstream log;
+    log << std::fixed << std::setprecision(2) << "Pedido " << job.id << ": " << job.scene_file << " "
+        << job.settings.width << "x" << job.settings.height << " -> " << job.output << ", ";
+    if (error.empty()) {
+        log << "espera " << wait_ms << " ms, cena ";
+        if (hit) log << "em cache";
+        else log << "lida em " << load_ms << " ms";
+        log << ", renderizacao " << render_ms << " ms, total " << total_ms << " ms";
+    } else {
+        log << error;
+    }
+    std::cout << log.str() << " (fila: " << waiting << ")" << std::endl;
+}
+
+}
+
+int run_render_server(const std::string& socket_path, const RenderSettings& settings, int max_scenes) {
+    RenderServer server(settings, max_scenes);
+    return server.run(socket_path);
+}
+
+#else
+
+// Sem sockets Unix (Windows): o servidor não existe
+int run_render_server(const std::string&, const RenderSettings&, int) {
+    std::cerr << "Erro: --serve usa sockets Unix e nao e suportado nesta plataforma." << std::endl;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,631 @@
+#include "scene_binary.h"
+#include "mapped_file.h"
+#include "polyhedron.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+const uint32_t VERSION = 3;
+const uint32_t ENDIAN_MARK = 0x01020304; // Lido com outro valor: arquivo de outra ordem de bytes
+const uint64_t SECTION_ALIGN = 64;       // Cada seção começa numa linha de cache
+
+enum SectionId {
+    SEC_LIGHTS, SEC_PIGMENTS, SEC_FINISHES,
+    SEC_SPHERES, SEC_POLYHEDRA, SEC_FACES, SEC_OBJECTS, SEC_PROTOTYPES, SEC_INSTANCES,
+    SEC_NODES, SEC_PRIMS, SEC_UNBOUNDED,
+    SEC_TEXTURES, SEC_MIPS, SEC_TEXELS, SEC_STRINGS,
+    NUM_SECTIONS
+};
+
+// Os registros não têm bytes de preenchimento: campos de 8 bytes primeiro,
+// inteiros de 4 bytes sempre em pares
+
+struct Section {
+    uint64_t offset; // Em bytes, desde o início do arquivo
+    uint64_t count;  // Registros (bytes em SEC_TEXELS e SEC_STRINGS)
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t file_size;
+    double camera[3][3]; // Posição, alvo e up (a tela virtual depende da imagem)
+    double camera_fov;
+    double ambient[3];
+    Section sections[NUM_SECTIONS];
+};
+
+struct LightRecord {
+    double position[3], color[3], attenuation[3];
+};
+
+struct PigmentRecord {
+    double color[3], color2[3];
+    double cube_size;
+    double tex_params[8];
+    uint64_t name_offset, name_length; // tex_file em SEC_STRINGS
+    int32_t type;
+    int32_t texture; // Índice em SEC_TEXTURES; -1 se não embutida
+};
+
+struct FinishRecord {
+    double ka, kd, ks, alpha, kr, kt, ior;
+};
+
+struct SphereRecord {
+    double center[3], radius;
+    int32_t pigment, finish;
+};
+
+struct PolyhedronRecord {
+    double box_min[3], box_max[3];
+    uint64_t first_face, face_count; // Faixa em SEC_FACES
+    int32_t pigment, finish;
+    int32_t bounded, reserved;
+};
+
+struct FaceRecord {
+    double normal[3], d;
+};
+
+// Ordem original dos objetos: define os desempates da BVH. Os protótipos
+// (SEC_PROTOTYPES) usam o mesmo registro, só com esferas e poliedros.
+struct ObjectRecord {
+    int32_t type;  // ObjectType
+    int32_t index; // Em SEC_SPHERES, SEC_POLYHEDRA ou SEC_INSTANCES
+};
+
+struct InstanceRecord {
+    double to_object[3][4];
+    double box_min[3], box_max[3];
+    int32_t prototype; // Índice em SEC_PROTOTYPES
+    int32_t pigment, finish; // -1: os do protótipo
+    int32_t bounded;
+};
+
+struct NodeRecord {
+    double box_min[3], box_max[3];
+    int32_t first, count, axis, spheres;
+};
+
+struct TextureRecord {
+    uint64_t first_mip, mip_count;      // Faixa em SEC_MIPS
+    uint64_t texel_offset, texel_count; // Bytes em SEC_TEXELS; canais
+    int32_t width, height;
+    int32_t max_value, bytes_per_channel;
+};
+
+struct MipRecord {
+    uint64_t offset; // Em canais, como MipLevel::offset
+    int32_t width, height;
+};
+
+void put(double* out, const Vec3& v) {
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+Vec3 get(const double* in) {
+    return Vec3(in[0], in[1], in[2]);
+}
+
+uint64_t align_up(uint64_t n) {
+    return (n + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN;
+}
+
+// Conteúdo de uma seção enquanto o arquivo é montado
+struct SectionData {
+    vector<char> bytes;
+    uint64_t count = 0;
+
+    template<typename T>
+    void add(const T& rec) {
+        const char* p = reinterpret_cast<const char*>(&rec);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+        count++;
+    }
+
+    void add_bytes(const void* data, size_t n) {
+        const char* p = static_cast<const char*>(data);
+        bytes.insert(bytes.end(), p, p + n);
+        count += n;
+    }
+
+    // Completa com zeros até um múltiplo de 8 (SEC_TEXELS)
+    void pad() {
+        while (bytes.size() % 8) {
+            bytes.push_back(0);
+            count++;
+        }
+    }
+};
+
+template<typename T>
+T zeroed() {
+    T rec;
+    memset(&rec, 0, sizeof(T));
+    return rec;
+}
+
+bool invalid(const string& filename, const char* reason) {
+    cerr << "Erro: Cena compilada invalida (" << reason << "). Arquivo: " << filename << endl;
+    return false;
+}
+
+// Registros de uma seção, apontando direto para o arquivo mapeado
+template<typename T>
+struct SectionView {
+    const T* data = nullptr;
+    uint64_t count = 0;
+
+    const T& operator[](uint64_t i) const { return data[i]; }
+};
+
+template<typename T>
+bool section(const MappedFile& file, const FileHeader& h, SectionId id, SectionView<T>& view) {
+    const Section& s = h.sections[id];
+    if (s.offset % 8 != 0 || s.offset > file.size()) return false;
+    if (s.count > (file.size() - s.offset) / sizeof(T)) return false;
+    view.data = reinterpret_cast<const T*>(file.data() + s.offset);
+    view.count = s.count;
+    return true;
+}
+
+// Texels embutidos: copiados do arquivo mapeado quando a textura é amostrada
+// pela primeira vez
+Texture* embedded_texture(const unsigned char* texels, const TextureRecord& t,
+                          const vector<MipLevel>& mips, const string& name) {
+    auto start = chrono::steady_clock::now();
+    Texture* tex = new Texture();
+    tex->width = t.width;
+    tex->height = t.height;
+    tex->max_value = t.max_value;
+    tex->mips = mips;
+    const unsigned char* p = texels + t.texel_offset;
+    if (t.bytes_per_channel == 1) {
+        tex->texels8.assign(p, p + t.texel_count);
+    } else {
+        tex->texels16.resize(t.texel_count);
+        memcpy(tex->texels16.data(), p, t.texel_count * sizeof(uint16_t));
+    }
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    ostringstream msg;
+    msg << "Textura carregada: " << name << " (" << t.width << "x" << t.height << ", embutida, "
+        << 8 * t.bytes_per_channel << " bits/canal, " << mips.size() << " niveis de mip, "
+        << tex->memory_bytes() / 1024 << " KB em memoria, " << ms << " ms)\n";
+    cout << msg.str() << flush;
+    return tex;
+}
+
+}
+
+bool is_compiled_scene(const string& filename) {
+    ifstream file(filename, ios::binary);
+    char magic[sizeof(MAGIC)];
+    if (!file.read(magic, sizeof(magic))) return false;
+    return memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool writeCompiledScene(const string& filename, Scene& scene) {
+    SectionData sec[NUM_SECTIONS];
+
+    for (const Light& l : scene.lights) {
+        LightRecord r = zeroed<LightRecord>();
+        put(r.position, l.position);
+        put(r.color, l.color);
+        for (int k = 0; k < 3; k++) r.attenuation[k] = l.attenuation[k];
+        sec[SEC_LIGHTS].add(r);
+    }
+
+    // Cada textura distinta é embutida uma vez, com todos os níveis de mip
+    map<const TextureHandle*, int32_t> embedded;
+    for (const Pigment& p : scene.pigments) {
+        PigmentRecord r = zeroed<PigmentRecord>();
+        r.type = p.type;
+        r.texture = -1;
+        put(r.color, p.color);
+        put(r.color2, p.color2);
+        r.cube_size = p.cube_size;
+        if (p.type == TEXMAP) {
+            for (int k = 0; k < 8; k++) r.tex_params[k] = p.tex_params[k];
+            r.name_offset = sec[SEC_STRINGS].count;
+            r.name_length = p.tex_file.size();
+            sec[SEC_STRINGS].add_bytes(p.tex_file.data(), p.tex_file.size());
+
+            auto it = embedded.find(p.textureData.get());
+            if (it != embedded.end()) {
+                r.texture = it->second;
+            } else if (TextureHandle::Pin tex{p.textureData.get()}) {
+                TextureRecord t = zeroed<TextureRecord>();
+                t.width = tex->width;
+                t.height = tex->height;
+                t.max_value = tex->max_value;
+                t.bytes_per_channel = tex->texels8.empty() ? 2 : 1;
+                t.first_mip = sec[SEC_MIPS].count;
+                t.mip_count = tex->mips.size();
+                for (const MipLevel& m : tex->mips) {
+                    MipRecord mr = zeroed<MipRecord>();
+                    mr.offset = m.offset;
+                    mr.width = m.width;
+                    mr.height = m.height;
+                    sec[SEC_MIPS].add(mr);
+                }
+                t.texel_offset = sec[SEC_TEXELS].count;
+                if (t.bytes_per_channel == 1) {
+                    t.texel_count = tex->texels8.size();
+                    sec[SEC_TEXELS].add_bytes(tex->texels8.data(), tex->texels8.size());
+                } else {
+                    t.texel_count = tex->texels16.size();
+                    sec[SEC_TEXELS].add_bytes(tex->texels16.data(), tex->texels16.size() * sizeof(uint16_t));
+                }
+                sec[SEC_TEXELS].pad();
+                r.texture = (int32_t)sec[SEC_TEXTURES].count;
+                sec[SEC_TEXTURES].add(t);
+                embedded[p.textureData.get()] = r.texture;
+            }
+        }
+        sec[SEC_PIGMENTS].add(r);
+    }
+
+    for (const Finish& f : scene.finishes) {
+        FinishRecord r = zeroed<FinishRecord>();
+        r.ka = f.ka;
+        r.kd = f.kd;
+        r.ks = f.ks;
+        r.alpha = f.alpha;
+        r.kr = f.kr;
+        r.kt = f.kt;
+        r.ior = f.ior;
+        sec[SEC_FINISHES].add(r);
+    }
+
+    // Esferas e poliedros, dos protótipos e da cena, vão para as mesmas seções
+    auto add_geometry = [&](const Object* obj) {
+        ObjectRecord o = zeroed<ObjectRecord>();
+        o.type = obj->type();
+        if (obj->type() == OBJ_SPHERE) {
+            const Sphere* s = static_cast<const Sphere*>(obj);
+            SphereRecord r = zeroed<SphereRecord>();
+            put(r.center, s->center);
+            r.radius = s->radius;
+            r.pigment = s->pigmentIndex;
+            r.finish = s->finishIndex;
+            o.index = (int32_t)sec[SEC_SPHERES].count;
+            sec[SEC_SPHERES].add(r);
+        } else {
+            const Polyhedron* poly = static_cast<const Polyhedron*>(obj);
+            PolyhedronRecord r = zeroed<PolyhedronRecord>();
+            AABB box;
+            r.bounded = poly->bounding_box(box);
+            if (r.bounded) {
+                put(r.box_min, box.min);
+                put(r.box_max, box.max);
+            }
+            r.pigment = poly->pigmentIndex;
+            r.finish = poly->finishIndex;
+            r.first_face = sec[SEC_FACES].count;
+            r.face_count = poly->faces().size();
+            for (const Face& f : poly->faces()) {
+                FaceRecord fr = zeroed<FaceRecord>();
+                put(fr.normal, f.normal);
+                fr.d = f.d;
+                sec[SEC_FACES].add(fr);
+            }
+            o.index = (int32_t)sec[SEC_POLYHEDRA].count;
+            sec[SEC_POLYHEDRA].add(r);
+        }
+        return o;
+    };
+
+    for (const Object* proto : scene.prototypes) sec[SEC_PROTOTYPES].add(add_geometry(proto));
+
+    for (const Object* obj : scene.objects) {
+        if (obj->type() != OBJ_INSTANCE) {
+            sec[SEC_OBJECTS].add(add_geometry(obj));
+            continue;
+        }
+        const Instance* inst = static_cast<const Instance*>(obj);
+        InstanceRecord r = zeroed<InstanceRecord>();
+        memcpy(r.to_object, inst->to_object.m, sizeof(r.to_object));
+        AABB box;
+        r.bounded = inst->bounding_box(box);
+        if (r.bounded) {
+            put(r.box_min, box.min);
+            put(r.box_max, box.max);
+        }
+        r.prototype = inst->prototypeIndex;
+        r.pigment = inst->pigmentIndex;
+        r.finish = inst->finishIndex;
+        ObjectRecord o = zeroed<ObjectRecord>();
+        o.type = OBJ_INSTANCE;
+        o.index = (int32_t)sec[SEC_INSTANCES].count;
+        sec[SEC_INSTANCES].add(r);
+        sec[SEC_OBJECTS].add(o);
+    }
+
+    for (const BVHNode& n : scene.bvh.nodes) {
+        NodeRecord r = zeroed<NodeRecord>();
+        put(r.box_min, n.box.min);
+        put(r.box_max, n.box.max);
+        r.first = n.first;
+        r.count = n.count;
+        r.axis = n.axis;
+        r.spheres = n.spheres;
+        sec[SEC_NODES].add(r);
+    }
+    for (int p : scene.bvh.prims) sec[SEC_PRIMS].add((int32_t)p);
+    for (int u : scene.bvh.unbounded) sec[SEC_UNBOUNDED].add((int32_t)u);
+
+    FileHeader h = zeroed<FileHeader>();
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.endian = ENDIAN_MARK;
+    if (scene.camera) {
+        put(h.camera[0], scene.camera->origin);
+        put(h.camera[1], scene.camera->target);
+        put(h.camera[2], scene.camera->up);
+        h.camera_fov = scene.camera->fov;
+    }
+    put(h.ambient, scene.ambient_light);
+    uint64_t offset = align_up(sizeof(FileHeader));
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        h.sections[s].offset = offset;
+        h.sections[s].count = sec[s].count;
+        offset = align_up(offset + sec[s].bytes.size());
+    }
+    h.file_size = offset;
+
+    ofstream out(filename, ios::binary);
+    if (!out.is_open()) {
+        cerr << "Erro: Nao foi possivel criar " << filename << endl;
+        return false;
+    }
+    const char zeros[SECTION_ALIGN] = {};
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    uint64_t written = sizeof(h);
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        out.write(zeros, h.sections[s].offset - written);
+        out.write(sec[s].bytes.data(), sec[s].bytes.size());
+        written = h.sections[s].offset + sec[s].bytes.size();
+    }
+    out.write(zeros, h.file_size - written);
+    if (!out.flush()) {
+        cerr << "Erro: Falha ao gravar " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadCompiledScene(const string& filename, Scene& scene) {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    if (!file->open(filename)) {
+        cerr << "Erro: Nao foi possivel abrir " << filename << endl;
+        return false;
+    }
+    string version = file_version(filename); // Das texturas embutidas no cache
+
+    FileHeader h;
+    if (file->size() < sizeof(FileHeader)) return invalid(filename, "arquivo truncado");
+    memcpy(&h, file->data(), sizeof(FileHeader));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) return invalid(filename, "assinatura");
+    if (h.endian != ENDIAN_MARK) return invalid(filename, "ordem de bytes de outra arquitetura");
+    if (h.version != VERSION) return invalid(filename, "versao nao suportada; compile a cena de novo");
+    if (h.file_size != file->size()) return invalid(filename, "tamanho");
+
+    SectionView<LightRecord> lights;
+    SectionView<PigmentRecord> pigments;
+    SectionView<FinishRecord> finishes;
+    SectionView<SphereRecord> spheres;
+    SectionView<PolyhedronRecord> polys;
+    SectionView<FaceRecord> faces;
+    SectionView<ObjectRecord> objects, prototypes;
+    SectionView<InstanceRecord> instances;
+    SectionView<NodeRecord> nodes;
+    SectionView<int32_t> prims, unbounded;
+    SectionView<TextureRecord> textures;
+    SectionView<MipRecord> mips;
+    SectionView<unsigned char> texels;
+    SectionView<char> strings;
+    if (!section(*file, h, SEC_LIGHTS, lights) ||
+        !section(*file, h, SEC_PIGMENTS, pigments) ||
+        !section(*file, h, SEC_FINISHES, finishes) ||
+        !section(*file, h, SEC_SPHERES, spheres) ||
+        !section(*file, h, SEC_POLYHEDRA, polys) ||
+        !section(*file, h, SEC_FACES, faces) ||
+        !section(*file, h, SEC_OBJECTS, objects) ||
+        !section(*file, h, SEC_PROTOTYPES, prototypes) ||
+        !section(*file, h, SEC_INSTANCES, instances) ||
+        !section(*file, h, SEC_NODES, nodes) ||
+        !section(*file, h, SEC_PRIMS, prims) ||
+        !section(*file, h, SEC_UNBOUNDED, unbounded) ||
+        !section(*file, h, SEC_TEXTURES, textures) ||
+        !section(*file, h, SEC_MIPS, mips) ||
+        !section(*file, h, SEC_TEXELS, texels) ||
+        !section(*file, h, SEC_STRINGS, strings)) {
+        return invalid(filename, "secao fora do arquivo");
+    }
+
+    scene.camera = new Camera(get(h.camera[0]), get(h.camera[1]), get(h.camera[2]), h.camera_fov, DEFAULT_CAMERA_ASPECT);
+    scene.ambient_light = get(h.ambient);
+
+    scene.lights.resize(lights.count);
+    for (uint64_t i = 0; i < lights.count; i++) {
+        Light& l = scene.lights[i];
+        l.position = get(lights[i].position);
+        l.color = get(lights[i].color);
+        for (int k = 0; k < 3; k++) l.attenuation[k] = lights[i].attenuation[k];
+    }
+
+    scene.finishes.resize(finishes.count);
+    for (uint64_t i = 0; i < finishes.count; i++) {
+        const FinishRecord& r = finishes[i];
+        scene.finishes[i] = Finish{r.ka, r.kd, r.ks, r.alpha, r.kr, r.kt, r.ior};
+    }
+
+    scene.pigments.resize(pigments.count);
+    for (uint64_t i = 0; i < pigments.count; i++) {
+        const PigmentRecord& r = pigments[i];
+        Pigment& p = scene.pigments[i];
+        if (r.type != SOLID && r.type != CHECKER && r.type != TEXMAP) return invalid(filename, "tipo de pigmento");
+        p.type = (PigmentType)r.type;
+        p.color = get(r.color);
+        p.color2 = get(r.color2);
+        p.cube_size = r.cube_size;
+        for (int k = 0; k < 8; k++) p.tex_params[k] = r.tex_params[k];
+        if (p.type != TEXMAP) continue;
+
+        if (r.name_offset > strings.count || r.name_length > strings.count - r.name_offset) {
+            return invalid(filename, "nome de textura");
+        }
+        p.tex_file.assign(strings.data + r.name_offset, r.name_length);
+        if (r.texture < 0) {
+            // Não pôde ser lida na compilação: tenta o arquivo original, como a cena de texto
+            p.textureData = TextureCache::instance().acquire(p.tex_file);
+            continue;
+        }
+
+        if ((uint64_t)r.texture >= textures.count) return invalid(filename, "indice de textura");
+        const TextureRecord& t = textures[r.texture];
+        int channel = t.bytes_per_channel;
+        if (t.width <= 0 || t.height <= 0 || (channel != 1 && channel != 2) || t.max_value <= 0 ||
+            t.mip_count == 0 || t.first_mip > mips.count || t.mip_count > mips.count - t.first_mip ||
+            t.texel_offset % 8 != 0 || t.texel_offset > texels.count ||
+            t.texel_count > (texels.count - t.texel_offset) / channel) {
+            return invalid(filename, "textura");
+        }
+        vector<MipLevel> levels(t.mip_count);
+        for (uint64_t m = 0; m < t.mip_count; m++) {
+            const MipRecord& mr = mips[t.first_mip + m];
+            if (mr.width <= 0 || mr.height <= 0 ||
+                mr.offset > t.texel_count || 3 * (uint64_t)mr.width * mr.height > t.texel_count - mr.offset) {
+                return invalid(filename, "nivel de mip");
+            }
+            levels[m] = MipLevel{mr.width, mr.height, (size_t)mr.offset};
+        }
+        if (levels[0].width != t.width || levels[0].height != t.height || levels[0].offset != 0) {
+            return invalid(filename, "nivel de mip");
+        }
+
+        // Pigmentos com a mesma textura compartilham o nome, e portanto o handle;
+        // a versão do arquivo compilado separa as texturas de uma cena recompilada
+        string name = filename + "#" + to_string(r.texture);
+        string label = p.tex_file;
+        // A fonte guarda o mapeamento vivo enquanto o handle existir
+        p.textureData = TextureCache::instance().acquire(name, version, [file, texels, t, levels, label]() {
+            return embedded_texture(texels.data, t, levels, label);
+        });
+    }
+
+    // Objetos na ordem original; os poliedros recebem os planos e a caixa prontos
+    scene.objects.reserve(objects.count);
+    scene.prototypes.reserve(prototypes.count);
+    scene.sphere_pool.reserve(spheres.count);
+    scene.polyhedron_pool.reserve(polys.count);
+    scene.instance_pool.reserve(instances.count);
+    scene.face_pool.faces.reserve(faces.count);
+    // As faixas de faces são conferidas antes da reserva: com um face_count
+    // corrompido a soma estouraria ou pediria gigabytes. Faixas que se
+    // sobrepõem (o compilador nunca gera) ficam sem reserva.
+    uint64_t blocks = 0, total_faces = 0;
+    for (uint64_t i = 0; i < polys.count; i++) {
+        const PolyhedronRecord& r = polys[i];
+        if (r.first_face > faces.count || r.face_count > faces.count - r.first_face) {
+            return invalid(filename, "faces do poliedro");
+        }
+        total_faces += r.face_count;
+        blocks += (r.face_count + PlaneBlock::WIDTH - 1) / PlaneBlock::WIDTH;
+        if (total_faces > faces.count) {
+            blocks = 0;
+            break;
+        }
+    }
+    scene.face_pool.blocks.reserve(blocks);
+
+    // Esfera ou poliedro (da cena ou protótipo), adicionado ao fim de objects;
+    // devolve o motivo se o registro é inválido
+    auto add_geometry = [&](const ObjectRecord& o) -> const char* {
+        int32_t pig, fin;
+        if (o.type == OBJ_SPHERE) {
+            if (o.index < 0 || (uint64_t)o.index >= spheres.count) return "indice de esfera";
+            const SphereRecord& s = spheres[o.index];
+            pig = s.pigment;
+            fin = s.finish;
+            scene.add_sphere(get(s.center), s.radius, pig, fin);
+        } else if (o.type == OBJ_POLYHEDRON) {
+            if (o.index < 0 || (uint64_t)o.index >= polys.count) return "indice de poliedro";
+            const PolyhedronRecord& r = polys[o.index];
+            if (r.first_face > faces.count || r.face_count > faces.count - r.first_face) {
+                return "faces do poliedro";
+            }
+            pig = r.pigment;
+            fin = r.finish;
+            Polyhedron* poly = scene.add_polyhedron(pig, fin);
+            for (uint64_t k = 0; k < r.face_count; k++) {
+                const FaceRecord& f = faces[r.first_face + k];
+                poly->add_face(Face(get(f.normal), f.d));
+            }
+            AABB box(get(r.box_min), get(r.box_max));
+            poly->compile(r.bounded ? &box : nullptr);
+        } else {
+            return "tipo de objeto";
+        }
+        if (pig < 0 || (uint64_t)pig >= pigments.count || fin < 0 || (uint64_t)fin >= finishes.count) {
+            return "indice de pigmento ou acabamento";
+        }
+        return nullptr;
+    };
+
+    for (uint64_t i = 0; i < prototypes.count; i++) {
+        if (const char* error = add_geometry(prototypes[i])) return invalid(filename, error);
+        scene.make_prototype();
+    }
+    for (uint64_t i = 0; i < objects.count; i++) {
+        const ObjectRecord& o = objects[i];
+        if (o.type != OBJ_INSTANCE) {
+            if (const char* error = add_geometry(o)) return invalid(filename, error);
+            continue;
+        }
+        if (o.index < 0 || (uint64_t)o.index >= instances.count) return invalid(filename, "indice de instancia");
+        const InstanceRecord& r = instances[o.index];
+        if (r.prototype < 0 || (size_t)r.prototype >= scene.prototypes.size()) {
+            return invalid(filename, "prototipo da instancia");
+        }
+        if (r.pigment < -1 || r.pigment >= (int64_t)pigments.count || r.finish < -1 ||
+            r.finish >= (int64_t)finishes.count) {
+            return invalid(filename, "indice de pigmento ou acabamento");
+        }
+        Affine to_object;
+        memcpy(to_object.m, r.to_object, sizeof(to_object.m));
+        Instance* inst = scene.add_instance(r.prototype, to_object, r.pigment, r.finish);
+        AABB box(get(r.box_min), get(r.box_max));
+        inst->compile(r.bounded ? &box : nullptr);
+    }
+
+    scene.bvh.nodes.resize(nodes.count);
+    for (uint64_t i = 0; i < nodes.count; i++) {
+        const NodeRecord& r = nodes[i];
+        BVHNode& n = scene.bvh.nodes[i];
+        n.box = AABB(get(r.box_min), get(r.box_max));
+        n.first = r.first;
+        n.count = r.count;
+        n.axis = r.axis;
+        n.spheres = r.spheres;
+    }
+    scene.bvh.prims.assign(prims.data, prims.data + prims.count);
+    scene.bvh.unbounded.assign(unbounded.data, unbounded.data + unbounded.count);
+    if (!scene.bvh.adopt(scene.objects)) return invalid(filename, "BVH");
+
+    return true;
+}
@@ -0,0 +1,356 @@
+#include "sphere_batch.h"
+#include "simd_ops.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Os kernels são templates no tipo escalar T e instanciados com Real: os
+// limites chegam em double e são convertidos uma vez, como em Sphere::hit.
+
+// --- Caminho escalar (fallback) ---
+
+// Raiz válida mais próxima de uma esfera, com a mesma sequência de operações de Sphere::hit
+template<typename T>
+inline T scalar_root(const SphereSoAT<T>& s, int i, const RayT<T>& r, T a, T t_min, T t_max) {
+    T ocx = r.origin.x - s.cx[i];
+    T ocy = r.origin.y - s.cy[i];
+    T ocz = r.origin.z - s.cz[i];
+
+    T b = 2 * (ocx * r.direction.x + ocy * r.direction.y + ocz * r.direction.z);
+    T c = (ocx * ocx + ocy * ocy + ocz * ocz) - s.rr[i];
+    T discriminant = b*b - 4*a*c;
+
+    if (discriminant > 0) {
+        T sqrt_delta = std::sqrt(discriminant);
+        T temp = (-b - sqrt_delta) / (2*a);
+        if (temp < t_max && temp > t_min) return temp;
+        temp = (-b + sqrt_delta) / (2*a);
+        if (temp < t_max && temp > t_min) return temp;
+    }
+    return std::numeric_limits<T>::infinity();
+}
+
+template<typename T>
+void hit_scalar(const SphereSoAT<T>& s, int first, int count, const RayT<T>& r,
+                double t_min, double t_max, T* t_out) {
+    T a = dot(r.direction, r.direction);
+    for (int k = 0; k < count; k++) t_out[k] = scalar_root(s, first + k, r, a, T(t_min), T(t_max));
+}
+
+template<typename T>
+bool occluded_scalar(const SphereSoAT<T>& s, int first, int count, const RayT<T>& r,
+                     double t_min, double t_max) {
+    T a = dot(r.direction, r.direction);
+    for (int k = 0; k < count; k++) {
+        if (scalar_root(s, first + k, r, a, T(t_min), T(t_max)) != std::numeric_limits<T>::infinity()) return true;
+    }
+    return false;
+}
+
+// Pacotes: uma esfera contra cada lane, que tem o seu próprio limite
+template<typename T>
+LaneMask lanes_scalar(const SphereSoAT<T>& s, int i, const LaneRaysT<T>& p, LaneMask lanes,
+                      double t_min, const T* limit, T* t_out) {
+    LaneMask out = 0;
+    for (LaneMask m = lanes; m; m &= m - 1) {
+        int l = __builtin_ctzll(m);
+        RayT<T> r = p.ray(l);
+        T t = scalar_root(s, i, r, dot(r.direction, r.direction), T(t_min), limit[l]);
+        if (t != std::numeric_limits<T>::infinity()) {
+            if (t_out) t_out[l] = t;
+            out |= LaneMask(1) << l;
+        }
+    }
+    return out;
+}
+
+#ifdef RT_X86_SIMD
+
+// --- AVX2: 4 esferas por instrução em double, 8 em float ---
+// Sem FMA de propósito: cada multiplicação e soma é arredondada como no escalar.
+
+template<typename T>
+struct Avx2Roots {
+    typename Avx2Ops<T>::V t1, t2, ok1, ok2;
+};
+
+template<typename T>
+__attribute__((target("avx2")))
+inline Avx2Roots<T> avx2_roots(const SphereSoAT<T>& s, int i, const RayT<T>& r, T a, T t_min, T t_max) {
+    typedef Avx2Ops<T> O;
+    const typename O::V dx = O::set1(r.direction.x);
+    const typename O::V dy = O::set1(r.direction.y);
+    const typename O::V dz = O::set1(r.direction.z);
+
+    typename O::V ocx = O::sub(O::set1(r.origin.x), O::loadu(&s.cx[i]));
+    typename O::V ocy = O::sub(O::set1(r.origin.y), O::loadu(&s.cy[i]));
+    typename O::V ocz = O::sub(O::set1(r.origin.z), O::loadu(&s.cz[i]));
+
+    typename O::V oc_d = O::add(O::add(O::mul(ocx, dx), O::mul(ocy, dy)), O::mul(ocz, dz));
+    typename O::V oc_oc = O::add(O::add(O::mul(ocx, ocx), O::mul(ocy, ocy)), O::mul(ocz, ocz));
+
+    typename O::V b = O::mul(O::set1(T(2)), oc_d);
+    typename O::V c = O::sub(oc_oc, O::loadu(&s.rr[i]));
+    typename O::V disc = O::sub(O::mul(b, b), O::mul(O::set1(4 * a), c));
+
+    typename O::V valid = O::gt(disc, O::zero());
+    typename O::V sqrt_delta = O::sqrt(disc);
+    typename O::V neg_b = O::bit_xor(b, O::set1(T(-0.0)));
+    typename O::V two_a = O::set1(2 * a);
+    typename O::V vmin = O::set1(t_min);
+    typename O::V vmax = O::set1(t_max);
+
+    Avx2Roots<T> out;
+    out.t1 = O::div(O::sub(neg_b, sqrt_delta), two_a);
+    out.t2 = O::div(O::add(neg_b, sqrt_delta), two_a);
+    out.ok1 = O::bit_and(valid, O::bit_and(O::lt(out.t1, vmax), O::gt(out.t1, vmin)));
+    out.ok2 = O::bit_and(valid, O::bit_and(O::lt(out.t2, vmax), O::gt(out.t2, vmin)));
+    return out;
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+void hit_avx2(const SphereSoAT<T>& s, int first, int count, const RayT<T>& r,
+              double t_min, double t_max, T* t_out) {
+    typedef Avx2Ops<T> O;
+    T a = dot(r.direction, r.direction);
+    for (int k = 0; k < count; k += O::LANES) {
+        Avx2Roots<T> roots = avx2_roots(s, first + k, r, a, T(t_min), T(t_max));
+        typename O::V t = O::blend(O::set1(std::numeric_limits<T>::infinity()), roots.t2, roots.ok2);
+        t = O::blend(t, roots.t1, roots.ok1);
+        O::storeu(t_out + k, t);
+    }
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+bool occluded_avx2(const SphereSoAT<T>& s, int first, int count, const RayT<T>& r,
+                   double t_min, double t_max) {
+    typedef Avx2Ops<T> O;
+    T a = dot(r.direction, r.direction);
+    for (int k = 0; k < count; k += O::LANES) {
+        Avx2Roots<T> roots = avx2_roots(s, first + k, r, a, T(t_min), T(t_max));
+        int mask = O::movemask(O::bit_or(roots.ok1, roots.ok2));
+        int lanes = count - k < O::LANES ? count - k : O::LANES;
+        if (mask & ((1 << lanes) - 1)) return true;
+    }
+    return false;
+}
+
+// Pacotes com AVX2: a esfera é replicada e as lanes (4 em double, 8 em
+// float) ocupam o vetor, cada uma com a sua direção, o seu a e o seu limite.
+// t_out nulo: só a máscara (sombras).
+template<typename T>
+__attribute__((target("avx2")))
+LaneMask lanes_avx2(const SphereSoAT<T>& s, int i, const LaneRaysT<T>& p, LaneMask lanes,
+                    double t_min, const T* limit, T* t_out) {
+    typedef Avx2Ops<T> O;
+    typedef typename O::V V;
+    const LaneMask group = (LaneMask(1) << O::LANES) - 1;
+    const V cx = O::set1(s.cx[i]);
+    const V cy = O::set1(s.cy[i]);
+    const V cz = O::set1(s.cz[i]);
+    const V rr = O::set1(s.rr[i]);
+    const V vmin = O::set1(T(t_min));
+
+    LaneMask out = 0;
+    for (int k = 0; k < p.n; k += O::LANES) {
+        LaneMask want = (lanes >> k) & group;
+        if (!want) continue;
+        V dx = O::loadu(p.dx + k);
+        V dy = O::loadu(p.dy + k);
+        V dz = O::loadu(p.dz + k);
+        V ocx = O::sub(O::loadu(p.ox + k), cx);
+        V ocy = O::sub(O::loadu(p.oy + k), cy);
+        V ocz = O::sub(O::loadu(p.oz + k), cz);
+
+        V a = O::add(O::add(O::mul(dx, dx), O::mul(dy, dy)), O::mul(dz, dz));
+        V oc_d = O::add(O::add(O::mul(ocx, dx), O::mul(ocy, dy)), O::mul(ocz, dz));
+        V oc_oc = O::add(O::add(O::mul(ocx, ocx), O::mul(ocy, ocy)), O::mul(ocz, ocz));
+
+        V b = O::mul(O::set1(T(2)), oc_d);
+        V c = O::sub(oc_oc, rr);
+        V disc = O::sub(O::mul(b, b), O::mul(O::mul(O::set1(T(4)), a), c));
+
+        V valid = O::gt(disc, O::zero());
+        V sqrt_delta = O::sqrt(disc);
+        V neg_b = O::bit_xor(b, O::set1(T(-0.0)));
+        V two_a = O::mul(O::set1(T(2)), a);
+        V vmax = O::loadu(limit + k);
+
+        V t1 = O::div(O::sub(neg_b, sqrt_delta), two_a);
+        V t2 = O::div(O::add(neg_b, sqrt_delta), two_a);
+        V ok1 = O::bit_and(valid, O::bit_and(O::lt(t1, vmax), O::gt(t1, vmin)));
+        V ok2 = O::bit_and(valid, O::bit_and(O::lt(t2, vmax), O::gt(t2, vmin)));
+        if (t_out) O::storeu(t_out + k, O::blend(t2, t1, ok1));
+        out |= (LaneMask(O::movemask(O::bit_or(ok1, ok2))) & want) << k;
+    }
+    return out;
+}
+
+// --- AVX-512: 8 esferas por instrução em double, 16 em float ---
+
+template<typename T>
+struct Avx512Roots {
+    typename Avx512Ops<T>::V t1, t2;
+    typename Avx512Ops<T>::M ok1, ok2;
+};
+
+template<typename T>
+__attribute__((target("avx512f")))
+inline Avx512Roots<T> avx512_roots(const SphereSoAT<T>& s, int i, const RayT<T>& r, T a, T t_min, T t_max) {
+    typedef Avx512Ops<T> O;
+    const typename O::V dx = O::set1(r.direction.x);
+    const typename O::V dy = O::set1(r.direction.y);
+    const typename O::V dz = O::set1(r.direction.z);
+
+    typename O::V ocx = O::sub(O::set1(r.origin.x), O::loadu(&s.cx[i]));
+    typename O::V ocy = O::sub(O::set1(r.origin.y), O::loadu(&s.cy[i]));
+    typename O::V ocz = O::sub(O::set1(r.origin.z), O::loadu(&s.cz[i]));
+
+    typename O::V oc_d = O::add(O::add(O::mul(ocx, dx), O::mul(ocy, dy)), O::mul(ocz, dz));
+    typename O::V oc_oc = O::add(O::add(O::mul(ocx, ocx), O::mul(ocy, ocy)), O::mul(ocz, ocz));
+
+    typename O::V b = O::mul(O::set1(T(2)), oc_d);
+    typename O::V c = O::sub(oc_oc, O::loadu(&s.rr[i]));
+    typename O::V disc = O::sub(O::mul(b, b), O::mul(O::set1(4 * a), c));
+
+    typename O::M valid = O::gt(disc, O::zero());
+    typename O::V sqrt_delta = O::sqrt(valid, disc);
+    typename O::V neg_b = O::neg(b);
+    typename O::V two_a = O::set1(2 * a);
+    typename O::V vmin = O::set1(t_min);
+    typename O::V vmax = O::set1(t_max);
+
+    Avx512Roots<T> out;
+    out.t1 = O::div(O::sub(neg_b, sqrt_delta), two_a);
+    out.t2 = O::div(O::add(neg_b, sqrt_delta), two_a);
+    out.ok1 = valid & O::lt(out.t1, vmax) & O::gt(out.t1, vmin);
+    out.ok2 = valid & O::lt(out.t2, vmax) & O::gt(out.t2, vmin);
+    return out;
+}
+
+template<typename T>
+__attribute__((target("avx512f")))
+void hit_avx512(const SphereSoAT<T>& s, int first, int count, const RayT<T>& r,
+                double t_min, double t_max, T* t_out) {
+    typedef Avx512Ops<T> O;
+    T a = dot(r.direction, r.direction);
+    for (int k = 0; k < count; k += O::LANES) {
+        Avx512Roots<T> roots = avx512_roots(s, first + k, r, a, T(t_min), T(t_max));
+        typename O::V t = O::blend(roots.ok2, O::set1(std::numeric_limits<T>::infinity()), roots.t2);
+        t = O::blend(roots.ok1, t, roots.t1);
+        O::storeu(t_out + k, t);
+    }
+}
+
+template<typename T>
+__attribute__((target("avx512f")))
+bool occluded_avx512(const SphereSoAT<T>& s, int first, int count, const RayT<T>& r,
+                     double t_min, double t_max) {
+    typedef Avx512Ops<T> O;
+    T a = dot(r.direction, r.direction);
+    for (int k = 0; k < count; k += O::LANES) {
+        Avx512Roots<T> roots = avx512_roots(s, first + k, r, a, T(t_min), T(t_max));
+        int lanes = count - k < O::LANES ? count - k : O::LANES;
+        if ((roots.ok1 | roots.ok2) & ((1 << lanes) - 1)) return true;
+    }
+    return false;
+}
+
+#endif
+
+SimdLevel detect_simd_level() {
+#ifdef RT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+typedef void (*HitKernel)(const SphereSoA&, int, int, const Ray&, double, double, Real*);
+typedef bool (*OccludedKernel)(const SphereSoA&, int, int, const Ray&, double, double);
+
+struct KernelTable {
+    SimdLevel level;
+    int width;
+    HitKernel hit;
+    OccludedKernel occluded;
+};
+
+KernelTable make_table(SimdLevel level) {
+    switch (level) {
+#ifdef RT_X86_SIMD
+    case SIMD_AVX512: return {SIMD_AVX512, Avx512Ops<Real>::LANES, hit_avx512<Real>, occluded_avx512<Real>};
+    case SIMD_AVX2:   return {SIMD_AVX2, Avx2Ops<Real>::LANES, hit_avx2<Real>, occluded_avx2<Real>};
+#endif
+    default:          return {SIMD_SCALAR, 1, hit_scalar<Real>, occluded_scalar<Real>};
+    }
+}
+
+KernelTable& kernels() {
+    static KernelTable table = make_table(detect_simd_level());
+    return table;
+}
+
+}
+
+void set_simd_level(SimdLevel level) {
+    SimdLevel supported = detect_simd_level();
+    if (level == SIMD_AUTO || level > supported) level = supported;
+    kernels() = make_table(level);
+}
+
+SimdLevel simd_level() {
+    return kernels().level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+    case SIMD_AVX512: return "avx512";
+    case SIMD_AVX2:   return "avx2";
+    case SIMD_SCALAR: return "scalar";
+    default:          return "auto";
+    }
+}
+
+bool parse_simd_level(const std::string& name, SimdLevel& level) {
+    if (name == "auto") level = SIMD_AUTO;
+    else if (name == "scalar") level = SIMD_SCALAR;
+    else if (name == "avx2") level = SIMD_AVX2;
+    else if (name == "avx512") level = SIMD_AVX512;
+    else return false;
+    return true;
+}
+
+int sphere_simd_width() {
+    return kernels().width;
+}
+
+void sphere_batch_hit(const SphereSoA& s, int first, int count, const Ray& r,
+                      double t_min, double t_max, Real* t_out) {
+    kernels().hit(s, first, count, r, t_min, t_max, t_out);
+}
+
+bool sphere_batch_occluded(const SphereSoA& s, int first, int count, const Ray& r,
+                           double t_min, double t_max) {
+    return kernels().occluded(s, first, count, r, t_min, t_max);
+}
+
+LaneMask sphere_lanes_hit(const SphereSoA& s, int i, const LaneRays& p, LaneMask lanes,
+                          double t_min, const Real* limit, Real* t_out) {
+#ifdef RT_X86_SIMD
+    if (simd_level() >= SIMD_AVX2) return lanes_avx2(s, i, p, lanes, t_min, limit, t_out);
+#endif
+    return lanes_scalar(s, i, p, lanes, t_min, limit, t_out);
+}
+
+LaneMask sphere_lanes_occluded(const SphereSoA& s, int i, const LaneRays& p, LaneMask lanes,
+                               double t_min, const Real* limit) {
+#ifdef RT_X86_SIMD
+    if (simd_level() >= SIMD_AVX2) return lanes_avx2(s, i, p, lanes, t_min, limit, (Real*)nullptr);
+#endif
+    return lanes_scalar(s, i, p, lanes, t_min, limit, (Real*)nullptr);
+}
@@ -0,0 +1,278 @@
+#include "texture.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+// Leitura sequencial sobre os bytes mapeados do arquivo
+struct Cursor {
+    const unsigned char* p;
+    const unsigned char* end;
+
+    // Ignora espaços e comentários (#) do PPM
+    void skip_space() {
+        while (p < end) {
+            if (*p == '#') {
+                while (p < end && *p != '\n') p++;
+            } else if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\v' || *p == '\f') {
+                p++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool read_int(int& value) {
+        skip_space();
+        if (p >= end || *p < '0' || *p > '9') return false;
+        long v = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            v = v * 10 + (*p - '0');
+            if (v > 1000000000L) return false;
+            p++;
+        }
+        value = (int)v;
+        return true;
+    }
+};
+
+// Cada texel do nível de destino é a média (arredondada) de um bloco 2x2 do
+// nível de origem. Em dimensões ímpares a última linha/coluna é repetida.
+template<typename T>
+void downsample(std::vector<T>& texels, const MipLevel& src, const MipLevel& dst) {
+    for (int j = 0; j < dst.height; j++) {
+        int y0 = std::min(2 * j, src.height - 1);
+        int y1 = std::min(2 * j + 1, src.height - 1);
+        for (int i = 0; i < dst.width; i++) {
+            int x0 = std::min(2 * i, src.width - 1);
+            int x1 = std::min(2 * i + 1, src.width - 1);
+            size_t a = src.offset + 3 * ((size_t)y0 * src.width + x0);
+            size_t b = src.offset + 3 * ((size_t)y0 * src.width + x1);
+            size_t c = src.offset + 3 * ((size_t)y1 * src.width + x0);
+            size_t d = src.offset + 3 * ((size_t)y1 * src.width + x1);
+            size_t out = dst.offset + 3 * ((size_t)j * dst.width + i);
+            for (int ch = 0; ch < 3; ch++) {
+                uint32_t sum = (uint32_t)texels[a + ch] + texels[b + ch] + texels[c + ch] + texels[d + ch];
+                texels[out + ch] = (T)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Índice de texel com repetição (tiling), também para valores negativos
+inline int wrap(int i, int n) {
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+// Número máximo de amostras do filtro anisotrópico
+const int MAX_ANISO = 8;
+
+}
+
+const char* texture_filter_name(TextureFilter filter) {
+    switch (filter) {
+        case TEX_NEAREST: return "nearest";
+        case TEX_TRILINEAR: return "trilinear";
+        case TEX_ANISO: return "aniso";
+    }
+    return "?";
+}
+
+bool parse_texture_filter(const string& name, TextureFilter& filter) {
+    if (name == "nearest") filter = TEX_NEAREST;
+    else if (name == "trilinear") filter = TEX_TRILINEAR;
+    else if (name == "aniso") filter = TEX_ANISO;
+    else return false;
+    return true;
+}
+
+void Texture::build_mipmaps() {
+    mips.clear();
+    mips.push_back(MipLevel{width, height, 0});
+
+    size_t total = 3 * (size_t)width * height;
+    while (mips.back().width > 1 || mips.back().height > 1) {
+        MipLevel m;
+        m.width = std::max(1, mips.back().width / 2);
+        m.height = std::max(1, mips.back().height / 2);
+        m.offset = total;
+        total += 3 * (size_t)m.width * m.height;
+        mips.push_back(m);
+    }
+
+    if (!texels8.empty()) texels8.resize(total);
+    else texels16.resize(total);
+    for (size_t l = 1; l < mips.size(); l++) {
+        if (!texels8.empty()) downsample(texels8, mips[l - 1], mips[l]);
+        else downsample(texels16, mips[l - 1], mips[l]);
+    }
+}
+
+Vec3 Texture::bilinear(int level, double u, double v) const {
+    const MipLevel& m = mips[level];
+    // Centros dos texels ficam em (i + 0.5) / largura. As coordenadas ficam
+    // em double até sair a parte inteira (repetição); os pesos, em Real.
+    double x = (u - floor(u)) * m.width - 0.5;
+    double y = (v - floor(v)) * m.height - 0.5;
+    double fx0 = floor(x);
+    double fy0 = floor(y);
+    Real fx = Real(x - fx0);
+    Real fy = Real(y - fy0);
+    int i0 = wrap((int)fx0, m.width), i1 = wrap((int)fx0 + 1, m.width);
+    int j0 = wrap((int)fy0, m.height), j1 = wrap((int)fy0 + 1, m.height);
+
+    Vec3 top = texel(level, i0, j0) * (1 - fx) + texel(level, i1, j0) * fx;
+    Vec3 bottom = texel(level, i0, j1) * (1 - fx) + texel(level, i1, j1) * fx;
+    return top * (1 - fy) + bottom * fy;
+}
+
+Vec3 Texture::trilinear(double u, double v, double lod) const {
+    int last = (int)mips.size() - 1;
+    if (!(lod > 0)) return bilinear(0, u, v); // Também cobre NaN
+    if (lod >= last) return bilinear(last, u, v);
+    int l0 = (int)lod;
+    Real f = Real(lod - l0);
+    if (f == 0) return bilinear(l0, u, v);
+    return bilinear(l0, u, v) * (1 - f) + bilinear(l0 + 1, u, v) * f;
+}
+
+Vec3 Texture::sample(double u, double v, double dudx, double dvdx, double dudy, double dvdy,
+                     TextureFilter filter) const {
+    if (filter == TEX_NEAREST || empty() || mips.empty()) return sample(u, v);
+
+    // Comprimento da pegada do pixel em texels do nível 0, nas direções x e y da tela
+    double len_x = std::hypot(dudx * width, dvdx * height);
+    double len_y = std::hypot(dudy * width, dvdy * height);
+    if (!std::isfinite(len_x)) len_x = 0;
+    if (!std::isfinite(len_y)) len_y = 0;
+
+    if (filter == TEX_TRILINEAR) {
+        double rho = std::max(len_x, len_y);
+        return trilinear(u, v, rho > 1 ? std::log2(rho) : 0.0);
+    }
+
+    // Anisotrópico: o eixo menor da pegada escolhe o nível, e o eixo maior é
+    // coberto com até MAX_ANISO amostras trilineares
+    double major = std::max(len_x, len_y);
+    double minor = std::min(len_x, len_y);
+    int n = 1;
+    if (major > 1) {
+        n = (int)std::ceil(major / std::max(minor, 1e-12));
+        n = std::max(1, std::min(n, MAX_ANISO));
+    }
+    double lod = major / n > 1 ? std::log2(major / n) : 0.0;
+    if (n == 1) return trilinear(u, v, lod);
+
+    double du = len_x >= len_y ? dudx : dudy;
+    double dv = len_x >= len_y ? dvdx : dvdy;
+    Vec3 sum(0, 0, 0);
+    for (int k = 0; k < n; k++) {
+        double s = (k + 0.5) / n - 0.5;
+        sum = sum + trilinear(u + s * du, v + s * dv, lod);
+    }
+    return sum / n;
+}
+
+// --- Funções Auxiliares para ler PPM ---
+Texture* readPPM(const string& filename, bool* binary_out) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Erro: Nao foi possivel abrir textura " << filename << endl;
+        return nullptr;
+    }
+
+    Cursor c{file.data(), file.data() + file.size()};
+    c.skip_space();
+    bool binary;
+    if (c.end - c.p >= 2 && c.p[0] == 'P' && c.p[1] == '3') binary = false;
+    else if (c.end - c.p >= 2 && c.p[0] == 'P' && c.p[1] == '6') binary = true;
+    else {
+        cerr << "Erro: Apenas PPM P3 (ASCII) ou P6 (binario) sao suportados. Arquivo: " << filename << endl;
+        return nullptr;
+    }
+    c.p += 2;
+
+    int width, height, max_val;
+    if (!c.read_int(width) || !c.read_int(height) || !c.read_int(max_val) ||
+        width <= 0 || height <= 0 || max_val <= 0 || max_val > 65535) {
+        cerr << "Erro: Cabecalho PPM invalido. Arquivo: " << filename << endl;
+        return nullptr;
+    }
+
+    Texture* tex = new Texture();
+    tex->width = width;
+    tex->height = height;
+    tex->max_value = max_val;
+
+    size_t count = (size_t)width * height * 3;
+    bool wide = max_val > 255;
+    bool ok = true;
+
+    if (binary) {
+        // Exatamente um caractere de espaço separa o cabeçalho dos dados
+        c.p++;
+        if (c.p > c.end || (size_t)(c.end - c.p) / (wide ? 2 : 1) < count) {
+            ok = false;
+        } else if (!wide) {
+            tex->texels8.assign(c.p, c.p + count);
+        } else {
+            // P6 de 16 bits: big-endian
+            tex->texels16.resize(count);
+            for (size_t k = 0; k < count; k++) {
+                tex->texels16[k] = (uint16_t)((c.p[2 * k] << 8) | c.p[2 * k + 1]);
+            }
+        }
+    } else if ((size_t)(c.end - c.p) / 2 + 1 < count) {
+        // Cada valor ocupa ao menos um dígito e um separador: o arquivo não
+        // tem como conter a imagem, então não vale alocar os texels
+        ok = false;
+    } else {
+        if (wide) tex->texels16.resize(count);
+        else tex->texels8.resize(count);
+        for (size_t k = 0; k < count && ok; k++) {
+            int v;
+            ok = c.read_int(v) && v <= max_val;
+            if (!ok) break;
+            if (wide) tex->texels16[k] = (uint16_t)v;
+            else tex->texels8[k] = (uint8_t)v;
+        }
+    }
+
+    if (!ok) {
+        cerr << "Erro: Textura truncada ou com valores invalidos. Arquivo: " << filename << endl;
+        delete tex;
+        return nullptr;
+    }
+    if (binary_out) *binary_out = binary;
+    return tex;
+}
+
+Texture* loadPPM(const string& filename) {
+    auto start = chrono::steady_clock::now();
+
+    bool binary = false;
+    Texture* tex = readPPM(filename, &binary);
+    if (!tex) return nullptr;
+    int width = tex->width, height = tex->height;
+    bool wide = tex->texels8.empty();
+
+    tex->build_mipmaps();
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    size_t as_vec3 = (size_t)width * height * sizeof(Vec3);
+    // Montada antes de imprimir: a carga pode acontecer em uma thread de renderização
+    ostringstream msg;
+    msg << "Textura carregada: " << filename << " (" << width << "x" << height
+        << ", " << (binary ? "P6" : "P3") << ", " << (wide ? 16 : 8) << " bits/canal, "
+        << tex->mips.size() << " niveis de mip, "
+        << tex->memory_bytes() / 1024 << " KB em memoria [" << as_vec3 / 1024
+        << " KB como Vec3], " << ms << " ms)\n";
+    cout << msg.str() << flush;
+    return tex;
+}
@@ -0,0 +1,237 @@
+#include "texture_cache.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace {
+
+// Vagas de fixação de todas as threads que já amostraram uma textura. Nunca é
+// destruído: threads podem terminar depois dos objetos estáticos.
+struct SlotRegistry {
+    std::mutex mtx;
+    std::vector<std::atomic<const Texture*>*> slots;
+
+    static SlotRegistry& instance() {
+        static SlotRegistry* registry = new SlotRegistry();
+        return *registry;
+    }
+};
+
+// Vaga da thread (um ponteiro de risco), registrada enquanto ela existir
+struct ThreadSlot {
+    std::atomic<const Texture*> texture;
+
+    ThreadSlot() : texture(nullptr) {
+        SlotRegistry& r = SlotRegistry::instance();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.slots.push_back(&texture);
+    }
+
+    ~ThreadSlot() {
+        SlotRegistry& r = SlotRegistry::instance();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.slots.erase(std::remove(r.slots.begin(), r.slots.end(), &texture), r.slots.end());
+    }
+};
+
+thread_local ThreadSlot this_thread_slot;
+
+}
+
+// Fixação com a ordem sequencial: ou o descarte vê a vaga preenchida, ou esta
+// thread vê ready nulo e lê a textura de novo (ponteiros de risco)
+TextureHandle::Pin::Pin(TextureHandle* handle) : slot(nullptr), tex(nullptr) {
+    if (!handle) return;
+    slot = &this_thread_slot.texture;
+    const Texture* t = handle->ready.load(std::memory_order_acquire);
+    while (t) {
+        slot->store(t, std::memory_order_seq_cst);
+        const Texture* again = handle->ready.load(std::memory_order_seq_cst);
+        if (again == t) {
+            tex = t;
+            return;
+        }
+        t = again; // Descartada entre as duas leituras
+    }
+    tex = handle->load(*slot);
+}
+
+TextureHandle::Pin::~Pin() {
+    if (slot) slot->store(nullptr, std::memory_order_release);
+}
+
+const Texture* TextureHandle::load(std::atomic<const Texture*>& pin) {
+    const Texture* t;
+    size_t texture_bytes;
+    {
+        std::lock_guard<std::mutex> lock(load_mtx);
+        // Fixada ainda com o lock: o descarte também o toma
+        if (loaded) {
+            t = data.get();
+            pin.store(t, std::memory_order_seq_cst);
+            return t;
+        }
+        loaded = true;
+        data.reset(source ? source() : loadPPM(file));
+        if (!data) return nullptr; // O erro já foi informado; não tenta de novo
+        t = data.get();
+        pin.store(t, std::memory_order_seq_cst);
+        ready.store(t, std::memory_order_release);
+        texture_bytes = data->memory_bytes();
+    }
+    // Fora do lock da textura: o cache pode precisar liberar outras
+    TextureCache::instance().loaded(this, texture_bytes);
+    return t;
+}
+
+std::string file_version(const std::string& path) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return "";
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec) return "";
+    return std::to_string(mtime.time_since_epoch().count()) + ":" + std::to_string(size);
+}
+
+TextureCache& TextureCache::instance() {
+    static TextureCache cache;
+    return cache;
+}
+
+std::shared_ptr<TextureHandle> TextureCache::acquire(const std::string& path) {
+    return acquire(path, file_version(path), TextureHandle::Source());
+}
+
+std::shared_ptr<TextureHandle> TextureCache::acquire(const std::string& name, const std::string& version,
+                                                     TextureHandle::Source source) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto key = std::make_pair(name, version);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        hits++;
+        return it->second;
+    }
+    misses++;
+
+    // Outras versões do mesmo nome que nenhuma cena usa não serão pedidas de novo
+    it = entries.lower_bound(std::make_pair(name, std::string()));
+    while (it != entries.end() && it->first.first == name) {
+        if (it->second.use_count() == 1) erase_locked(it++);
+        else ++it;
+    }
+
+    std::shared_ptr<TextureHandle> handle = std::make_shared<TextureHandle>(name, version, source);
+    entries[key] = handle;
+    return handle;
+}
+
+void TextureCache::set_budget(size_t new_budget) {
+    std::lock_guard<std::mutex> lock(mtx);
+    budget_bytes = new_budget;
+    trim_locked();
+}
+
+size_t TextureCache::budget() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return budget_bytes;
+}
+
+void TextureCache::trim() {
+    std::lock_guard<std::mutex> lock(mtx);
+    trim_locked();
+}
+
+void TextureCache::purge() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.use_count() != 1) ++it;
+        else erase_locked(it++);
+    }
+    reclaim_locked();
+}
+
+void TextureCache::loaded(TextureHandle* handle, size_t texture_bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    loads++;
+    bytes += texture_bytes;
+    handle->cached_bytes = texture_bytes;
+    handle->load_order = next_order++;
+    trim_locked(handle);
+}
+
+void TextureCache::trim_locked(const TextureHandle* keep) {
+    reclaim_locked();
+    while (budget_bytes > 0 && bytes > budget_bytes) {
+        // Textura decodificada mais antiga, em uso ou não
+        Entries::iterator victim = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            TextureHandle* h = it->second.get();
+            if (h == keep || h->cached_bytes == 0) continue;
+            if (victim == entries.end() || h->load_order < victim->second->load_order) victim = it;
+        }
+        if (victim == entries.end()) return; // Só a textura recém-carregada: ela excede o orçamento sozinha
+
+        // Sem cena que a use, a entrada sai junto
+        if (victim->second.use_count() == 1) erase_locked(victim);
+        else evict_locked(victim->second.get());
+        reclaim_locked();
+    }
+}
+
+void TextureCache::erase_locked(Entries::iterator it) {
+    evict_locked(it->second.get());
+    entries.erase(it); // Último dono: o handle e a fonte são liberados
+}
+
+void TextureCache::evict_locked(TextureHandle* h) {
+    std::unique_ptr<Texture> old;
+    {
+        std::lock_guard<std::mutex> lock(h->load_mtx);
+        h->ready.store(nullptr, std::memory_order_seq_cst);
+        h->loaded = false;
+        old = std::move(h->data);
+    }
+    size_t texture_bytes = h->cached_bytes;
+    h->cached_bytes = 0;
+    if (!old) return;
+    evictions++;
+    retired.push_back(Retired{std::move(old), texture_bytes});
+}
+
+void TextureCache::reclaim_locked() {
+    if (retired.empty()) return;
+    std::vector<const Texture*> pinned;
+    {
+        SlotRegistry& r = SlotRegistry::instance();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for (std::atomic<const Texture*>* slot : r.slots) {
+            const Texture* t = slot->load(std::memory_order_seq_cst);
+            if (t) pinned.push_back(t);
+        }
+    }
+    for (size_t i = 0; i < retired.size();) {
+        if (std::find(pinned.begin(), pinned.end(), retired[i].texture.get()) != pinned.end()) {
+            i++;
+            continue;
+        }
+        bytes -= retired[i].bytes;
+        retired[i] = std::move(retired.back());
+        retired.pop_back();
+    }
+}
+
+TextureCache::Stats TextureCache::stats() {
+    std::lock_guard<std::mutex> lock(mtx);
+    reclaim_locked();
+    Stats s;
+    s.hits = hits;
+    s.misses = misses;
+    s.loads = loads;
+    s.evictions = evictions;
+    s.entries = entries.size();
+    s.resident = 0;
+    for (auto& entry : entries) {
+        if (entry.second->ready.load(std::memory_order_acquire)) s.resident++;
+    }
+    s.bytes = bytes;
+    return s;
+}
@@ -0,0 +1,109 @@
+#include "tile_scheduler.h"
+#include <algorithm>
+
+std::vector<Tile> make_tiles(int width, int height, int tile_size) {
+    std::vector<Tile> tiles;
+    if (tile_size < 1) tile_size = 1;
+    for (int y = 0; y < height; y += tile_size) {
+        for (int x = 0; x < width; x += tile_size) {
+            tiles.push_back({x, y, std::min(x + tile_size, width), std::min(y + tile_size, height)});
+        }
+    }
+    return tiles;
+}
+
+TileScheduler::TileScheduler(int num_threads)
+    : generation(0), active(0), stopping(false), current_tiles(nullptr), current_job(nullptr) {
+    if (num_threads <= 0) num_threads = (int)std::thread::hardware_concurrency();
+    if (num_threads <= 0) num_threads = 1;
+
+    for (int i = 0; i < num_threads; i++) queues.emplace_back(new WorkQueue());
+
+    // O worker 0 é a própria thread que chama run()
+    for (int i = 1; i < num_threads; i++) {
+        workers.emplace_back(&TileScheduler::worker_loop, this, i);
+    }
+}
+
+TileScheduler::~TileScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void TileScheduler::run(const std::vector<Tile>& tiles, const TileJob& job) {
+    if (tiles.empty()) return;
+
+    // Distribuição inicial intercalada: cada worker começa com tiles
+    // espalhados pela imagem, o que já equilibra boa parte da carga
+    int n = thread_count();
+    for (int i = 0; i < (int)tiles.size(); i++) {
+        queues[i % n]->tiles.push_back(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        current_tiles = &tiles;
+        current_job = &job;
+        active = (int)workers.size();
+        generation++;
+    }
+    wake_cv.notify_all();
+
+    process(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done_cv.wait(lock, [this] { return active == 0; });
+    current_tiles = nullptr;
+    current_job = nullptr;
+}
+
+void TileScheduler::worker_loop(int index) {
+    unsigned seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake_cv.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        process(index);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--active == 0) done_cv.notify_all();
+    }
+}
+
+void TileScheduler::process(int index) {
+    int tile;
+    while (pop_local(index, tile) || steal(index, tile)) {
+        (*current_job)((*current_tiles)[tile], index);
+    }
+}
+
+bool TileScheduler::pop_local(int index, int& tile) {
+    WorkQueue& q = *queues[index];
+    std::lock_guard<std::mutex> lock(q.mtx);
+    if (q.tiles.empty()) return false;
+    tile = q.tiles.front();
+    q.tiles.pop_front();
+    return true;
+}
+
+bool TileScheduler::steal(int index, int& tile) {
+    int n = thread_count();
+    for (int k = 1; k < n; k++) {
+        WorkQueue& victim = *queues[(index + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (victim.tiles.empty()) continue;
+        // Rouba do final: o dono consome pelo início, minimizando disputa
+        tile = victim.tiles.back();
+        victim.tiles.pop_back();
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,631 @@
+// Benchmark com cenas geradas proceduralmente (ver "make bench").
+//
+// Cada cena é gravada no formato de texto e passa pelo caminho completo do
+// raytracer: leitura (loadScene), montagem da BVH (build_acceleration),
+// renderização (render_image, que chama cast_ray para cada pixel) e gravação
+// do PPM. Cada fase é cronometrada em todas as execuções, e o resultado
+// (média, desvio padrão, mínimo e máximo) vai para um arquivo JSON, para ser
+// acompanhado ao longo do tempo. Um resumo legível sai em stdout. Quando o
+// processador expõe os eventos (perf_event_open), as falhas de leitura nos
+// caches L1 de dados e de último nível durante a renderização também entram.
+//
+// Uso: bench [--runs N] [--warmup N] [--scale S] [--width W] [--height H]
+//            [--threads N] [--simd auto|scalar|avx2|avx512] [--wavefront]
+//            [--scenes a,b,...] [--dir pasta] [--output resultado.json]
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "image_io.h"
+#include "render.h"
+#include "counters.h"
+#include "scene.h"
+#include "texture_cache.h"
+
+// Protótipo da função parser
+bool loadScene(const std::string& filename, Scene& scene);
+
+namespace {
+
+const int FORMAT_VERSION = 2; // Versão do JSON gerado
+
+// Chaves de "phase_ms" no JSON, na ordem de CounterPhase
+const char* const PHASE_KEYS[NUM_PHASES] = {"primary", "secondary", "shadow", "shading", "texture"};
+
+// Gerador determinístico (splitmix64): a mesma cena em toda máquina
+struct Rng {
+    uint64_t state;
+
+    explicit Rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    double range(double a, double b) { return a + (b - a) * uniform(); }
+    int index(int n) { return (int)(next() % (uint64_t)n); }
+};
+
+// Texto de uma cena em construção, com as seções na ordem do formato
+struct SceneText {
+    std::ostringstream camera, lights, pigments, finishes, objects;
+    int num_lights = 0, num_pigments = 0, num_finishes = 0, num_objects = 0;
+
+    SceneText() {
+        camera << "0 6 18\n0 1 0\n0 1 0\n50\n";
+        light(0, 0, 0, 0.15, 0.15, 0.15); // Ambiente
+    }
+
+    void light(double x, double y, double z, double r, double g, double b) {
+        lights << x << " " << y << " " << z << " " << r << " " << g << " " << b << " 1 0 0.002\n";
+        num_lights++;
+    }
+
+    int pigment(const std::string& line) {
+        pigments << line << "\n";
+        return num_pigments++;
+    }
+
+    // ka kd ks alpha kr kt ior
+    int finish(double ka, double kd, double ks, double alpha, double kr, double kt, double ior) {
+        finishes << ka << " " << kd << " " << ks << " " << alpha << " " << kr << " " << kt << " " << ior << "\n";
+        return num_finishes++;
+    }
+
+    void sphere(int pig, int fin, double x, double y, double z, double r) {
+        objects << pig << " " << fin << " sphere " << x << " " << y << " " << z << " " << r << "\n";
+        num_objects++;
+    }
+
+    // Caixa [x0,x1] x [y0,y1] x [z0,z1] como poliedro de 6 faces
+    void box(int pig, int fin, double x0, double y0, double z0, double x1, double y1, double z1) {
+        objects << pig << " " << fin << " polyhedron 6\n"
+                << "1 0 0 " << -x1 << "\n-1 0 0 " << x0 << "\n"
+                << "0 1 0 " << -y1 << "\n0 -1 0 " << y0 << "\n"
+                << "0 0 1 " << -z1 << "\n0 0 -1 " << z0 << "\n";
+        num_objects++;
+    }
+
+    // Poliedro convexo com faces tangentes à esfera (c, r) em direções aleatórias,
+    // mais as 6 faces de uma caixa um pouco maior, que garantem que é limitado
+    void gem(Rng& rng, int pig, int fin, double cx, double cy, double cz, double r, int faces) {
+        objects << pig << " " << fin << " polyhedron " << faces + 6 << "\n";
+        for (int k = 0; k < faces; k++) {
+            double nx, ny, nz, len;
+            do {
+                nx = rng.range(-1, 1);
+                ny = rng.range(-1, 1);
+                nz = rng.range(-1, 1);
+                len = std::sqrt(nx * nx + ny * ny + nz * nz);
+            } while (len < 0.1 || len > 1);
+            nx /= len;
+            ny /= len;
+            nz /= len;
+            objects << nx << " " << ny << " " << nz << " " << -(nx * cx + ny * cy + nz * cz) - r << "\n";
+        }
+        double h = 1.3 * r;
+        objects << "1 0 0 " << -(cx + h) << "\n-1 0 0 " << cx - h << "\n"
+                << "0 1 0 " << -(cy + h) << "\n0 -1 0 " << cy - h << "\n"
+                << "0 0 1 " << -(cz + h) << "\n0 0 -1 " << cz - h << "\n";
+        num_objects++;
+    }
+
+    bool write(const std::string& path) const {
+        std::ofstream out(path);
+        out << camera.str() << num_lights << "\n" << lights.str() << num_pigments << "\n" << pigments.str()
+            << num_finishes << "\n" << finishes.str() << num_objects << "\n" << objects.str();
+        return (bool)out;
+    }
+};
+
+// Textura procedural (P6) para as cenas com texmap
+bool write_texture(const std::string& path, int size, int variant) {
+    std::vector<unsigned char> texels(3 * (size_t)size * size);
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            unsigned char* t = &texels[3 * ((size_t)j * size + i)];
+            int stripes = ((i / (4 << variant)) + (j / (4 << variant))) & 1;
+            t[0] = (unsigned char)(stripes ? 230 : (i * 255 / size));
+            t[1] = (unsigned char)((j * 255 / size) ^ (variant * 60));
+            t[2] = (unsigned char)(stripes ? 40 + 50 * variant : 200);
+        }
+    }
+    std::ofstream out(path, std::ios::binary);
+    out << "P6\n" << size << " " << size << "\n255\n";
+    out.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+    return (bool)out;
+}
+
+// Piso xadrez comum às cenas
+void floor_box(SceneText& s) {
+    int pig = s.pigment("checker 0.9 0.9 0.9 0.2 0.2 0.25 2");
+    int fin = s.finish(0.3, 0.7, 0.2, 20, 0, 0, 1);
+    s.box(pig, fin, -40, -1, -60, 40, 0, 20);
+}
+
+int scaled(double base, double scale) {
+    return std::max(1, (int)std::lround(base * scale));
+}
+
+// --- Cenas ---
+
+void scene_spheres(SceneText& s, Rng& rng, double scale, const std::string&) {
+    s.light(-10, 20, 10, 0.8, 0.8, 0.8);
+    s.light(15, 12, 5, 0.4, 0.4, 0.5);
+    floor_box(s);
+    int pigs[4] = {s.pigment("solid 0.8 0.2 0.2"), s.pigment("solid 0.2 0.7 0.3"),
+                   s.pigment("solid 0.2 0.3 0.9"), s.pigment("checker 1 1 0 0 0 0 0.1")};
+    int fins[2] = {s.finish(0.2, 0.7, 0.3, 30, 0, 0, 1), s.finish(0.2, 0.9, 0, 1, 0, 0, 1)};
+    int n = scaled(20000, scale);
+    for (int i = 0; i < n; i++) {
+        s.sphere(pigs[rng.index(4)], fins[rng.index(2)], rng.range(-14, 14), rng.range(0.2, 8),
+                 rng.range(-30, 4), rng.range(0.05, 0.3));
+    }
+}
+
+void scene_polyhedra(SceneText& s, Rng& rng, double scale, const std::string&) {
+    s.light(-10, 20, 10, 0.8, 0.8, 0.8);
+    s.light(12, 8, 12, 0.4, 0.4, 0.4);
+    floor_box(s);
+    int pigs[3] = {s.pigment("solid 0.9 0.6 0.1"), s.pigment("solid 0.5 0.2 0.8"), s.pigment("solid 0.1 0.8 0.8")};
+    int fin = s.finish(0.2, 0.7, 0.5, 60, 0, 0, 1);
+    int n = scaled(1500, scale);
+    for (int i = 0; i < n; i++) {
+        s.gem(rng, pigs[rng.index(3)], fin, rng.range(-12, 12), rng.range(0.5, 7), rng.range(-25, 2),
+              rng.range(0.2, 0.6), 24 + rng.index(25));
+    }
+}
+
+void scene_glass(SceneText& s, Rng& rng, double scale, const std::string&) {
+    s.light(-8, 15, 12, 0.9, 0.9, 0.9);
+    s.light(10, 10, 4, 0.4, 0.4, 0.4);
+    s.light(0, 20, -20, 0.3, 0.3, 0.3);
+    floor_box(s);
+    int pig = s.pigment("solid 0.9 0.9 0.95");
+    int mirror = s.finish(0.05, 0.2, 0.6, 100, 0.8, 0, 1);
+    int glass = s.finish(0.02, 0.05, 0.6, 150, 0.1, 0.9, 1.5);
+    int n = scaled(150, scale);
+    for (int i = 0; i < n; i++) {
+        s.sphere(pig, i % 2 ? glass : mirror, rng.range(-9, 9), rng.range(0.5, 5), rng.range(-15, 3),
+                 rng.range(0.3, 1.0));
+    }
+}
+
+void scene_texmap(SceneText& s, Rng& rng, double scale, const std::string& dir) {
+    s.light(-10, 20, 10, 0.9, 0.9, 0.9);
+    const int TEXTURES = 4;
+    int pigs[TEXTURES];
+    for (int t = 0; t < TEXTURES; t++) {
+        std::string path = dir + "/bench_tex" + std::to_string(t) + ".ppm";
+        write_texture(path, 512, t);
+        double k = 0.3 + 0.4 * t;
+        std::ostringstream line;
+        line << "texmap " << path << " " << k << " 0 0 0 0 " << k << " " << 0.1 * t << " 0";
+        pigs[t] = s.pigment(line.str());
+    }
+    int fin = s.finish(0.3, 0.7, 0.2, 20, 0, 0, 1);
+    int floor_pig = s.pigment("texmap " + dir + "/bench_tex0.ppm 0.1 0 0 0 0 0 0.1 0");
+    s.box(floor_pig, fin, -40, -1, -60, 40, 0, 20);
+    int n = scaled(400, scale);
+    for (int i = 0; i < n; i++) {
+        s.sphere(pigs[rng.index(TEXTURES)], fin, rng.range(-12, 12), rng.range(0.3, 6), rng.range(-25, 3),
+                 rng.range(0.2, 0.8));
+    }
+}
+
+void scene_lights(SceneText& s, Rng& rng, double scale, const std::string&) {
+    const int lights = 24; // Fixo: --scale muda só a geometria
+    for (int i = 0; i < lights; i++) {
+        s.light(rng.range(-20, 20), rng.range(3, 20), rng.range(-30, 15), 0.12, 0.12, 0.12);
+    }
+    floor_box(s);
+    int pigs[2] = {s.pigment("solid 0.8 0.8 0.8"), s.pigment("solid 0.9 0.4 0.2")};
+    int fin = s.finish(0.1, 0.8, 0.3, 40, 0, 0, 1);
+    int n = scaled(400, scale);
+    for (int i = 0; i < n; i++) {
+        s.sphere(pigs[rng.index(2)], fin, rng.range(-12, 12), rng.range(0.3, 6), rng.range(-25, 3),
+                 rng.range(0.2, 0.7));
+    }
+}
+
+struct BenchScene {
+    const char* name;
+    const char* description;
+    void (*generate)(SceneText& s, Rng& rng, double scale, const std::string& dir);
+};
+
+const BenchScene SCENES[] = {
+    {"spheres", "muitas esferas pequenas", scene_spheres},
+    {"polyhedra", "poliedros de 30 a 54 faces", scene_polyhedra},
+    {"glass", "esferas espelhadas e de vidro", scene_glass},
+    {"texmap", "texturas em todos os objetos", scene_texmap},
+    {"lights", "muitas luzes", scene_lights},
+};
+
+// Média, desvio padrão (amostral), mínimo e máximo de uma fase
+struct Summary {
+    double mean = 0, stddev = 0, min = 0, max = 0;
+};
+
+Summary summarize(const std::vector<double>& v) {
+    Summary s;
+    if (v.empty()) return s;
+    s.min = *std::min_element(v.begin(), v.end());
+    s.max = *std::max_element(v.begin(), v.end());
+    for (double x : v) s.mean += x;
+    s.mean /= v.size();
+    if (v.size() > 1) {
+        double sq = 0;
+        for (double x : v) sq += (x - s.mean) * (x - s.mean);
+        s.stddev = std::sqrt(sq / (v.size() - 1));
+    }
+    return s;
+}
+
+std::string json(const Summary& s) {
+    std::ostringstream out;
+    out << std::setprecision(6) << "{\"mean\": " << s.mean << ", \"stddev\": " << s.stddev
+        << ", \"min\": " << s.min << ", \"max\": " << s.max << "}";
+    return out.str();
+}
+
+// Falhas de leitura nos caches L1 de dados e de último nível, contadas pelo
+// processador. Os contadores são abertos com inherit antes de o escalonador
+// criar as threads, então a leitura soma o processo e todos os workers. Em
+// máquinas virtuais sem esses eventos, available() é falso e error diz o motivo.
+struct CacheCounters {
+    int l1d = -1, llc = -1;
+    std::string error;
+
+    CacheCounters() {
+        l1d = open_event(PERF_COUNT_HW_CACHE_L1D);
+        if (l1d >= 0) llc = open_event(PERF_COUNT_HW_CACHE_LL);
+        if (l1d < 0 || llc < 0) {
+            error = std::strerror(errno);
+            if (l1d >= 0) close(l1d);
+            l1d = -1;
+        }
+    }
+
+    ~CacheCounters() {
+        if (l1d >= 0) close(l1d);
+        if (llc >= 0) close(llc);
+    }
+
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+
+    bool available() const { return l1d >= 0; }
+
+    // Totais desde a abertura
+    void read_totals(uint64_t& l1d_misses, uint64_t& llc_misses) const {
+        l1d_misses = value(l1d);
+        llc_misses = value(llc);
+    }
+
+private:
+    static int open_event(uint64_t cache) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    static uint64_t value(int fd) {
+        uint64_t v = 0;
+        if (fd < 0 || read(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) return 0;
+        return v;
+    }
+};
+
+struct SceneResult {
+    std::string name;
+    size_t objects = 0, lights = 0;
+    uint64_t primary_rays = 0;
+    std::vector<double> load_ms, build_ms, render_ms, write_ms, mrays;
+    std::vector<double> l1d_misses, llc_misses; // Só com CacheCounters::available()
+    RayCounters counters; // Da última execução (só com RT_COUNTERS)
+};
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Silencia std::cout (mensagens de carga de textura) durante uma execução
+struct QuietStdout {
+    std::ostringstream sink;
+    std::streambuf* saved;
+
+    QuietStdout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietStdout() { std::cout.rdbuf(saved); }
+};
+
+// Uma execução completa: leitura, BVH, renderização e gravação
+bool run_once(const std::string& scene_file, const std::string& image_file, const RenderSettings& settings,
+              TileScheduler& scheduler, const CacheCounters& cache, SceneResult& result, bool record) {
+    // Texturas são lidas de novo a cada execução, como num processo novo
+    TextureCache::instance().purge();
+    QuietStdout quiet;
+
+    auto start = std::chrono::steady_clock::now();
+    Scene scene;
+    if (!loadScene(scene_file, scene)) return false;
+    double load = ms_since(start);
+
+    start = std::chrono::steady_clock::now();
+    scene.camera->set_aspect(double(settings.width) / settings.height);
+    scene.texture_filter = settings.texture_filter;
+    scene.max_depth = settings.max_depth;
+    scene.min_weight = settings.min_weight;
+    scene.build_acceleration();
+    scene.prepare_lights();
+    double build = ms_since(start);
+
+    Framebuffer fb(settings.width, settings.height);
+    RenderStats stats;
+    counters_reset();
+    uint64_t l1d_before = 0, llc_before = 0, l1d_after = 0, llc_after = 0;
+    if (cache.available()) cache.read_totals(l1d_before, llc_before);
+    start = std::chrono::steady_clock::now();
+    render_image(scene, settings, scheduler, fb, RowsReady(), &stats);
+    double render = ms_since(start);
+    if (cache.available()) cache.read_totals(l1d_after, llc_after);
+
+    start = std::chrono::steady_clock::now();
+    if (!write_ppm(image_file, fb, PPM_BINARY)) return false;
+    double write = ms_since(start);
+
+    if (record) {
+        result.objects = scene.objects.size();
+        result.lights = scene.lights.size();
+        result.primary_rays = stats.primary_samples + stats.extra_samples;
+        result.counters = counters_total();
+        result.load_ms.push_back(load);
+        result.build_ms.push_back(build);
+        result.render_ms.push_back(render);
+        result.write_ms.push_back(write);
+        result.mrays.push_back(render > 0 ? result.primary_rays / (render * 1e3) : 0.0);
+        if (cache.available()) {
+            result.l1d_misses.push_back(double(l1d_after - l1d_before));
+            result.llc_misses.push_back(double(llc_after - llc_before));
+        }
+    }
+    return true;
+}
+
+void print_usage(const char* prog) {
+    std::cerr << "Uso: " << prog << " [--runs N] [--warmup N] [--scale S] [--width W] [--height H] [--threads N]"
+              << " [--simd auto|scalar|avx2|avx512] [--wavefront] [--scenes a,b,...] [--dir pasta]"
+              << " [--output resultado.json]"
+              << std::endl;
+    std::cerr << "Cenas:";
+    for (const BenchScene& s : SCENES) std::cerr << " " << s.name;
+    std::cerr << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+    RenderSettings settings;
+    settings.width = 400;
+    settings.height = 300;
+    settings.progress = false;
+    int runs = 5, warmup = 1;
+    double scale = 1.0;
+    std::string dir = (std::filesystem::temp_directory_path() / "raytracer_bench").string();
+    std::string output = "bench.json";
+    std::vector<std::string> selected;
+
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if (arg == "--runs" && k + 1 < argc) {
+            runs = std::atoi(argv[++k]);
+        } else if (arg == "--warmup" && k + 1 < argc) {
+            warmup = std::atoi(argv[++k]);
+        } else if (arg == "--scale" && k + 1 < argc) {
+            scale = std::atof(argv[++k]);
+        } else if (arg == "--width" && k + 1 < argc) {
+            settings.width = std::atoi(argv[++k]);
+        } else if (arg == "--height" && k + 1 < argc) {
+            settings.height = std::atoi(argv[++k]);
+        } else if (arg == "--threads" && k + 1 < argc) {
+            settings.threads = std::atoi(argv[++k]);
+        } else if (arg == "--simd" && k + 1 < argc) {
+            if (!parse_simd_level(argv[++k], settings.simd)) {
+                std::cerr << "Nivel SIMD invalido: " << argv[k] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--wavefront") {
+            settings.wavefront = true;
+        } else if (arg == "--scenes" && k + 1 < argc) {
+            std::stringstream list(argv[++k]);
+            std::string name;
+            while (std::getline(list, name, ',')) {
+                if (!name.empty()) selected.push_back(name);
+            }
+        } else if (arg == "--dir" && k + 1 < argc) {
+            dir = argv[++k];
+        } else if (arg == "--output" && k + 1 < argc) {
+            output = argv[++k];
+        } else {
+            std::cerr << "Opcao desconhecida: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (runs < 1 || warmup < 0 || scale <= 0 || settings.width <= 0 || settings.height <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<const BenchScene*> scenes;
+    for (const BenchScene& s : SCENES) {
+        if (selected.empty() || std::find(selected.begin(), selected.end(), s.name) != selected.end()) {
+            scenes.push_back(&s);
+        }
+    }
+    for (const std::string& name : selected) {
+        bool known = false;
+        for (const BenchScene& s : SCENES) known = known || name == s.name;
+        if (!known) {
+            std::cerr << "Cena desconhecida: " << name << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        std::cerr << "Erro: Nao foi possivel criar " << dir << std::endl;
+        return 1;
+    }
+
+    set_simd_level(settings.simd);
+    CacheCounters cache; // Antes do escalonador, para que os workers herdem os contadores
+    TileScheduler scheduler(settings.threads);
+
+    std::vector<SceneResult> results;
+    for (const BenchScene* bs : scenes) {
+        SceneText text;
+        Rng rng(0x5EED0000ULL + (bs - SCENES)); // Não depende de --scenes
+        bs->generate(text, rng, scale, dir);
+        std::string scene_file = dir + "/" + bs->name + ".in";
+        std::string image_file = dir + "/" + bs->name + ".ppm";
+        if (!text.write(scene_file)) {
+            std::cerr << "Erro: Nao foi possivel gravar " << scene_file << std::endl;
+            return 1;
+        }
+
+        SceneResult result;
+        result.name = bs->name;
+        std::cerr << "Cena " << bs->name << " (" << bs->description << "): ";
+        for (int r = 0; r < warmup + runs; r++) {
+            if (!run_once(scene_file, image_file, settings, scheduler, cache, result, r >= warmup)) {
+                std::cerr << "falhou" << std::endl;
+                return 1;
+            }
+            std::cerr << "." << std::flush;
+        }
+        std::cerr << std::endl;
+        results.push_back(result);
+    }
+
+    // Resumo legível
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(11) << "cena" << std::right << std::setw(9) << "objetos"
+              << std::setw(7) << "luzes" << std::setw(11) << "leitura" << std::setw(9) << "BVH"
+              << std::setw(18) << "render (ms)" << std::setw(9) << "escrita" << std::setw(14) << "M raios/s"
+              << std::endl;
+    for (const SceneResult& r : results) {
+        Summary render = summarize(r.render_ms);
+        std::ostringstream render_col;
+        render_col << std::fixed << std::setprecision(1) << render.mean << " +- " << render.stddev;
+        std::cout << std::left << std::setw(11) << r.name << std::right << std::setw(9) << r.objects
+                  << std::setw(7) << r.lights << std::setw(11) << summarize(r.load_ms).mean
+                  << std::setw(9) << summarize(r.build_ms).mean << std::setw(18) << render_col.str()
+                  << std::setw(9) << summarize(r.write_ms).mean << std::setw(14) << std::setprecision(3)
+                  << summarize(r.mrays).mean << std::setprecision(1) << std::endl;
+    }
+    if (cache.available()) {
+        std::cout << "Falhas de leitura de cache na renderizacao (media por execucao, em milhares):" << std::endl;
+        for (const SceneResult& r : results) {
+            std::cout << "  " << std::left << std::setw(11) << r.name << std::right << "L1D "
+                      << summarize(r.l1d_misses).mean / 1e3 << "  LLC " << summarize(r.llc_misses).mean / 1e3
+                      << std::endl;
+        }
+    } else {
+        std::cout << "Falhas de cache: contadores do processador indisponiveis (" << cache.error << ")" << std::endl;
+    }
+
+    // Resultado completo em JSON
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::ostringstream js;
+    js << "{\n"
+       << "  \"version\": " << FORMAT_VERSION << ",\n"
+       << "  \"date\": \"" << date << "\",\n"
+       << "  \"precision\": \"" << (sizeof(Real) == sizeof(float) ? "float" : "double") << "\",\n"
+       << "  \"counters\": " << (COUNTERS_ENABLED ? "true" : "false") << ",\n"
+       << "  \"simd\": \"" << simd_level_name(simd_level()) << "\",\n"
+       << "  \"threads\": " << scheduler.thread_count() << ",\n"
+       << "  \"wavefront\": " << (settings.wavefront ? "true" : "false") << ",\n"
+       << "  \"cache_counters\": " << (cache.available() ? "true" : "false") << ",\n"
+       << "  \"width\": " << settings.width << ",\n"
+       << "  \"height\": " << settings.height << ",\n"
+       << "  \"scale\": " << scale << ",\n"
+       << "  \"runs\": " << runs << ",\n"
+       << "  \"warmup\": " << warmup << ",\n"
+       << "  \"scenes\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const SceneResult& r = results[i];
+        js << "    {\n"
+           << "      \"name\": \"" << r.name << "\",\n"
+           << "      \"objects\": " << r.objects << ",\n"
+           << "      \"lights\": " << r.lights << ",\n"
+           << "      \"primary_rays\": " << r.primary_rays << ",\n"
+           << "      \"load_ms\": " << json(summarize(r.load_ms)) << ",\n"
+           << "      \"build_ms\": " << json(summarize(r.build_ms)) << ",\n"
+           << "      \"render_ms\": " << json(summarize(r.render_ms)) << ",\n"
+           << "      \"write_ms\": " << json(summarize(r.write_ms)) << ",\n"
+           << "      \"mrays_per_s\": " << json(summarize(r.mrays));
+        if (cache.available()) {
+            js << ",\n      \"cache_misses\": {\"l1d_read\": " << json(summarize(r.l1d_misses))
+               << ", \"llc_read\": " << json(summarize(r.llc_misses)) << "}";
+        }
+        if (COUNTERS_ENABLED) {
+            const RayCounters& c = r.counters;
+            js << ",\n      \"rays\": {\"primary\": " << c.primary_rays << ", \"shadow\": " << c.shadow_rays
+               << ", \"reflection\": " << c.reflection_rays << ", \"refraction\": " << c.refraction_rays
+               << ", \"total\": " << c.rays() << "},\n"
+               << "      \"tests\": {\"sphere\": " << c.sphere_tests << ", \"polyhedron\": " << c.polyhedron_tests
+               << "},\n"
+               << "      \"shadow_cache\": {\"tests\": " << c.shadow_cache_tests << ", \"hits\": "
+               << c.shadow_cache_hits << "},\n"
+               << "      \"phase_ms\": {";
+            for (int p = 0; p < NUM_PHASES; p++) {
+                js << (p ? ", " : "") << "\"" << PHASE_KEYS[p] << "\": "
+                   << c.phase_ns[p] / 1e6;
+            }
+            js << "}";
+        }
+        js << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    js << "  ]\n}\n";
+
+    std::ofstream out(output);
+    out << js.str();
+    if (!out) {
+        std::cerr << "Erro: Nao foi possivel gravar " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Resultado gravado em " << output << std::endl;
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Compara duas imagens PPM pixel a pixel (ex.: a mesma cena renderizada em
+// double e em float, ver "make precision-check") e informa quantos pixels
+// diferem, a diferença máxima e média por canal e a PSNR.
+//
+// Uso: ppmdiff <a.ppm> <b.ppm> [--tolerance N] [--diff saida.ppm]
+// Retorna 0 se nenhum canal difere mais que N (padrão 0), 1 caso contrário
+// e 2 em caso de erro.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "texture.h"
+
+static void print_usage(const char* prog) {
+    std::cerr << "Uso: " << prog << " <a.ppm> <b.ppm> [--tolerance N] [--diff saida.ppm]" << std::endl;
+}
+
+static int channel(const Texture& t, size_t k) {
+    return t.texels8.empty() ? t.texels16[k] : t.texels8[k];
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> positional;
+    int tolerance = 0;
+    std::string diff_file;
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if (arg == "--tolerance" && k + 1 < argc) {
+            tolerance = std::atoi(argv[++k]);
+        } else if (arg == "--diff" && k + 1 < argc) {
+            diff_file = argv[++k];
+        } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Opcao desconhecida: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 2;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    std::unique_ptr<Texture> a(readPPM(positional[0]));
+    std::unique_ptr<Texture> b(readPPM(positional[1]));
+    if (!a || !b) return 2;
+    if (a->width != b->width || a->height != b->height || a->max_value != b->max_value) {
+        std::cerr << "Erro: As imagens tem tamanhos ou valores maximos diferentes." << std::endl;
+        return 2;
+    }
+
+    size_t pixels = (size_t)a->width * a->height;
+    size_t differing = 0, above = 0;
+    int max_diff = 0;
+    double sum = 0, sum_sq = 0;
+    std::vector<unsigned char> heat(diff_file.empty() ? 0 : 3 * pixels);
+    for (size_t p = 0; p < pixels; p++) {
+        int worst = 0;
+        for (int ch = 0; ch < 3; ch++) {
+            int d = std::abs(channel(*a, 3 * p + ch) - channel(*b, 3 * p + ch));
+            sum += d;
+            sum_sq += double(d) * d;
+            if (d > worst) worst = d;
+        }
+        if (worst > 0) differing++;
+        if (worst > tolerance) above++;
+        if (worst > max_diff) max_diff = worst;
+        if (!heat.empty()) {
+            // Vermelho acima da tolerância, cinza abaixo (ampliado 8x)
+            unsigned char v = (unsigned char)std::min(255, worst * 8 * 255 / a->max_value);
+            heat[3 * p + 0] = worst > tolerance ? 255 : v;
+            heat[3 * p + 1] = worst > tolerance ? 0 : v;
+            heat[3 * p + 2] = worst > tolerance ? 0 : v;
+        }
+    }
+
+    double channels = 3.0 * pixels;
+    double mse = sum_sq / channels;
+    std::cout << "Pixels: " << pixels << " (" << a->width << "x" << a->height << ")" << std::endl;
+    std::cout << "Diferentes: " << differing << " (" << 100.0 * differing / pixels << "%)" << std::endl;
+    std::cout << "Acima da tolerancia " << tolerance << ": " << above << " ("
+              << 100.0 * above / pixels << "%)" << std::endl;
+    std::cout << "Diferenca por canal: maxima " << max_diff << ", media " << sum / channels << std::endl;
+    if (mse > 0) {
+        std::cout << "PSNR: " << 10.0 * std::log10(double(a->max_value) * a->max_value / mse) << " dB" << std::endl;
+    } else {
+        std::cout << "PSNR: infinita (imagens identicas)" << std::endl;
+    }
+
+    if (!heat.empty()) {
+        std::FILE* f = std::fopen(diff_file.c_str(), "wb");
+        bool ok = f != nullptr;
+        if (f) {
+            std::fprintf(f, "P6\n%d %d\n255\n", a->width, a->height);
+            ok = std::fwrite(heat.data(), 1, heat.size(), f) == heat.size();
+            ok = (std::fclose(f) == 0) && ok;
+        }
+        if (!ok) {
+            std::cerr << "Erro: Falha ao gravar " << diff_file << std::endl;
+            return 2;
+        }
+    }
+    return above > 0 ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+// Junta as imagens parciais de um quadro renderizado em pedaços (--region,
+// possivelmente em máquinas diferentes) na imagem completa. A posição de cada
+// parte vem do comentário "# region" do seu cabeçalho.
+//
+// Uso: ppmmerge <saida.ppm> <parte.ppm> [parte.ppm ...]
+// Retorna 0 se a imagem foi gravada e 1 se as partes não formam uma imagem
+// completa (tamanhos diferentes, pixels sem parte) ou em caso de erro.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "image_io.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Uso: " << argv[0] << " <saida.ppm> <parte.ppm> [parte.ppm ...]" << std::endl;
+        return 1;
+    }
+    std::vector<std::string> parts(argv + 2, argv + argc);
+    if (!merge_ppm_parts(parts, argv[1])) return 1;
+    std::cout << parts.size() << " parte(s) juntada(s) em " << argv[1] << std::endl;
+    return 0;
+}
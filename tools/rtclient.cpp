@@ -0,0 +1,72 @@
+// Cliente do servidor de renderização (raytracer --serve): manda um pedido
+// pelo socket Unix, espera a resposta e a imprime. Os caminhos da cena e da
+// saída são convertidos para absolutos, já que o servidor pode estar rodando
+// em outro diretório.
+//
+// Uso: rtclient <socket> render <cena> <saida.ppm> [opções do pedido]
+//      rtclient <socket> status
+//      rtclient <socket> stop
+// Retorna 0 se a resposta começa com "ok" e 1 caso contrário.
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Uso: " << argv[0] << " <socket> render <cena> <saida.ppm> [opcoes] | status | stop" << std::endl;
+        return 1;
+    }
+    std::vector<std::string> fields(argv + 2, argv + argc);
+    if (fields[0] == "render" && fields.size() >= 3) {
+        for (size_t k = 1; k <= 2; k++) fields[k] = std::filesystem::absolute(fields[k]).lexically_normal().string();
+    }
+    std::string request;
+    for (const std::string& f : fields) {
+        if (f.find_first_of("\t\n") != std::string::npos) {
+            std::cerr << "Erro: Campos do pedido nao podem ter tabulacao nem quebra de linha: " << f << std::endl;
+            return 1;
+        }
+        request += (request.empty() ? "" : "\t") + f;
+    }
+    request += "\n";
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::string path = argv[1];
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Erro: Caminho de socket longo demais: " << path << std::endl;
+        return 1;
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "Erro: Nao foi possivel conectar ao servidor em " << path << std::endl;
+        return 1;
+    }
+
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t n = write(fd, request.data() + sent, request.size() - sent);
+        if (n <= 0) break;
+        sent += n;
+    }
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) response.append(buf, n);
+    close(fd);
+
+    if (response.empty()) {
+        std::cerr << "Erro: O servidor fechou a conexao sem responder." << std::endl;
+        return 1;
+    }
+    std::cout << response;
+    return response.compare(0, 2, "ok") == 0 ? 0 : 1;
+}
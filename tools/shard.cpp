@@ -0,0 +1,218 @@
+// Renderiza um quadro dividido entre N processos do raytracer na mesma
+// máquina, cada um com --region (faixas horizontais ou tiles), e junta as
+// partes com merge_ppm_parts, como faria um cluster com um processo por nó.
+// Serve para medir a escala com processos antes de distribuir os pedaços
+// entre máquinas. Usa fork/exec, então só funciona em Linux e Mac.
+//
+// Uso: shard <arquivo_cena> <saida.ppm> [--procs N] [--split stripes|tiles]
+//            [--width W] [--height H] [--raytracer caminho] [--keep-parts]
+//            [-- opções repassadas ao raytracer]
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "image_io.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Sufixo da variante do Makefile (ex.: bin/shard_float inicia bin/raytracer_float)
+const char* const VARIANT =
+#ifdef RT_FLOAT
+    "_float"
+#endif
+#ifdef RT_COUNTERS
+    "_counters"
+#endif
+    "";
+
+void print_usage(const char* prog) {
+    std::cerr << "Uso: " << prog << " <arquivo_cena> <saida.ppm> [--procs N] [--split stripes|tiles]"
+              << " [--width W] [--height H] [--raytracer caminho] [--keep-parts] [-- opcoes do raytracer]"
+              << std::endl;
+}
+
+// Divide a imagem em n regiões: faixas horizontais de alturas iguais (a menos
+// de um pixel) ou uma grade de linhas x colunas, com linhas o mais perto
+// possível de sqrt(n) entre os divisores de n
+std::vector<Tile> split_frame(int width, int height, int n, bool tiles) {
+    int rows = n, cols = 1;
+    if (tiles) {
+        rows = (int)std::sqrt(double(n));
+        while (n % rows != 0) rows--;
+        cols = n / rows;
+    }
+    std::vector<Tile> regions;
+    if (rows > height || cols > width) return regions;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            regions.push_back({int((long)width * c / cols), int((long)height * r / rows),
+                               int((long)width * (c + 1) / cols), int((long)height * (r + 1) / rows)});
+        }
+    }
+    return regions;
+}
+
+// Inicia o raytracer com args; a saída padrão do filho vai para /dev/null
+pid_t spawn(const std::vector<std::string>& args) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) dup2(null_fd, STDOUT_FILENO);
+    std::vector<char*> argv;
+    for (const std::string& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    execv(argv[0], argv.data());
+    std::cerr << "Erro: Nao foi possivel executar " << args[0] << std::endl;
+    _exit(127);
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> positional, extra;
+    int procs = 2, width = 800, height = 600;
+    bool tiles = false, keep_parts = false;
+    std::string raytracer =
+        (std::filesystem::path(argv[0]).parent_path() / (std::string("raytracer") + VARIANT)).string();
+
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if (arg == "--") {
+            extra.assign(argv + k + 1, argv + argc);
+            break;
+        } else if (arg == "--procs" && k + 1 < argc) {
+            procs = std::atoi(argv[++k]);
+        } else if (arg == "--split" && k + 1 < argc) {
+            std::string split = argv[++k];
+            if (split != "stripes" && split != "tiles") {
+                std::cerr << "Divisao invalida (use stripes ou tiles): " << split << std::endl;
+                return 1;
+            }
+            tiles = split == "tiles";
+        } else if (arg == "--width" && k + 1 < argc) {
+            width = std::atoi(argv[++k]);
+        } else if (arg == "--height" && k + 1 < argc) {
+            height = std::atoi(argv[++k]);
+        } else if (arg == "--raytracer" && k + 1 < argc) {
+            raytracer = argv[++k];
+        } else if (arg == "--keep-parts") {
+            keep_parts = true;
+        } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Opcao desconhecida: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2 || procs < 1 || width < 1 || height < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const std::string& output = positional[1];
+
+    std::vector<Tile> regions = split_frame(width, height, procs, tiles);
+    if (regions.empty()) {
+        std::cerr << "Erro: Nao da para dividir uma imagem " << width << "x" << height << " em " << procs
+                  << " partes." << std::endl;
+        return 1;
+    }
+
+    // Sem --threads nas opções repassadas, os núcleos são divididos entre os processos
+    bool has_threads = std::find(extra.begin(), extra.end(), "--threads") != extra.end();
+    int threads = std::max(1, (int)std::thread::hardware_concurrency() / procs);
+
+    std::cout << "Renderizando " << width << "x" << height << " em " << procs << " processo(s) ("
+              << (tiles ? "tiles" : "faixas") << ")..." << std::endl;
+    Clock::time_point start = Clock::now();
+    std::vector<std::string> parts;
+    std::vector<pid_t> pids;
+    for (size_t k = 0; k < regions.size(); k++) {
+        const Tile& r = regions[k];
+        parts.push_back(output + ".part" + std::to_string(k) + ".ppm");
+        std::vector<std::string> args = {raytracer, positional[0], parts.back(),
+                                         "--width", std::to_string(width), "--height", std::to_string(height),
+                                         "--region", std::to_string(r.x0) + "," + std::to_string(r.y0) + "," +
+                                                         std::to_string(r.x1) + "," + std::to_string(r.y1)};
+        if (!has_threads) {
+            args.push_back("--threads");
+            args.push_back(std::to_string(threads));
+        }
+        args.insert(args.end(), extra.begin(), extra.end());
+        pid_t pid = spawn(args);
+        if (pid < 0) {
+            std::cerr << "Erro: Nao foi possivel criar o processo " << k << std::endl;
+            // Sem todas as partes não há o que juntar: encerra os processos já criados
+            for (pid_t p : pids) kill(p, SIGTERM);
+            for (size_t j = 0; j < pids.size(); j++) {
+                while (waitpid(pids[j], nullptr, 0) < 0 && errno == EINTR) {}
+                std::remove(parts[j].c_str());
+            }
+            return 1;
+        }
+        pids.push_back(pid);
+    }
+
+    // Espera os processos na ordem em que terminam, anotando o tempo de cada um
+    std::vector<double> seconds(pids.size(), 0);
+    std::vector<bool> finished(pids.size(), false);
+    bool failed = false;
+    size_t remaining = pids.size();
+    while (remaining > 0) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            // ECHILD: não há mais filhos para esperar, e as partes que faltam não vêm
+            std::cerr << "Erro: Falha ao esperar os processos: " << std::strerror(errno) << std::endl;
+            failed = true;
+            break;
+        }
+        size_t k = std::find(pids.begin(), pids.end(), pid) - pids.begin();
+        if (k == pids.size() || finished[k]) continue;
+        finished[k] = true;
+        remaining--;
+        seconds[k] = std::chrono::duration<double>(Clock::now() - start).count();
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "Erro: O processo " << k << " (" << parts[k] << ") falhou." << std::endl;
+            failed = true;
+        }
+    }
+    double render_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t k = 0; k < regions.size(); k++) {
+        const Tile& r = regions[k];
+        std::cout << "  parte " << k << ": " << r.x0 << "," << r.y0 << "," << r.x1 << "," << r.y1 << " em "
+                  << seconds[k] << " s" << std::endl;
+    }
+    if (failed) return 1;
+
+    Clock::time_point merge_start = Clock::now();
+    if (!merge_ppm_parts(parts, output)) return 1;
+    double merge_s = std::chrono::duration<double>(Clock::now() - merge_start).count();
+    if (!keep_parts) {
+        for (const std::string& p : parts) std::remove(p.c_str());
+    }
+
+    std::cout << "Renderizacao: " << render_s << " s (a parte mais lenta), juncao: " << merge_s
+              << " s, imagem gravada em " << output << std::endl;
+    return 0;
+}